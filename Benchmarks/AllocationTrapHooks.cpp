@@ -0,0 +1,167 @@
+// The allocation trap's replacement allocator: the global operator
+// new/delete family, plus malloc/calloc/realloc/free on glibc and the
+// default malloc zone on macOS. Each counts the call through
+// AllocationTrap::noteHeapCall() and then allocates as usual. Replacing the
+// allocator affects the whole process, so this file is only compiled into
+// the benchmark executable, never into the plugin binary that hosts load.
+
+#include "AllocationTrap.h"
+
+#if MARSI_ALLOCATION_TRAP
+
+#include <new>
+#include <cstdlib>
+
+#if defined(__APPLE__)
+ #include <malloc/malloc.h>
+ #include <mach/mach.h>
+#endif
+
+#if defined(__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+}
+#endif
+
+namespace
+{
+    inline void noteHeapCall() noexcept { AllocationTrap::noteHeapCall(); }
+
+    void* allocateAligned(std::size_t size, std::size_t alignment) noexcept;
+    void freeAligned(void* block) noexcept;
+    void* rawMalloc(std::size_t size) noexcept;
+    void rawFree(void* block) noexcept;
+
+    void* allocateAligned(std::size_t size, std::size_t alignment) noexcept
+    {
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, alignment);
+       #else
+        void* result = nullptr;
+        return posix_memalign(&result, jmax(alignment, sizeof(void*)), size == 0 ? 1 : size) == 0 ? result : nullptr;
+       #endif
+    }
+
+    void freeAligned(void* block) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(block);
+       #else
+        rawFree(block);
+       #endif
+    }
+
+   #if defined(__APPLE__)
+    // Darwin resolves malloc per image, so hook the default zone instead of the symbol
+    void* (*zoneMalloc)(malloc_zone_t*, size_t) = nullptr;
+    void* (*zoneCalloc)(malloc_zone_t*, size_t, size_t) = nullptr;
+    void* (*zoneRealloc)(malloc_zone_t*, void*, size_t) = nullptr;
+    void (*zoneFree)(malloc_zone_t*, void*) = nullptr;
+
+    void* trapZoneMalloc(malloc_zone_t* zone, size_t size) { noteHeapCall(); return zoneMalloc(zone, size); }
+    void* trapZoneCalloc(malloc_zone_t* zone, size_t count, size_t size) { noteHeapCall(); return zoneCalloc(zone, count, size); }
+    void* trapZoneRealloc(malloc_zone_t* zone, void* block, size_t size) { noteHeapCall(); return zoneRealloc(zone, block, size); }
+    void trapZoneFree(malloc_zone_t* zone, void* block) { if (block != nullptr) noteHeapCall(); zoneFree(zone, block); }
+
+    struct ZoneHooks
+    {
+        ZoneHooks()
+        {
+            auto* zone = malloc_default_zone();
+            auto address = reinterpret_cast<vm_address_t>(zone);
+
+            vm_protect(mach_task_self(), address, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE);
+            zoneMalloc = zone->malloc;   zone->malloc = trapZoneMalloc;
+            zoneCalloc = zone->calloc;   zone->calloc = trapZoneCalloc;
+            zoneRealloc = zone->realloc; zone->realloc = trapZoneRealloc;
+            zoneFree = zone->free;       zone->free = trapZoneFree;
+            vm_protect(mach_task_self(), address, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+        }
+    };
+
+    const ZoneHooks zoneHooks;
+   #endif
+
+    // The C++ operators count their own call and then allocate underneath
+    // the C hooks, so one new or delete is one heap call, not two
+    void* rawMalloc(std::size_t size) noexcept
+    {
+       #if defined(__GLIBC__)
+        return __libc_malloc(size);
+       #elif defined(__APPLE__)
+        return zoneMalloc != nullptr ? zoneMalloc(malloc_default_zone(), size) : std::malloc(size);
+       #else
+        return std::malloc(size);
+       #endif
+    }
+
+    void rawFree(void* block) noexcept
+    {
+       #if defined(__GLIBC__)
+        __libc_free(block);
+       #elif defined(__APPLE__)
+        if (zoneFree != nullptr && block != nullptr)
+            zoneFree(malloc_zone_from_ptr(block), block);
+        else
+            std::free(block);
+       #else
+        std::free(block);
+       #endif
+    }
+}
+
+#if defined(__GLIBC__)
+// glibc lets the executable interpose the C allocator over its internal entry points
+extern "C"
+{
+    void* malloc(size_t size) __THROW { noteHeapCall(); return __libc_malloc(size); }
+    void* calloc(size_t count, size_t size) __THROW { noteHeapCall(); return __libc_calloc(count, size); }
+    void* realloc(void* block, size_t size) __THROW { noteHeapCall(); return __libc_realloc(block, size); }
+    void free(void* block) __THROW { if (block != nullptr) noteHeapCall(); __libc_free(block); }
+}
+#endif
+
+//==============================================================================
+void* operator new(std::size_t size)
+{
+    noteHeapCall();
+    if (void* block = rawMalloc(size == 0 ? 1 : size))
+        return block;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)                                   { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept     { noteHeapCall(); return rawMalloc(size == 0 ? 1 : size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept   { noteHeapCall(); return rawMalloc(size == 0 ? 1 : size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    noteHeapCall();
+    if (void* block = allocateAligned(size, static_cast<std::size_t>(alignment)))
+        return block;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)                                 { return operator new(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { noteHeapCall(); return allocateAligned(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { noteHeapCall(); return allocateAligned(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* block) noexcept                                  { if (block != nullptr) noteHeapCall(); rawFree(block); }
+void operator delete[](void* block) noexcept                                { operator delete(block); }
+void operator delete(void* block, std::size_t) noexcept                     { operator delete(block); }
+void operator delete[](void* block, std::size_t) noexcept                   { operator delete(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept           { operator delete(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept         { operator delete(block); }
+
+void operator delete(void* block, std::align_val_t) noexcept                              { if (block != nullptr) noteHeapCall(); freeAligned(block); }
+void operator delete[](void* block, std::align_val_t alignment) noexcept                  { operator delete(block, alignment); }
+void operator delete(void* block, std::size_t, std::align_val_t alignment) noexcept       { operator delete(block, alignment); }
+void operator delete[](void* block, std::size_t, std::align_val_t alignment) noexcept     { operator delete(block, alignment); }
+void operator delete(void* block, std::align_val_t alignment, const std::nothrow_t&) noexcept   { operator delete(block, alignment); }
+void operator delete[](void* block, std::align_val_t alignment, const std::nothrow_t&) noexcept { operator delete(block, alignment); }
+
+#endif
@@ -0,0 +1,217 @@
+// Accuracy check for the Utils fast-math approximations. Sweeps each one,
+// scalar and block versions, against the double-precision std:: function and
+// fails when the worst error exceeds the bound documented in Utils.h.
+//
+// Exit codes: 0 pass, 1 a bound exceeded
+//
+//   MarsiFastMathCheck
+
+#include "JuceHeader.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    // Keep in step with the bounds in Utils.h
+    constexpr double sinBoundNear = 2.5e-7;     // |x| <= 2^12, absolute
+    constexpr double sinBoundFar = 5.0e-7;      // |x| <= 2^15, absolute
+    constexpr double log2Bound = 1.2e-7;        // absolute, plus rounding of the result
+    constexpr double exp2Bound = 2.5e-7;        // relative
+    constexpr double powBound = 2.0e-7;         // relative, times 1 + |exponent * log2(base)|
+
+    constexpr int blockSize = 4096;
+
+    struct Check
+    {
+        const char* name;
+        double worst = 0.0;     // error divided by its bound: above 1 fails
+        float worstInput = 0.0f;
+
+        void add(double error, double bound, float input)
+        {
+            if (! (error / bound <= worst))
+            {
+                worst = error / bound;
+                worstInput = input;
+            }
+        }
+
+        bool report() const
+        {
+            const bool pass = worst <= 1.0;
+            std::printf("%-20s worst %.3f of bound (x = %.9g)  %s\n", name, worst, worstInput, pass ? "ok" : "FAIL");
+            return pass;
+        }
+    };
+
+    // Runs values through the scalar and the block version of one function
+    template <typename Scalar, typename Block, typename Measure>
+    void sweep(const std::vector<float>& inputs, Scalar&& scalar, Block&& block, Measure&& measure)
+    {
+        std::vector<float> output(blockSize);
+
+        for (size_t start = 0; start < inputs.size(); start += blockSize)
+        {
+            const int count = static_cast<int>(std::min<size_t>(blockSize, inputs.size() - start));
+            block(inputs.data() + start, output.data(), count);
+
+            for (int i = 0; i < count; ++i)
+            {
+                const float x = inputs[start + static_cast<size_t>(i)];
+                measure(x, scalar(x));
+                measure(x, output[static_cast<size_t>(i)]);
+            }
+        }
+    }
+
+    std::vector<float> linearRange(float low, float high, int numValues)
+    {
+        std::vector<float> values(static_cast<size_t>(numValues));
+        for (int i = 0; i < numValues; ++i)
+            values[static_cast<size_t>(i)] = low + (high - low) * static_cast<float>(i) / static_cast<float>(numValues - 1);
+        return values;
+    }
+
+    // Every float in [low, high) taken every stride ulps
+    std::vector<float> floatRange(float low, float high, int stride)
+    {
+        std::vector<float> values;
+        for (float x = low; x < high;)
+        {
+            values.push_back(x);
+            for (int i = 0; i < stride && x < high; ++i)
+                x = std::nextafter(x, high);
+        }
+        return values;
+    }
+
+    // Half an ulp of the float nearest to value
+    double halfUlp(double value)
+    {
+        const float rounded = static_cast<float>(std::abs(value));
+        return 0.5 * (std::nextafter(rounded, std::numeric_limits<float>::max()) - rounded);
+    }
+
+    bool checkSinCos()
+    {
+        Check sinNear { "fastSin |x|<=2^12" }, sinFar { "fastSin |x|<=2^15" };
+        Check cosNear { "fastCos |x|<=2^12" }, cosFar { "fastCos |x|<=2^15" };
+
+        auto inputs = linearRange(-32768.0f, 32768.0f, 1 << 23);
+        const auto dense = linearRange(-8.0f, 8.0f, 1 << 20);
+        inputs.insert(inputs.end(), dense.begin(), dense.end());
+
+        auto measure = [](Check& near, Check& far, bool cosine)
+        {
+            return [&near, &far, cosine](float x, float value)
+            {
+                const double reference = cosine ? std::cos(static_cast<double>(x)) : std::sin(static_cast<double>(x));
+                const double error = std::abs(value - reference);
+                if (std::abs(x) <= 4096.0f)
+                    near.add(error, sinBoundNear, x);
+                far.add(error, sinBoundFar, x);
+            };
+        };
+
+        sweep(inputs, [](float x) { return Utils::fastSin(x); },
+              [](const float* in, float* out, int n) { Utils::fastSin(in, out, n); }, measure(sinNear, sinFar, false));
+        sweep(inputs, [](float x) { return Utils::fastCos(x); },
+              [](const float* in, float* out, int n) { Utils::fastCos(in, out, n); }, measure(cosNear, cosFar, true));
+
+        const bool pass = sinNear.report() & sinFar.report();
+        return cosNear.report() & cosFar.report() & pass;
+    }
+
+    bool checkLog2()
+    {
+        Check log2Check { "fastLog2" };
+        Check nonPositive { "fastLog2 x<=0" };
+
+        // Two octaves at full resolution, then every exponent more sparsely
+        auto inputs = floatRange(0.5f, 2.0f, 1);
+        const auto wide = floatRange(std::numeric_limits<float>::min(), std::numeric_limits<float>::max(), 4099);
+        inputs.insert(inputs.end(), wide.begin(), wide.end());
+
+        sweep(inputs, [](float x) { return Utils::fastLog2(x); },
+              [](const float* in, float* out, int n) { Utils::fastLog2(in, out, n); },
+              [&](float x, float value)
+              {
+                  const double reference = std::log2(static_cast<double>(x));
+                  log2Check.add(std::abs(value - reference), log2Bound + halfUlp(reference), x);
+              });
+
+        const std::vector<float> invalid { 0.0f, -0.0f, -1.0f, -std::numeric_limits<float>::max() };
+        sweep(invalid, [](float x) { return Utils::fastLog2(x); },
+              [](const float* in, float* out, int n) { Utils::fastLog2(in, out, n); },
+              [&](float x, float value) { nonPositive.add(value == -100.0f ? 0.0 : 2.0, 1.0, x); });
+
+        return log2Check.report() & nonPositive.report();
+    }
+
+    bool checkExp2()
+    {
+        Check exp2Check { "fastExp2" };
+        Check clamped { "fastExp2 clamped" };
+
+        const auto inputs = linearRange(-126.0f, 127.0f, 1 << 23);
+
+        sweep(inputs, [](float x) { return Utils::fastExp2(x); },
+              [](const float* in, float* out, int n) { Utils::fastExp2(in, out, n); },
+              [&](float x, float value)
+              {
+                  const double reference = std::exp2(static_cast<double>(x));
+                  exp2Check.add(std::abs(value - reference) / reference, exp2Bound, x);
+              });
+
+        // Out of range arguments behave as the nearest end of the range
+        const std::vector<float> outside { -1000.0f, -127.0f, 128.0f, 1000.0f };
+        sweep(outside, [](float x) { return Utils::fastExp2(x); },
+              [](const float* in, float* out, int n) { Utils::fastExp2(in, out, n); },
+              [&](float x, float value)
+              {
+                  const float end = Utils::fastExp2(x < 0.0f ? -126.0f : 127.0f);
+                  clamped.add(value == end ? 0.0 : 2.0, 1.0, x);
+              });
+
+        return exp2Check.report() & clamped.report();
+    }
+
+    bool checkPow()
+    {
+        Check powCheck { "fastPow" };
+
+        const auto bases = floatRange(1.0e-3f, 1.0e3f, 1 << 14);
+        const auto exponents = linearRange(-8.0f, 8.0f, 161);
+
+        for (const float base : bases)
+        {
+            for (const float exponent : exponents)
+            {
+                const double product = exponent * std::log2(static_cast<double>(base));
+                const double reference = std::pow(static_cast<double>(base), static_cast<double>(exponent));
+                const double error = std::abs(Utils::fastPow(base, exponent) - reference) / reference;
+                powCheck.add(error, powBound * (1.0 + std::abs(product)), base);
+            }
+        }
+
+        return powCheck.report();
+    }
+}
+
+int main()
+{
+    const bool sinCosPass = checkSinCos();
+    const bool log2Pass = checkLog2();
+    const bool exp2Pass = checkExp2();
+    const bool powPass = checkPow();
+
+    if (sinCosPass && log2Pass && exp2Pass && powPass)
+        return 0;
+
+    std::printf("FAIL: fast-math error above the bounds documented in Utils.h\n");
+    return 1;
+}
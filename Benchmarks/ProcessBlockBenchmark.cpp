@@ -0,0 +1,393 @@
+// Headless processBlock benchmark. Creates AutoTuneAudioProcessor with no
+// editor and drives it with a synthetic sung phrase for every combination of
+// sample rate, block size, channel count and mode, timing each processBlock
+// call. Prints a table and writes the results as JSON; with --baseline it
+// also compares ns/sample against an earlier run and fails on regressions.
+// Built with the allocation trap, it also fails when processBlock touches
+// the heap.
+//
+// Exit codes: 0 pass, 1 regression, 2 bad arguments or files, 3 heap calls
+// on the audio thread
+//
+//   MarsiAutoTuneBenchmark [--json file] [--seconds s] [--quick]
+//                          [--baseline file] [--tolerance fraction]
+
+#include "JuceHeader.h"
+#include "PluginProcessor.h"
+#include "Parameters.h"
+#include "AllocationTrap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        File jsonFile = File::getCurrentWorkingDirectory().getChildFile("processblock_benchmark.json");
+        File baselineFile;
+        double seconds = 4.0;
+        double tolerance = 0.15;
+        bool quick = false;
+    };
+
+    struct Config
+    {
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        Parameters::Mode mode = Parameters::Mode::Classic;
+
+        String getKey() const
+        {
+            return Parameters::getModeName(mode) + "/" + String(roundToInt(sampleRate)) + "/"
+                 + String(blockSize) + "/" + String(numChannels);
+        }
+    };
+
+    struct Result
+    {
+        Config config;
+        double nsPerSample = 0.0;
+        double realtimeFactor = 0.0;
+        double p50Micros = 0.0;
+        double p99Micros = 0.0;
+        double maxMicros = 0.0;
+        double deadlineMicros = 0.0;    // duration of one block
+        int64 allocations = 0;
+    };
+
+    constexpr double warmUpSeconds = 0.5;
+    constexpr int maxChannels = 2;
+
+    // A sung phrase, repeating every two seconds: four notes a little off the
+    // C major scale with vibrato, a breath and a rest. About 70% of the time
+    // is voiced. Harmonics fall off as 1/h under two formant peaks, and the
+    // second channel is a slightly quieter, 0.3 ms later copy.
+    AudioBuffer<float> makeVocalSignal(double sampleRate, int numSamples)
+    {
+        AudioBuffer<float> signal(maxChannels, numSamples);
+        signal.clear();
+
+        struct Note { float midiNote; float detuneCents; };
+        const Note notes[] = { { 57.0f, 30.0f }, { 60.0f, -25.0f }, { 62.0f, 40.0f }, { 64.0f, -15.0f } };
+        constexpr double noteSeconds = 0.35;
+        constexpr double breathSeconds = 0.2;
+        constexpr double cycleSeconds = 2.0;
+
+        Random random(1234);
+        double phase = 0.0;
+        auto* left = signal.getWritePointer(0);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double time = i / sampleRate;
+            const double cycleTime = std::fmod(time, cycleSeconds);
+            const int noteIndex = static_cast<int>(cycleTime / noteSeconds);
+
+            if (noteIndex < 4)
+            {
+                const auto& note = notes[noteIndex];
+                const double noteTime = cycleTime - noteIndex * noteSeconds;
+                const double vibrato = 20.0 * std::sin(MathConstants<double>::twoPi * 5.5 * noteTime);
+                const double frequency = 440.0 * std::pow(2.0, (note.midiNote - 69.0 + (note.detuneCents + vibrato) / 100.0) / 12.0);
+                const double envelope = jmin(1.0, noteTime / 0.02, (noteSeconds - noteTime) / 0.02);
+
+                phase += frequency / sampleRate;
+                phase -= std::floor(phase);
+
+                double sample = 0.0;
+                for (int harmonic = 1; harmonic * frequency < jmin(8000.0, sampleRate * 0.45); ++harmonic)
+                {
+                    const double harmonicFrequency = harmonic * frequency;
+                    const double formants = 1.0 + 3.0 * std::exp(-std::pow((harmonicFrequency - 700.0) / 150.0, 2.0))
+                                                + 2.0 * std::exp(-std::pow((harmonicFrequency - 1200.0) / 200.0, 2.0));
+                    sample += formants / harmonic * std::sin(MathConstants<double>::twoPi * harmonic * phase);
+                }
+
+                left[i] = static_cast<float>(0.15 * envelope * sample);
+            }
+            else if (cycleTime < 4 * noteSeconds + breathSeconds)
+            {
+                left[i] = 0.02f * (random.nextFloat() * 2.0f - 1.0f);
+            }
+        }
+
+        const int offset = roundToInt(sampleRate * 0.0003);
+        auto* right = signal.getWritePointer(1);
+        for (int i = offset; i < numSamples; ++i)
+            right[i] = 0.9f * left[i - offset];
+
+        return signal;
+    }
+
+    void setMode(AutoTuneAudioProcessor& processor, Parameters::Mode mode)
+    {
+        auto* parameter = processor.getValueTreeState().getParameter(Parameters::MODE_ID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(mode)));
+    }
+
+    bool prepare(AutoTuneAudioProcessor& processor, const Config& config)
+    {
+        processor.releaseResources();
+
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(AudioChannelSet::canonicalChannelSet(config.numChannels));
+        layout.outputBuses.add(AudioChannelSet::canonicalChannelSet(config.numChannels));
+        if (! processor.setBusesLayout(layout))
+            return false;
+
+        processor.setNonRealtime(false);
+        processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+        processor.prepareToPlay(config.sampleRate, config.blockSize);
+        setMode(processor, config.mode);
+        return true;
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        const auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size()))) - 1;
+        return sorted[jmin(sorted.size() - 1, index)];
+    }
+
+    Result run(AutoTuneAudioProcessor& processor, const Config& config, const AudioBuffer<float>& signal)
+    {
+        Result result;
+        result.config = config;
+        result.deadlineMicros = 1.0e6 * config.blockSize / config.sampleRate;
+
+        AudioBuffer<float> buffer(config.numChannels, config.blockSize);
+        MidiBuffer midi;
+
+        const int warmUpBlocks = static_cast<int>(warmUpSeconds * config.sampleRate / config.blockSize);
+        const int numBlocks = signal.getNumSamples() / config.blockSize;
+        std::vector<double> blockNanos;
+        blockNanos.reserve(static_cast<size_t>(numBlocks));
+
+        AllocationTrap::resetViolationCount();
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            for (int channel = 0; channel < config.numChannels; ++channel)
+                buffer.copyFrom(channel, 0, signal, channel, block * config.blockSize, config.blockSize);
+
+            const auto start = std::chrono::steady_clock::now();
+            processor.processBlock(buffer, midi);
+            const auto end = std::chrono::steady_clock::now();
+
+            if (block >= warmUpBlocks)
+                blockNanos.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+
+        result.allocations = AllocationTrap::getViolationCount();
+
+        if (blockNanos.empty())
+            return result;
+
+        double totalNanos = 0.0;
+        for (auto nanos : blockNanos)
+            totalNanos += nanos;
+
+        const double numSamples = static_cast<double>(blockNanos.size()) * config.blockSize;
+        result.nsPerSample = totalNanos / numSamples;
+        result.realtimeFactor = (numSamples / config.sampleRate) / (totalNanos * 1.0e-9);
+
+        std::sort(blockNanos.begin(), blockNanos.end());
+        result.p50Micros = percentile(blockNanos, 0.5) * 1.0e-3;
+        result.p99Micros = percentile(blockNanos, 0.99) * 1.0e-3;
+        result.maxMicros = blockNanos.back() * 1.0e-3;
+        return result;
+    }
+
+    // Three decimals is well below run-to-run noise and keeps the JSON diffable
+    double rounded(double value)
+    {
+        return std::round(value * 1000.0) / 1000.0;
+    }
+
+    var toJson(const Options& options, const std::vector<Result>& results)
+    {
+        auto* root = new DynamicObject();
+        root->setProperty("plugin", JucePlugin_Name);
+        root->setProperty("version", JucePlugin_VersionString);
+        root->setProperty("cpu", SystemStats::getCpuModel());
+        root->setProperty("numCpus", SystemStats::getNumCpus());
+        root->setProperty("secondsPerRun", options.seconds);
+        root->setProperty("allocationTrap", AllocationTrap::isCompiledIn());
+
+        Array<var> entries;
+        for (const auto& result : results)
+        {
+            auto* entry = new DynamicObject();
+            entry->setProperty("key", result.config.getKey());
+            entry->setProperty("mode", Parameters::getModeName(result.config.mode));
+            entry->setProperty("sampleRate", result.config.sampleRate);
+            entry->setProperty("blockSize", result.config.blockSize);
+            entry->setProperty("channels", result.config.numChannels);
+            entry->setProperty("nsPerSample", rounded(result.nsPerSample));
+            entry->setProperty("realtimeFactor", rounded(result.realtimeFactor));
+            entry->setProperty("p50Micros", rounded(result.p50Micros));
+            entry->setProperty("p99Micros", rounded(result.p99Micros));
+            entry->setProperty("maxMicros", rounded(result.maxMicros));
+            entry->setProperty("deadlineMicros", rounded(result.deadlineMicros));
+
+            if (AllocationTrap::isCompiledIn())
+                entry->setProperty("allocations", result.allocations);
+
+            entries.add(var(entry));
+        }
+
+        root->setProperty("results", entries);
+        return var(root);
+    }
+
+    // Every configuration present in both runs whose ns/sample grew by more
+    // than the tolerance counts as a regression
+    int compareWithBaseline(const Options& options, const std::vector<Result>& results)
+    {
+        const auto baseline = JSON::parse(options.baselineFile);
+        const auto* entries = baseline["results"].getArray();
+        if (entries == nullptr)
+        {
+            std::fprintf(stderr, "Could not read baseline %s\n", options.baselineFile.getFullPathName().toRawUTF8());
+            return 2;
+        }
+
+        int regressions = 0;
+        for (const auto& result : results)
+        {
+            const auto key = result.config.getKey();
+
+            for (const auto& entry : *entries)
+            {
+                if (entry["key"].toString() != key)
+                    continue;
+
+                const double before = static_cast<double>(entry["nsPerSample"]);
+                if (before > 0.0 && result.nsPerSample > before * (1.0 + options.tolerance))
+                {
+                    std::printf("REGRESSION %-24s %9.2f -> %9.2f ns/sample (%+.0f%%)\n", key.toRawUTF8(),
+                                before, result.nsPerSample, 100.0 * (result.nsPerSample / before - 1.0));
+                    ++regressions;
+                }
+                break;
+            }
+        }
+
+        std::printf("%d regression(s) beyond %.0f%% against %s\n", regressions, 100.0 * options.tolerance,
+                    options.baselineFile.getFullPathName().toRawUTF8());
+        return regressions > 0 ? 1 : 0;
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const String argument(argv[i]);
+            const bool hasValue = i + 1 < argc;
+
+            if (argument == "--json" && hasValue)
+                options.jsonFile = File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+            else if (argument == "--baseline" && hasValue)
+                options.baselineFile = File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+            else if (argument == "--seconds" && hasValue)
+                options.seconds = jmax(warmUpSeconds + 0.5, String(argv[++i]).getDoubleValue());
+            else if (argument == "--tolerance" && hasValue)
+                options.tolerance = jmax(0.0, String(argv[++i]).getDoubleValue());
+            else if (argument == "--quick")
+                options.quick = true;
+            else
+                return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (! parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: %s [--json file] [--seconds s] [--quick] [--baseline file] [--tolerance fraction]\n", argv[0]);
+        return 2;
+    }
+
+    // The processor's parameter state and AsyncUpdater expect a message manager
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const std::vector<double> sampleRates = options.quick ? std::vector<double> { 48000.0 }
+                                                          : std::vector<double> { 44100.0, 48000.0, 96000.0 };
+    const std::vector<int> blockSizes = options.quick ? std::vector<int> { 64, 512 }
+                                                      : std::vector<int> { 32, 64, 128, 256, 512, 1024, 2048 };
+    const std::vector<int> channelCounts = options.quick ? std::vector<int> { 2 } : std::vector<int> { 1, 2 };
+    const Parameters::Mode modes[] = { Parameters::Mode::Classic, Parameters::Mode::Hard, Parameters::Mode::AI };
+
+    auto processor = std::make_unique<AutoTuneAudioProcessor>();
+    std::vector<Result> results;
+
+    std::printf("%-8s %7s %6s %3s %10s %9s %10s %10s %10s %10s\n", "mode", "rate", "block", "ch",
+                "ns/sample", "realtime", "p50 us", "p99 us", "max us", "deadline");
+
+    for (const double sampleRate : sampleRates)
+    {
+        const auto signal = makeVocalSignal(sampleRate, static_cast<int>(options.seconds * sampleRate));
+
+        for (const int blockSize : blockSizes)
+        {
+            for (const int numChannels : channelCounts)
+            {
+                for (const auto mode : modes)
+                {
+                    Config config;
+                    config.sampleRate = sampleRate;
+                    config.blockSize = blockSize;
+                    config.numChannels = numChannels;
+                    config.mode = mode;
+
+                    if (! prepare(*processor, config))
+                    {
+                        std::fprintf(stderr, "Skipping %s: layout not supported\n", config.getKey().toRawUTF8());
+                        continue;
+                    }
+
+                    const auto result = run(*processor, config, signal);
+                    results.push_back(result);
+
+                    std::printf("%-8s %7.0f %6d %3d %10.2f %8.1fx %10.1f %10.1f %10.1f %10.1f\n",
+                                Parameters::getModeName(mode).toRawUTF8(), sampleRate, blockSize, numChannels,
+                                result.nsPerSample, result.realtimeFactor, result.p50Micros, result.p99Micros,
+                                result.maxMicros, result.deadlineMicros);
+
+                    if (result.allocations > 0)
+                        std::printf("         %lld heap call(s) on the audio thread\n", static_cast<long long>(result.allocations));
+                }
+            }
+        }
+    }
+
+    processor->releaseResources();
+
+    int64 heapCalls = 0;
+    for (const auto& result : results)
+        heapCalls += result.allocations;
+
+    if (! options.jsonFile.replaceWithText(JSON::toString(toJson(options, results))))
+    {
+        std::fprintf(stderr, "Could not write %s\n", options.jsonFile.getFullPathName().toRawUTF8());
+        return 2;
+    }
+
+    std::printf("Wrote %s\n", options.jsonFile.getFullPathName().toRawUTF8());
+
+    const int baselineResult = options.baselineFile != File() ? compareWithBaseline(options, results) : 0;
+
+    if (AllocationTrap::isCompiledIn() && heapCalls > 0)
+    {
+        std::printf("FAIL: %lld heap call(s) on the audio thread\n", static_cast<long long>(heapCalls));
+        return 3;
+    }
+
+    return baselineResult;
+}
@@ -1,5 +1,8 @@
 #include "AIModelLoader.h"
 #include "Utils.h"
+#include "../libs/crepe/crepe.h"
+#include "../libs/tensorflow_lite/tensorflow_lite.h"
+#include <cmath>
 #include <cstring>
 #include <chrono>
 #include <thread>
@@ -14,19 +17,9 @@ struct MarsiLogger {
     }
 };
 
-AIModelLoader::AIModelLoader()
+AIModelLoader::AIModelLoader(ScratchWorkspace& scratch)
+    : workspace(scratch)
 {
-    pitchHistory.resize(10, 0.0f);
-    
-    // Initialize FFT for spectral analysis (stub for development)
-    // fft = std::make_unique<juce::dsp::FFT>(fftOrder);  // Will work on macOS
-    // frequencyData.allocate(fftSize * 2, true);  // Will work on macOS
-    
-    // Initialize DDSP synthesizer (stub for development) 
-    synthesizer = std::make_unique<DDSPSynthesizer>();
-    // synthesizer->reverbBuffer.setSize(1, 4410);  // Will work on macOS
-    // synthesizer->reverbBuffer.clear();  // Will work on macOS
-    
     prepareToPlay(44100.0, 512);
 }
 
@@ -37,400 +30,323 @@ AIModelLoader::~AIModelLoader()
 
 bool AIModelLoader::loadModels()
 {
-    // For MVP, we simulate model loading
-    // In a full implementation, this would load actual CREPE and DDSP models
-    
     lastProcessTime = Time::getCurrentTime();
     
-    // Simulate model loading time
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const File modelFile = modelPath.isNotEmpty() ? File(modelPath) : getDefaultModelFile();
+    if (! modelFile.existsAsFile())
+    {
+        MarsiLogger::writeToLog("No CREPE model at " + modelFile.getFullPathName().toStdString());
+        return false;
+    }
+    
+    auto model = tflite::FlatBufferModel::BuildFromFile(modelFile.getFullPathName().toRawUTF8());
+    auto interpreter = model != nullptr ? CrepeModel::createInterpreter(*model) : nullptr;
+    if (interpreter == nullptr)
+    {
+        MarsiLogger::writeToLog("Not a CREPE model: " + modelFile.getFullPathName().toStdString());
+        return false;
+    }
+    
+    // The worker gets an interpreter of its own; the one kept here is only
+    // used for inline inference on the audio thread
+    inferenceWorker.prepare(CrepeModel::createInterpreter(*model), static_cast<int>(crepeChannels.size()),
+                            crepeViterbiLagFrames);
     
+    crepeModel = std::move(model);
+    crepeInterpreter = std::move(interpreter);
+    prepareInlineBatch();
     modelsLoaded = true;
     
-    MarsiLogger::writeToLog("AI Models loaded successfully (simulated)");
+    MarsiLogger::writeToLog("AI Models loaded successfully");
     return true;
 }
 
 void AIModelLoader::unloadModels()
 {
     modelsLoaded = false;
-    
-    // Reset synthesis state
-    if (synthesizer)
-    {
-        std::fill(synthesizer->harmonicPhases.begin(), synthesizer->harmonicPhases.end(), 0.0f);
-        std::fill(synthesizer->harmonicAmps.begin(), synthesizer->harmonicAmps.end(), 0.0f);
-        // synthesizer->reverbBuffer.clear();  // Will work on macOS
-        synthesizer->reverbPosition = 0;
-    }
+    inferenceWorker.release();
+    crepeInterpreter.reset();
+    crepeBatchInterpreter.reset();
+    crepeModel.reset();
     
     Logger::writeToLog("AI Models unloaded");
 }
 
-AIModelLoader::PitchPrediction AIModelLoader::predictPitch(const float* audio, int numSamples, double sampleRate)
+File AIModelLoader::getDefaultModelFile()
+{
+    // Next to the presets; the tiny network is the one that fits a realtime budget
+    return File::getSpecialLocation(File::userDocumentsDirectory)
+        .getChildFile("MarsiAutoTune").getChildFile("Models").getChildFile("crepe-tiny.mtfl");
+}
+
+AIModelLoader::PitchPrediction AIModelLoader::predictPitch(int channel, const float* audio, int numSamples, double sampleRate,
+                                                           float* pitchOutput)
 {
     PitchPrediction prediction;
     
     if (!modelsLoaded || numSamples == 0)
         return prediction;
     
+    if (! isPositiveAndBelow(channel, static_cast<int>(crepeChannels.size())))
+    {
+        jassertfalse;
+        return prediction;
+    }
+    
     auto startTime = juce::Time::getMillisecondCounter();  // Standard C++ timing
     
-    // Simulate CREPE-style pitch detection
-    float rawPitch = detectPitchCREPESimulation(audio, numSamples);
+    auto& state = crepeChannels[static_cast<size_t>(channel)];
     
-    if (rawPitch > 0.0f)
+    if (synchronousInference)
     {
-        // Apply sophisticated pitch tracking and smoothing
-        prediction.frequency = smoothPitchEstimate(rawPitch);
-        
-        // Analyze full pitch features
-        prediction = analyzePitchFeatures(audio, numSamples);
-        
-        // Calculate confidence based on signal characteristics
-        float rms = 0.0f;
-        for (int i = 0; i < numSamples; ++i)
-        {
-            rms += audio[i] * audio[i];
-        }
-        rms = std::sqrt(rms / numSamples);
-        
-        prediction.confidence = jlimit(0.0f, 1.0f, rms * 10.0f); // Scale RMS to confidence
+        runCrepeFrames(state, audio, numSamples, sampleRate);
+    }
+    else
+    {
+        pushCrepeHistory(state, audio, numSamples);
         
-        // Extract harmonics from spectrum
-        std::vector<float> spectrum;
-        performSpectralAnalysis(audio, numSamples, spectrum);
-        extractHarmonics(spectrum, prediction.frequency, prediction.harmonics);
+        // In realtime the network only ever runs on the worker; without it
+        // there is no prediction and AI mode stays on the tracker
+        if (! inferenceWorker.isPrepared())
+            return prediction;
         
-        // Estimate voicing (harmonic vs noise content)
-        float harmonicEnergy = 0.0f;
-        for (float harmonic : prediction.harmonics)
+        // One network frame per hop bounds the cost of any single block
+        if (state.samplesSinceFrame >= crepeHopSamples)
         {
-            harmonicEnergy += harmonic;
+            state.samplesSinceFrame = 0;
+            queueCrepeFrame(channel, state, sampleRate);
         }
-        prediction.voicing = jlimit(0.0f, 1.0f, harmonicEnergy * 2.0f);
     }
     
-    // Update performance metrics
-    processingTimeMs = juce::Time::getMillisecondCounter() - startTime;
-    updatePerformanceMetrics();
-    
-    return prediction;
-}
-
-bool AIModelLoader::processWithDDSP(const float* input, float* output, int numSamples, 
-                                    const SynthesisParams& params)
-{
-    if (!modelsLoaded || !synthesizer)
-        return false;
-    
-    auto startTime = juce::Time::getMillisecondCounter();
-    
-    // Copy input to output as base
-    std::memcpy(output, input, numSamples * sizeof(float));
+    collectCrepeResults();
     
-    // Prepare temporary buffers
-    processBuffer.setSize(1, numSamples);
-    processBuffer.clear();
-    
-    auto* processData = processBuffer.getWritePointer(0);
+    // A result older than this is no longer worth correcting towards
+    if (state.latest.timestamp < 0 || state.samplePosition - state.latest.timestamp > crepeMaxResultAge)
+        return prediction;
     
-    // Synthesize harmonics
-    synthesizeHarmonics(processData, numSamples, params);
+    prediction.isCurrent = true;
+    prediction.frequency = getCrepeFrequency(state, state.samplePosition);
+    if (prediction.frequency > 0.0f)
+        prediction.confidence = state.latest.confidence;
     
-    // Add noise component
-    if (params.noisiness > 0.0f)
+    // Sample i of the block ends at position blockStart + i + 1
+    if (pitchOutput != nullptr)
     {
-        AudioBuffer<float> noiseBuffer(1, numSamples);
-        auto* noiseData = noiseBuffer.getWritePointer(0);
-        synthesizeNoise(noiseData, numSamples, params.noisiness);
-        
-        // Mix noise with harmonics
+        const int64 blockStart = state.samplePosition - numSamples;
         for (int i = 0; i < numSamples; ++i)
-        {
-            processData[i] += noiseData[i] * params.noisiness;
-        }
-    }
-    
-    // Apply formant filtering to maintain vocal character
-    applyFormantFiltering(processData, numSamples, params.fundamentalFreq);
-    
-    // Apply loudness control
-    float gainMultiplier = params.loudness * 2.0f; // Scale to appropriate range
-    for (int i = 0; i < numSamples; ++i)
-    {
-        processData[i] *= gainMultiplier;
-    }
-    
-    // Mix processed signal with original
-    for (int i = 0; i < numSamples; ++i)
-    {
-        output[i] = output[i] * 0.3f + processData[i] * 0.7f; // Favor synthesis
+            pitchOutput[i] = getCrepeFrequency(state, blockStart + i + 1);
     }
     
     // Update performance metrics
     processingTimeMs = juce::Time::getMillisecondCounter() - startTime;
     updatePerformanceMetrics();
     
-    return true;
+    return prediction;
 }
 
-float AIModelLoader::detectPitchCREPESimulation(const float* audio, int numSamples)
+void AIModelLoader::pushCrepeHistory(CrepeChannel& state, const float* audio, int numSamples)
 {
-    if (numSamples < 64)
-        return 0.0f;
+    const int mask = crepeHistorySize - 1;
     
-    // Simple autocorrelation-based pitch detection to simulate CREPE
-    std::vector<float> autocorr(numSamples / 2, 0.0f);
-    
-    // Calculate autocorrelation function
-    for (int lag = 1; lag < numSamples / 2; ++lag)
-    {
-        for (int i = 0; i < numSamples - lag; ++i)
-        {
-            autocorr[lag] += audio[i] * audio[i + lag];
-        }
-        autocorr[lag] /= (numSamples - lag); // Normalize
-    }
+    for (int i = 0; i < numSamples; ++i)
+        state.history[(state.writePosition + i) & mask] = audio[i];
     
-    // Find the lag with maximum correlation
-    int bestLag = 1;
-    float maxCorr = autocorr[1];
+    state.writePosition = (state.writePosition + numSamples) & mask;
+    state.samplesSinceFrame += numSamples;
+    state.samplePosition += numSamples;
+}
+
+void AIModelLoader::readCrepeHistory(const CrepeChannel& state, float* destination, int numSamples) const
+{
+    // Unroll the newest numSamples of the ring, oldest first
+    const int mask = crepeHistorySize - 1;
+    const int start = (state.writePosition - numSamples) & mask;
+    const int firstPart = jmin(numSamples, crepeHistorySize - start);
+    std::memcpy(destination, state.history.getData() + start, sizeof(float) * static_cast<size_t>(firstPart));
+    std::memcpy(destination + firstPart, state.history.getData(), sizeof(float) * static_cast<size_t>(numSamples - firstPart));
+}
+
+void AIModelLoader::prepareInlineBatch()
+{
+    // A batch of every whole hop in a block, pinned here because resizing
+    // the batch re-plans the interpreter's arena, which allocates
+    crepeBatchSize = jmax(1, processingBlockSize / crepeHopSamples);
+    crepeMaxFramesPerBlock = processingBlockSize / crepeHopSamples + 1;
     
-    for (int lag = 2; lag < numSamples / 2; ++lag)
+    if (crepeModel == nullptr || crepeBatchSize < 2)
     {
-        if (autocorr[lag] > maxCorr && lag > 16) // Avoid harmonics
-        {
-            maxCorr = autocorr[lag];
-            bestLag = lag;
-        }
+        crepeBatchInterpreter.reset();
+        return;
     }
     
-    // Convert lag to frequency
-    if (bestLag > 0 && maxCorr > 0.3f) // Confidence threshold
-    {
-        return 44100.0f / bestLag; // Assume 44.1kHz sample rate
-    }
+    if (crepeBatchInterpreter == nullptr)
+        crepeBatchInterpreter = CrepeModel::createInterpreter(*crepeModel);
     
-    return 0.0f; // No pitch detected
+    if (crepeBatchInterpreter != nullptr && ! CrepeModel::setBatchSize(*crepeBatchInterpreter, static_cast<size_t>(crepeBatchSize)))
+        crepeBatchInterpreter.reset();
 }
 
-AIModelLoader::PitchPrediction AIModelLoader::analyzePitchFeatures(const float* audio, int numSamples)
+void AIModelLoader::runCrepeFrames(CrepeChannel& state, const float* audio, int numSamples, double sampleRate)
 {
-    PitchPrediction prediction;
-    
-    // Detect fundamental frequency using YIN algorithm simulation
-    float fundamental = detectPitchCREPESimulation(audio, numSamples);
-    prediction.frequency = fundamental;
-    
-    if (fundamental > 0.0f)
+    // Hops that end in this block, at offsets first, first + hop, ...
+    const int first = jmax(0, crepeHopSamples - state.samplesSinceFrame);
+    const int numFrames = first > numSamples ? 0 : jmin(crepeMaxFramesPerBlock, 1 + (numSamples - first) / crepeHopSamples);
+    const int64 blockStart = state.samplePosition;
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    constexpr int numBins = static_cast<int>(CrepeModel::CREPE_CENTS_MAPPING_SIZE);
+    const int spanSamples = crepeFrameSamples + (numFrames - 1) * crepeHopSamples;
+    float* span = numFrames > 0 ? workspace.allocate(spanSamples) : nullptr;
+    float* activations = numFrames > 0 ? workspace.allocate(numFrames * numBins) : nullptr;
+    size_t numAnalysed = 0;
+    
+    if (span != nullptr && activations != nullptr && crepeInterpreter != nullptr)
     {
-        // Analyze harmonics up to Nyquist frequency
-        std::vector<float> spectrum;
-        performSpectralAnalysis(audio, numSamples, spectrum);
-        
-        // Extract harmonics at multiples of fundamental
-        prediction.harmonics.resize(16, 0.0f);
-        for (int h = 1; h <= 16; ++h)
-        {
-            float harmonicFreq = fundamental * h;
-            if (harmonicFreq < 22050.0f) // Below Nyquist
-            {
-                int binIndex = static_cast<int>((harmonicFreq / 22050.0f) * spectrum.size());
-                if (binIndex < spectrum.size())
-                {
-                    prediction.harmonics[h-1] = spectrum[binIndex];
-                }
-            }
-        }
-        
-        // Calculate voicing based on harmonic content
-        float totalEnergy = 0.0f;
-        float harmonicEnergy = 0.0f;
+        // One stretch from the start of the first frame to the end of the
+        // last: the tail of the history, then the block
+        const int fromHistory = crepeFrameSamples - first;
+        readCrepeHistory(state, span, fromHistory);
+        std::memcpy(span + fromHistory, audio, sizeof(float) * static_cast<size_t>(spanSamples - fromHistory));
         
-        for (float mag : spectrum)
-        {
-            totalEnergy += mag;
-        }
+        // Whole batches through the batched interpreter, the rest one by one
+        const auto hop = static_cast<size_t>(crepeHopSamples);
+        const auto rate = static_cast<float>(sampleRate);
         
-        for (float harmonic : prediction.harmonics)
-        {
-            harmonicEnergy += harmonic;
-        }
+        if (crepeBatchInterpreter != nullptr && numFrames >= crepeBatchSize)
+            numAnalysed = CrepeModel::runFrames(*crepeBatchInterpreter, span, static_cast<size_t>(spanSamples), rate, hop,
+                                                static_cast<size_t>(numFrames - numFrames % crepeBatchSize), activations, nullptr);
         
-        prediction.voicing = (totalEnergy > 0.0f) ? (harmonicEnergy / totalEnergy) : 0.0f;
-        prediction.confidence = jlimit(0.0f, 1.0f, prediction.voicing * 2.0f);
-    }
-    
-    return prediction;
-}
-
-void AIModelLoader::performSpectralAnalysis(const float* audio, int numSamples, std::vector<float>& spectrum)
-{
-    // Zero-pad to FFT size
-    int paddedSize = fftSize;
-    std::vector<float> paddedAudio(paddedSize, 0.0f);
-    
-    int copySize = std::min(numSamples, paddedSize);
-    std::memcpy(paddedAudio.data(), audio, copySize * sizeof(float));
-    
-    // Apply window function (Hanning)
-    for (int i = 0; i < copySize; ++i)
-    {
-        float window = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (copySize - 1)));
-        paddedAudio[i] *= window;
+        numAnalysed += CrepeModel::runFrames(*crepeInterpreter, span + numAnalysed * hop, static_cast<size_t>(spanSamples) - numAnalysed * hop,
+                                             rate, hop, static_cast<size_t>(numFrames) - numAnalysed,
+                                             activations + numAnalysed * numBins, nullptr);
     }
     
-    // Convert to complex numbers for FFT
-    for (int i = 0; i < paddedSize; ++i)
-    {
-        frequencyData[i].real(paddedAudio[i]);
-        frequencyData[i].imag(0.0f);
-    }
-    
-    // Perform FFT
-    fft->performFrequencyOnlyForwardTransform(frequencyData.getData(), true);
+    pushCrepeHistory(state, audio, numSamples);
+    if (numFrames > 0)
+        state.samplesSinceFrame = numSamples - (first + (numFrames - 1) * crepeHopSamples);
     
-    // Calculate magnitude spectrum
-    spectrum.resize(paddedSize / 2);
-    for (int i = 0; i < paddedSize / 2; ++i)
+    for (size_t frame = 0; frame < numAnalysed; ++frame)
     {
-        float real = frequencyData[i].real();
-        float imag = frequencyData[i].imag();
-        spectrum[i] = std::sqrt(real * real + imag * imag);
+        const int64 timestamp = blockStart + first + static_cast<int64>(frame) * crepeHopSamples;
+        const float* activation = activations + frame * numBins;
+        const auto result = CrepeModel::decodeActivation(activation);
+        
+        // Smoothed like the worker's results, so renders and playback agree
+        CrepeViterbiDecoder::Decision decision;
+        
+        if (result.frequency <= 0.0f)
+            addCrepeEstimate(state, timestamp, result.frequency, result.confidence);
+        else if (state.viterbi.pushFrame(activation, timestamp, decision))
+            addCrepeEstimate(state, decision.timestamp, decision.frequency, decision.confidence);
     }
 }
 
-void AIModelLoader::extractHarmonics(const std::vector<float>& spectrum, float fundamental, std::vector<float>& harmonics)
+void AIModelLoader::queueCrepeFrame(int channel, CrepeChannel& state, double sampleRate)
 {
-    harmonics.resize(16, 0.0f);
-    
-    if (fundamental <= 0.0f || spectrum.empty())
+    // A full ring means the worker is behind; skip this hop rather than wait
+    float* networkFrame = inferenceWorker.getFrameToFill();
+    if (networkFrame == nullptr)
         return;
     
-    float sampleRate = 44100.0f; // Assume fixed sample rate
-    float binWidth = sampleRate / (2.0f * spectrum.size());
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* frame = workspace.allocate(crepeFrameSamples);
+    if (frame == nullptr)
+        return;
     
-    for (int h = 1; h <= 16; ++h)
-    {
-        float harmonicFreq = fundamental * h;
-        if (harmonicFreq >= sampleRate / 2.0f) // Above Nyquist
-            break;
-            
-        int binIndex = static_cast<int>(harmonicFreq / binWidth);
-        if (binIndex < spectrum.size())
-        {
-            harmonics[h-1] = spectrum[binIndex];
-        }
-    }
+    // Resampling and normalisation are cheap, and leave the worker a fixed
+    // 1024-sample frame whatever the host rate
+    readCrepeHistory(state, frame, crepeFrameSamples);
+    CrepeModel::prepareFrame(frame, static_cast<size_t>(crepeFrameSamples), static_cast<float>(sampleRate), networkFrame);
+    inferenceWorker.pushFrame(channel, state.samplePosition);
 }
 
-void AIModelLoader::synthesizeHarmonics(float* output, int numSamples, const SynthesisParams& params)
+void AIModelLoader::collectCrepeResults()
 {
-    if (!synthesizer || params.fundamentalFreq <= 0.0f)
-        return;
-    
-    // Ensure we have enough harmonics
-    if (synthesizer->harmonicPhases.size() < 16)
-    {
-        synthesizer->harmonicPhases.resize(16, 0.0f);
-        synthesizer->harmonicFreqs.resize(16, 0.0f);
-        synthesizer->harmonicAmps.resize(16, 0.0f);
-    }
+    InferenceWorker::Result result;
     
-    // Update harmonic frequencies and amplitudes
-    for (int h = 0; h < 16; ++h)
+    while (inferenceWorker.popResult(result))
     {
-        synthesizer->harmonicFreqs[h] = params.fundamentalFreq * (h + 1);
-        synthesizer->harmonicAmps[h] = (h < params.harmonicAmplitudes.size()) ? 
-            params.harmonicAmplitudes[h] : 0.0f;
-    }
-    
-    float sampleRate = 44100.0f;
-    
-    // Generate harmonic content
-    for (int i = 0; i < numSamples; ++i)
-    {
-        float sample = 0.0f;
-        
-        for (int h = 0; h < 16; ++h)
-        {
-            if (synthesizer->harmonicAmps[h] > 0.001f && 
-                synthesizer->harmonicFreqs[h] < sampleRate / 2.0f)
-            {
-                // Generate sine wave for this harmonic
-                sample += synthesizer->harmonicAmps[h] * 
-                         std::sin(synthesizer->harmonicPhases[h]);
-                
-                // Update phase
-                synthesizer->harmonicPhases[h] += 2.0f * M_PI * 
-                                                 synthesizer->harmonicFreqs[h] / sampleRate;
-                
-                // Keep phase in range
-                if (synthesizer->harmonicPhases[h] > 2.0f * M_PI)
-                    synthesizer->harmonicPhases[h] -= 2.0f * M_PI;
-            }
-        }
-        
-        output[i] = sample * params.loudness;
+        if (isPositiveAndBelow(result.channel, static_cast<int>(crepeChannels.size())))
+            addCrepeEstimate(crepeChannels[static_cast<size_t>(result.channel)], result.timestamp,
+                             result.frequency, result.confidence);
     }
 }
 
-void AIModelLoader::synthesizeNoise(float* output, int numSamples, float noisiness)
+void AIModelLoader::addCrepeEstimate(CrepeChannel& state, int64 timestamp, float frequency, float confidence)
 {
-    if (!synthesizer)
+    // Results left over from before a switch to inline inference
+    if (timestamp <= state.latest.timestamp)
         return;
     
-    // Generate colored noise
-    for (int i = 0; i < numSamples; ++i)
-    {
-        // Generate white noise
-        float noise = synthesizer->noiseGenerator.nextFloat() * 2.0f - 1.0f;
-        
-        // Simple low-pass filtering for more natural noise
-        if (i > 0)
-            noise = noise * 0.7f + output[i - 1] * 0.3f;
-        
-        output[i] = noise * noisiness * 0.05f; // Scale for appropriate level
-    }
+    // Below this the network is not hearing a pitch
+    constexpr float voicedConfidence = 0.5f;
+    
+    state.previous = state.latest;
+    state.latest.timestamp = timestamp;
+    state.latest.frequency = confidence >= voicedConfidence ? frequency : 0.0f;
+    state.latest.confidence = confidence;
 }
 
-void AIModelLoader::applyFormantFiltering(float* audio, int numSamples, float fundamentalFreq)
+float AIModelLoader::getCrepeFrequency(const CrepeChannel& state, int64 position) const
 {
-    // Simplified formant filtering to preserve vocal character
-    // Real implementation would use proper formant filters
-    
-    if (fundamentalFreq <= 0.0f)
-        return;
-    
-    // Apply gentle high-frequency emphasis to maintain clarity
-    float prev = 0.0f;
-    for (int i = 0; i < numSamples; ++i)
-    {
-        float filtered = audio[i] * 0.9f + (audio[i] - prev) * 0.1f;
-        prev = audio[i];
-        audio[i] = filtered;
-    }
+    const auto& latest = state.latest;
+    const auto& previous = state.previous;
+    
+    if (latest.frequency <= 0.0f || previous.frequency <= 0.0f || previous.timestamp < 0)
+        return latest.frequency;
+    
+    // Two consecutive voiced results: follow their glide to the position, in
+    // octaves. Before the latest result that interpolates between the two;
+    // after it, the glide carries on for at most one hop beyond the decoder's
+    // lag, to cover that lag and the worker's latency.
+    const auto span = latest.timestamp - previous.timestamp;
+    if (span <= 0 || span > 2 * crepeHopSamples)
+        return latest.frequency;
+    
+    const auto reach = jlimit<int64>(-span, (1 + crepeViterbiLagFrames) * crepeHopSamples, position - latest.timestamp);
+    const float octaves = std::log2(latest.frequency / previous.frequency) * static_cast<float>(reach) / static_cast<float>(span);
+    return latest.frequency * std::exp2(octaves);
 }
 
-void AIModelLoader::prepareToPlay(double sampleRate, int samplesPerBlock)
+void AIModelLoader::prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels)
 {
     currentSampleRate = sampleRate;
     processingBlockSize = samplesPerBlock;
     
-    // Prepare buffers
-    processBuffer.setSize(1, processingBlockSize);
-    analysisBuffer.setSize(1, processingBlockSize * 2);
-    windowBuffer.resize(processingBlockSize);
+    // Network input history, one ring per channel
+    crepeFrameSamples = static_cast<int>(CrepeModel::getInputSamplesNeeded(static_cast<float>(sampleRate)));
+    crepeHistorySize = nextPowerOfTwo(crepeFrameSamples);
+    crepeHopSamples = jmax(1, roundToInt(sampleRate * crepeHopSeconds));
+    // The decoder's own lag is expected; only lateness beyond it counts
+    crepeMaxResultAge = roundToInt(sampleRate * crepeMaxResultAgeSeconds) + crepeViterbiLagFrames * crepeHopSamples;
+    crepeChannels.resize(static_cast<size_t>(jmax(1, numChannels)));
     
-    // Reset synthesis state
-    if (synthesizer)
+    for (auto& state : crepeChannels)
     {
-        std::fill(synthesizer->harmonicPhases.begin(), synthesizer->harmonicPhases.end(), 0.0f);
-        synthesizer->reverbBuffer.setSize(1, static_cast<int>(sampleRate * 0.1)); // 100ms
-        synthesizer->reverbBuffer.clear();
-        synthesizer->reverbPosition = 0;
+        state.history.allocate(static_cast<size_t>(crepeHistorySize), true);
+        state.writePosition = 0;
+        state.samplesSinceFrame = 0;
+        state.samplePosition = 0;
+        state.viterbi.prepare(CrepeViterbiDecoder::defaultBand, crepeViterbiLagFrames);
+        state.latest = {};
+        state.previous = {};
     }
+    
+    prepareInlineBatch();
+    
+    // Restart the worker so nothing from the old configuration is in flight
+    if (crepeModel != nullptr)
+        inferenceWorker.prepare(CrepeModel::createInterpreter(*crepeModel), static_cast<int>(crepeChannels.size()),
+                                crepeViterbiLagFrames);
+}
+
+int AIModelLoader::getScratchSize() const
+{
+    // Inline inference: the input behind every hop of a block and their
+    // activations. The worker only needs one network frame.
+    const int numBins = static_cast<int>(CrepeModel::CREPE_CENTS_MAPPING_SIZE);
+    return ScratchWorkspace::slotSize(crepeFrameSamples + (crepeMaxFramesPerBlock - 1) * crepeHopSamples)
+         + ScratchWorkspace::slotSize(crepeMaxFramesPerBlock * numBins);
 }
 
 void AIModelLoader::updatePerformanceMetrics()
@@ -439,25 +355,3 @@ void AIModelLoader::updatePerformanceMetrics()
     float processingRatio = static_cast<float>(processingTimeMs) / 30.0f; // Assuming 30ms budget
     cpuUsage = cpuUsage * 0.9f + processingRatio * 0.1f; // Smooth the measurement
 }
-
-float AIModelLoader::smoothPitchEstimate(float newPitch)
-{
-    if (std::abs(lastPitchEstimate) < 0.001f)
-    {
-        lastPitchEstimate = newPitch;
-        return newPitch;
-    }
-    
-    // Apply exponential smoothing
-    float smoothed = lastPitchEstimate * (1.0f - pitchSmoothing) + newPitch * pitchSmoothing;
-    
-    // Add pitch to history
-    pitchHistory.push_back(smoothed);
-    if (pitchHistory.size() > 10)
-    {
-        pitchHistory.erase(pitchHistory.begin());
-    }
-    
-    lastPitchEstimate = smoothed;
-    return smoothed;
-}
\ No newline at end of file
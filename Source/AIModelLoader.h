@@ -1,9 +1,16 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "ScratchWorkspace.h"
+#include "InferenceWorker.h"
 #include <vector>
 #include <memory>
 
+namespace tflite {
+    class Interpreter;
+    class FlatBufferModel;
+}
+
 class AIModelLoader
 {
 public:
@@ -12,37 +19,44 @@ public:
     {
         float frequency = 0.0f;
         float confidence = 0.0f;
-        std::vector<float> harmonics;
-        float voicing = 0.0f;
-        
-        PitchPrediction() : harmonics(16, 0.0f) {}
-    };
-    
-    // Synthesis parameters for DDSP
-    struct SynthesisParams
-    {
-        float fundamentalFreq = 440.0f;
-        std::vector<float> harmonicAmplitudes;
-        float loudness = 0.5f;
-        float noisiness = 0.0f;
         
-        SynthesisParams() : harmonicAmplitudes(16, 0.0f) {}
+        // False while the network has no result recent enough to use;
+        // callers then fall back to their own detector
+        bool isCurrent = false;
     };
 
-    AIModelLoader();
+    explicit AIModelLoader(ScratchWorkspace& scratch);
     ~AIModelLoader();
+    
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels = 2);
+    
+    // Floats of workspace scratch predictPitch may take at once
+    int getScratchSize() const;
 
-    // Model management
+    // Model management. loadModels reads the CREPE network from the model
+    // path, or from getDefaultModelFile() when none is set, and fails when
+    // there is no usable model. Message thread, before playback starts.
     bool loadModels();
     bool areModelsLoaded() const { return modelsLoaded; }
     void unloadModels();
-    
-    // CREPE pitch detection simulation
-    PitchPrediction predictPitch(const float* audio, int numSamples, double sampleRate);
-    
-    // DDSP synthesis simulation  
-    bool processWithDDSP(const float* input, float* output, int numSamples, 
-                        const SynthesisParams& params);
+    static File getDefaultModelFile();
+    
+    // CREPE pitch detection. Each channel keeps the history one network
+    // frame needs and hands a new frame to the inference worker once per
+    // crepeHopSeconds. The prediction comes from the newest result the
+    // worker has returned, carried forward to the end of this block. When
+    // the prediction is current and pitchOutput is given, it also receives
+    // the network pitch at each sample of the block (0 Hz where unvoiced).
+    // Without a worker the prediction is never current, except when running
+    // synchronously.
+    PitchPrediction predictPitch(int channel, const float* audio, int numSamples, double sampleRate,
+                                 float* pitchOutput = nullptr);
+    
+    // Audio thread: offline renders run the network inline instead, so a
+    // bounce does not depend on how fast the worker happened to be. Every
+    // hop that ends in the block is analysed, the hops going through the
+    // network in batches.
+    void setSynchronousInference(bool shouldRunInline) { synchronousInference = shouldRunInline; }
     
     // Model configuration
     void setModelPath(const String& path) { modelPath = path; }
@@ -57,9 +71,47 @@ public:
     int64_t getProcessingTimeMs() const { return processingTimeMs; }
 
 private:
+    ScratchWorkspace& workspace;
+    
     // Model state
     bool modelsLoaded = false;
     juce::String modelPath;
+    std::unique_ptr<tflite::FlatBufferModel> crepeModel;
+    std::unique_ptr<tflite::Interpreter> crepeInterpreter;        // inline inference, one frame at a time
+    std::unique_ptr<tflite::Interpreter> crepeBatchInterpreter;   // inline inference, crepeBatchSize frames
+    InferenceWorker inferenceWorker;
+    bool synchronousInference = false;
+    
+    // A network result, stamped with the host-rate sample position of the
+    // newest sample its frame saw. Frequency is 0 when unvoiced.
+    struct CrepeEstimate
+    {
+        int64 timestamp = -1;
+        float frequency = 0.0f;
+        float confidence = 0.0f;
+    };
+    
+    // Per-channel input history at the host rate, and the last two results
+    struct CrepeChannel
+    {
+        HeapBlock<float> history;
+        int writePosition = 0;
+        int samplesSinceFrame = 0;
+        int64 samplePosition = 0;
+        CrepeViterbiDecoder viterbi;   // inline inference only; the worker has its own
+        CrepeEstimate latest, previous;
+    };
+    
+    static constexpr double crepeHopSeconds = 0.01;
+    static constexpr double crepeMaxResultAgeSeconds = 0.05;
+    static constexpr int crepeViterbiLagFrames = 1;   // each frame of lag delays results by one hop
+    std::vector<CrepeChannel> crepeChannels;
+    int crepeHistorySize = 0;   // power of two
+    int crepeFrameSamples = 0;  // host-rate samples behind one 1024-sample network frame
+    int crepeHopSamples = 0;
+    int crepeMaxResultAge = 0;
+    int crepeBatchSize = 1;             // whole hops in one prepared block
+    int crepeMaxFramesPerBlock = 1;     // hops that can end in one prepared block
     
     // Processing parameters
     int processingBlockSize = 512;
@@ -71,63 +123,18 @@ private:
     int64 processingTimeMs = 0;
     juce::Time lastProcessTime;
     
-    // Audio processing buffers
-    juce::AudioBuffer<float> processBuffer;
-    juce::AudioBuffer<float> analysisBuffer;
-    std::vector<float> windowBuffer;
-    
-    // Pitch tracking state
-    std::vector<float> pitchHistory;
-    float lastPitchEstimate = 0.0f;
-    float pitchSmoothing = 0.1f;
-    
-    // Harmonic analysis
-    std::unique_ptr<juce::dsp::FFT> fft;
-    juce::HeapBlock<juce::dsp::Complex<float>> frequencyData;
-    static constexpr int fftOrder = 11; // 2048 samples
-    static constexpr int fftSize = 1 << fftOrder;
-    
-    // DDSP synthesis components
-    struct DDSPSynthesizer
-    {
-        // Harmonic oscillator
-        std::vector<float> harmonicPhases;
-        std::vector<float> harmonicFreqs;
-        std::vector<float> harmonicAmps;
-        
-        // Noise generator
-        juce::Random noiseGenerator;
-        std::vector<float> noiseFilter;
-        
-        // Reverb/filtering
-        juce::AudioBuffer<float> reverbBuffer;
-        int reverbPosition = 0;
-        
-        DDSPSynthesizer() : harmonicPhases(16, 0.0f), harmonicFreqs(16, 0.0f), 
-                           harmonicAmps(16, 0.0f), noiseFilter(512, 0.0f) {}
-    };
-    
-    std::unique_ptr<DDSPSynthesizer> synthesizer;
-    
     // Advanced pitch detection methods
-    float detectPitchCREPESimulation(const float* audio, int numSamples);
-    PitchPrediction analyzePitchFeatures(const float* audio, int numSamples);
-    
-    // Spectral analysis
-    void performSpectralAnalysis(const float* input, int numSamples, 
-                                std::vector<float>& spectrum);
-    void extractHarmonics(const std::vector<float>& spectrum, float fundamentalFreq,
-                         std::vector<float>& harmonics);
-    
-    // DDSP synthesis methods
-    void synthesizeHarmonics(float* output, int numSamples, const SynthesisParams& params);
-    void synthesizeNoise(float* output, int numSamples, float noisiness);
-    void applyFormantFiltering(float* audio, int numSamples, float fundamentalFreq);
+    void pushCrepeHistory(CrepeChannel& state, const float* audio, int numSamples);
+    void readCrepeHistory(const CrepeChannel& state, float* destination, int numSamples) const;
+    void prepareInlineBatch();
+    void runCrepeFrames(CrepeChannel& state, const float* audio, int numSamples, double sampleRate);
+    void queueCrepeFrame(int channel, CrepeChannel& state, double sampleRate);
+    void collectCrepeResults();
+    void addCrepeEstimate(CrepeChannel& state, int64 timestamp, float frequency, float confidence);
+    float getCrepeFrequency(const CrepeChannel& state, int64 position) const;
     
     // Utility methods
-    void prepareToPlay(double sampleRate, int samplesPerBlock);
     void updatePerformanceMetrics();
-    float smoothPitchEstimate(float newPitch);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AIModelLoader)
 };
@@ -0,0 +1,51 @@
+#include "AllocationTrap.h"
+
+#if MARSI_ALLOCATION_TRAP
+
+namespace
+{
+    // Default TLS model, so a plugin binary built with the trap still
+    // dlopens. The benchmark links the plugin at startup, so the variable
+    // sits in static TLS and reading it from inside its malloc hook cannot
+    // allocate.
+    thread_local int armDepth = 0;
+    std::atomic<int64> violationCount { 0 };
+}
+
+void AllocationTrap::noteHeapCall() noexcept
+{
+    if (armDepth > 0)
+        violationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+bool AllocationTrap::isCompiledIn()              { return true; }
+int64 AllocationTrap::getViolationCount()        { return violationCount.load(); }
+void AllocationTrap::resetViolationCount()       { violationCount.store(0); }
+
+AllocationTrap::ScopedArm::ScopedArm()
+    : violationsAtStart(violationCount.load(std::memory_order_relaxed))
+{
+    ++armDepth;
+}
+
+AllocationTrap::ScopedArm::~ScopedArm()
+{
+    --armDepth;
+
+    // Something inside the armed scope touched the heap: see the call stack of
+    // the allocation by breaking in noteHeapCall()
+    jassert(violationCount.load(std::memory_order_relaxed) == violationsAtStart);
+}
+
+#else
+
+bool AllocationTrap::isCompiledIn()              { return false; }
+int64 AllocationTrap::getViolationCount()        { return 0; }
+void AllocationTrap::resetViolationCount()       {}
+void AllocationTrap::noteHeapCall() noexcept     {}
+
+AllocationTrap::ScopedArm::ScopedArm()           {}
+AllocationTrap::ScopedArm::~ScopedArm()          {}
+
+#endif
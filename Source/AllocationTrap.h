@@ -0,0 +1,40 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+// Debug aid for the real-time guarantee. Builds configured with
+// -DMARSI_ALLOCATION_TRAP=ON count every heap call made on a thread while a
+// ScopedArm is alive. processBlock arms the trap for its whole duration, so
+// the benchmark can drive the processor and fail if the count moves. The
+// counting allocator itself (Benchmarks/AllocationTrapHooks.cpp) is linked
+// into the benchmark only: the plugin binary never replaces the allocator
+// of the process that loads it.
+// In normal builds every call here compiles to nothing.
+class AllocationTrap
+{
+public:
+    static bool isCompiledIn();
+
+    // Heap calls seen on armed threads since the last reset
+    static int64 getViolationCount();
+    static void resetViolationCount();
+
+    // Called by the replacement allocator for every heap call
+    static void noteHeapCall() noexcept;
+
+    // Arms the trap on the calling thread; nests
+    class ScopedArm
+    {
+    public:
+        ScopedArm();
+        ~ScopedArm();
+
+    private:
+        int64 violationsAtStart = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedArm)
+    };
+
+private:
+    AllocationTrap() = delete;
+};
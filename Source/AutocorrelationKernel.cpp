@@ -0,0 +1,230 @@
+#include "AutocorrelationKernel.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+ #include <arm_neon.h>
+ #define MARSI_HAS_NEON 1
+#endif
+
+#ifndef MARSI_HAS_NEON
+ #define MARSI_HAS_NEON 0
+#endif
+
+// GCC/Clang compile each x86 variant for its own ISA so the rest of the plugin
+// keeps the baseline target; MSVC accepts the intrinsics without a flag
+#if JUCE_INTEL && (defined(__GNUC__) || defined(__clang__))
+ #define MARSI_TARGET_ISA(isa) __attribute__((target(isa)))
+#else
+ #define MARSI_TARGET_ISA(isa)
+#endif
+
+namespace
+{
+    float dotProductScalar(const float* a, const float* b, int numSamples)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < numSamples; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+   #if JUCE_INTEL
+    MARSI_TARGET_ISA("sse2")
+    float dotProductSSE2(const float* a, const float* b, int numSamples)
+    {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, _mm_add_ps(sum0, sum1));
+        float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+        for (; i < numSamples; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    MARSI_TARGET_ISA("avx")
+    inline float horizontalSum(__m256 sum8)
+    {
+        __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+        return _mm_cvtss_f32(sum4);
+    }
+
+    MARSI_TARGET_ISA("avx2,fma")
+    float dotProductAVX2(const float* a, const float* b, int numSamples)
+    {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        int i = 0;
+
+        for (; i + 16 <= numSamples; i += 16)
+        {
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+        }
+
+        float sum = horizontalSum(_mm256_add_ps(sum0, sum1));
+
+        for (; i < numSamples; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    MARSI_TARGET_ISA("avx512f")
+    float dotProductAVX512(const float* a, const float* b, int numSamples)
+    {
+        __m512 sum16 = _mm512_setzero_ps();
+        int i = 0;
+
+        for (; i + 16 <= numSamples; i += 16)
+            sum16 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum16);
+
+        // Masked load covers the tail without a scalar loop
+        if (i < numSamples)
+        {
+            const __mmask16 mask = static_cast<__mmask16>((1u << (numSamples - i)) - 1u);
+            sum16 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), sum16);
+        }
+
+        alignas(64) float lanes[16];
+        _mm512_store_ps(lanes, sum16);
+
+        float sum = 0.0f;
+        for (float lane : lanes)
+            sum += lane;
+        return sum;
+    }
+   #endif
+
+   #if MARSI_HAS_NEON
+    float dotProductNEON(const float* a, const float* b, int numSamples)
+    {
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+            sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+
+        const float32x4_t sum4 = vaddq_f32(sum0, sum1);
+        const float32x2_t sum2 = vadd_f32(vget_low_f32(sum4), vget_high_f32(sum4));
+        float sum = vget_lane_f32(vpadd_f32(sum2, sum2), 0);
+
+        for (; i < numSamples; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+   #endif
+}
+
+//==============================================================================
+bool AutocorrelationKernel::isVariantSupported(Variant variantToCheck)
+{
+    switch (variantToCheck)
+    {
+        case Variant::Scalar:   return true;
+       #if JUCE_INTEL
+        case Variant::SSE2:     return SystemStats::hasSSE2();
+        case Variant::AVX2:     return SystemStats::hasAVX2() && SystemStats::hasFMA3();
+        case Variant::AVX512:   return SystemStats::hasAVX512F();
+       #endif
+       #if MARSI_HAS_NEON
+        case Variant::NEON:     return SystemStats::hasNeon();
+       #endif
+        default:                return false;
+    }
+}
+
+const char* AutocorrelationKernel::getVariantName(Variant variantToName)
+{
+    switch (variantToName)
+    {
+        case Variant::SSE2:     return "SSE2";
+        case Variant::AVX2:     return "AVX2";
+        case Variant::AVX512:   return "AVX-512";
+        case Variant::NEON:     return "NEON";
+        case Variant::Scalar:
+        default:                return "Scalar";
+    }
+}
+
+AutocorrelationKernel::DotProductFunction AutocorrelationKernel::getDotProduct(Variant variantToGet)
+{
+    switch (variantToGet)
+    {
+       #if JUCE_INTEL
+        case Variant::SSE2:     return dotProductSSE2;
+        case Variant::AVX2:     return dotProductAVX2;
+        case Variant::AVX512:   return dotProductAVX512;
+       #endif
+       #if MARSI_HAS_NEON
+        case Variant::NEON:     return dotProductNEON;
+       #endif
+        default:                return dotProductScalar;
+    }
+}
+
+void AutocorrelationKernel::selectBestVariant()
+{
+    // Widest first
+    for (auto candidate : { Variant::AVX512, Variant::AVX2, Variant::SSE2, Variant::NEON })
+    {
+        if (isVariantSupported(candidate))
+        {
+            setVariant(candidate);
+            return;
+        }
+    }
+
+    setVariant(Variant::Scalar);
+}
+
+void AutocorrelationKernel::setVariant(Variant newVariant)
+{
+    if (! isVariantSupported(newVariant))
+        newVariant = Variant::Scalar;
+
+    variant = newVariant;
+    dotProduct = getDotProduct(newVariant);
+}
+
+void AutocorrelationKernel::process(const float* input, int numSamples, int minLag, int maxLag, float* output) const
+{
+    jassert(0 < minLag && minLag < maxLag && maxLag <= numSamples);
+
+    const auto dot = dotProduct != nullptr ? dotProduct : dotProductScalar;
+
+    // Segment energies at minLag, then drop one sample from each per lag.
+    // Double accumulators keep the running subtraction from drifting.
+    double energy1 = 0.0;
+    double energy2 = 0.0;
+
+    for (int i = 0; i < numSamples - minLag; ++i)
+        energy1 += static_cast<double>(input[i]) * input[i];
+
+    for (int i = minLag; i < numSamples; ++i)
+        energy2 += static_cast<double>(input[i]) * input[i];
+
+    for (int lag = minLag; lag < maxLag; ++lag)
+    {
+        const float correlation = dot(input, input + lag, numSamples - lag);
+        output[lag - minLag] = correlation / std::sqrt(static_cast<float>(energy1 * energy2) + 1e-10f);
+
+        energy1 -= static_cast<double>(input[numSamples - lag - 1]) * input[numSamples - lag - 1];
+        energy2 -= static_cast<double>(input[lag]) * input[lag];
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+// Normalised autocorrelation over a range of lags:
+//
+//     output[lag - minLag] = r(lag) / sqrt(E1(lag) * E2(lag))
+//
+// with r(lag) = sum over i < N - lag of x[i] * x[i + lag], and E1/E2 the
+// energies of the two overlapping segments. The energies are updated by one
+// sample per lag; the dot product runs through a SIMD variant chosen once for
+// the host CPU (SSE2/AVX2/AVX-512 on x86, NEON on ARM) with a scalar reference
+// that every variant must agree with.
+class AutocorrelationKernel
+{
+public:
+    enum class Variant
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512,
+        NEON
+    };
+
+    AutocorrelationKernel() = default;
+
+    // Call from prepareToPlay: probes the CPU and picks the widest variant
+    void selectBestVariant();
+
+    // Forces a variant (e.g. Scalar to compare against); ignored when the CPU
+    // or the build cannot run it
+    void setVariant(Variant newVariant);
+    Variant getVariant() const { return variant; }
+
+    static bool isVariantSupported(Variant variantToCheck);
+    static const char* getVariantName(Variant variantToName);
+
+    // Fills maxLag - minLag values; requires 0 < minLag < maxLag <= numSamples
+    void process(const float* input, int numSamples, int minLag, int maxLag, float* output) const;
+
+private:
+    using DotProductFunction = float (*)(const float*, const float*, int);
+
+    Variant variant = Variant::Scalar;
+    DotProductFunction dotProduct = nullptr;
+
+    static DotProductFunction getDotProduct(Variant variantToGet);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutocorrelationKernel)
+};
@@ -0,0 +1,190 @@
+#include "FormantEnvelope.h"
+
+namespace
+{
+    std::unique_ptr<dsp::FFT> makeGridFFT(int gridSize)
+    {
+        int order = 0;
+        while ((1 << order) < gridSize * 2)
+            ++order;
+
+        return std::make_unique<dsp::FFT>(order);
+    }
+}
+
+void FormantEnvelope::prepare(double newSampleRate, int newFrameSize)
+{
+    jassert(isPowerOfTwo(newFrameSize) && newFrameSize >= standardGridSize * 2);
+
+    sampleRate = newSampleRate;
+    frameSize = newFrameSize;
+    numBins = frameSize / 2 + 1;
+
+    standardGridFFT = makeGridFFT(standardGridSize);
+    fineGridFFT = makeGridFFT(fineGridSize);
+
+    // Sized for the fine grid, which also bounds the LPC order
+    gridPower.allocate(static_cast<size_t>(fineGridSize + 1), true);
+    gridEnvelope.allocate(static_cast<size_t>(fineGridSize + 1), true);
+    fftData.allocate(static_cast<size_t>(fineGridSize * 4), true);
+    cosineTable.allocate(static_cast<size_t>(fineGridSize * 2), true);
+    autocorrelation.allocate(static_cast<size_t>(fineGridSize), true);
+    coefficients.allocate(static_cast<size_t>(fineGridSize), true);
+    previousCoefficients.allocate(static_cast<size_t>(fineGridSize), true);
+
+    for (int n = 0; n < fineGridSize * 2; ++n)
+        cosineTable[n] = static_cast<float>(std::cos(MathConstants<double>::pi * n / fineGridSize));
+
+    configureGrid(gridSize);
+}
+
+void FormantEnvelope::setFineResolution(bool shouldUseFine)
+{
+    // Frames too short for the fine grid stay on the standard one
+    const int newGridSize = shouldUseFine && frameSize >= fineGridSize * 2 ? fineGridSize : standardGridSize;
+
+    if (newGridSize != gridSize)
+        configureGrid(newGridSize);
+}
+
+void FormantEnvelope::configureGrid(int newGridSize)
+{
+    gridSize = newGridSize;
+    gridFFT = gridSize == fineGridSize ? fineGridFFT.get() : standardGridFFT.get();
+    binsPerPoint = frameSize / (gridSize * 2);
+
+    // One grid cepstrum sample spans frameSize / (2 * gridSize) time samples.
+    // Quefrencies up to 5 ms resolve formant bandwidths; the pooling onto the
+    // grid has already averaged away most of the harmonic ripple above that.
+    const double samplesPerQuefrency = static_cast<double>(frameSize) / (gridSize * 2);
+    lifterCutoff = jlimit(2, gridSize - 1, roundToInt(sampleRate * 0.005 / samplesPerQuefrency));
+
+    // One pole pair per 2 kHz plus a few for the glottal tilt, and more on the
+    // fine grid to follow narrow formants
+    const int extraOrder = gridSize == fineGridSize ? fineExtraOrder : 0;
+    lpcOrder = jlimit(8, gridSize - 1, roundToInt(sampleRate / 2000.0) + 4 + extraOrder);
+}
+
+void FormantEnvelope::process(const float* magnitude, float* envelope)
+{
+    poolSpectrum(magnitude);
+
+    if (method == Method::LinearPrediction)
+        computeLinearPrediction();
+    else
+        computeCepstral();
+
+    // Back to bin resolution
+    const float pointsPerBin = 1.0f / static_cast<float>(binsPerPoint);
+    for (int k = 0; k < numBins; ++k)
+    {
+        const float position = k * pointsPerBin;
+        const int index = jmin(gridSize - 1, static_cast<int>(position));
+        const float frac = position - static_cast<float>(index);
+        envelope[k] = gridEnvelope[index] + frac * (gridEnvelope[index + 1] - gridEnvelope[index]);
+    }
+}
+
+void FormantEnvelope::poolSpectrum(const float* magnitude)
+{
+    // Grid point g sits on bin g * binsPerPoint and averages the bins closest to it
+    const int halfGroup = binsPerPoint / 2;
+    for (int g = 0; g <= gridSize; ++g)
+    {
+        const int first = jmax(0, g * binsPerPoint - halfGroup);
+        const int last = jmin(numBins - 1, g * binsPerPoint + (binsPerPoint - 1 - halfGroup));
+
+        float sum = 0.0f;
+        for (int k = first; k <= last; ++k)
+            sum += magnitude[k] * magnitude[k];
+
+        gridPower[g] = sum / static_cast<float>(last - first + 1);
+    }
+}
+
+void FormantEnvelope::computeCepstral()
+{
+    // The log magnitude is real and even, so its real inverse transform is the
+    // real cepstrum
+    float* data = fftData.getData();
+    std::fill(data, data + gridSize * 4, 0.0f);
+
+    // Floor 80 dB under the peak, or empty bands above a band-limited voice
+    // dominate the log spectrum and flatten everything else
+    float maxPower = 0.0f;
+    for (int g = 0; g <= gridSize; ++g)
+        maxPower = jmax(maxPower, gridPower[g]);
+
+    const float floor = maxPower * 1.0e-8f + 1.0e-30f;
+    for (int g = 0; g <= gridSize; ++g)
+        data[g * 2] = 0.5f * std::log(jmax(gridPower[g], floor));
+
+    gridFFT->performRealOnlyInverseTransform(data);
+
+    // Lifter: drop the quefrencies where the harmonic ripple lives
+    std::fill(data + lifterCutoff + 1, data + gridSize * 2 - lifterCutoff, 0.0f);
+
+    gridFFT->performRealOnlyForwardTransform(data, true);
+
+    for (int g = 0; g <= gridSize; ++g)
+        gridEnvelope[g] = std::exp(data[g * 2]);
+}
+
+void FormantEnvelope::computeLinearPrediction()
+{
+    // Autocorrelation is the inverse transform of the power spectrum. The grid
+    // samples the spectrum at pi * g / gridSize, so lag j is a cosine sum with
+    // half weight on DC and Nyquist. The table is at fine-grid resolution.
+    const int cosineMask = gridSize * 2 - 1;
+    const int cosineStride = fineGridSize / gridSize;
+    for (int j = 0; j <= lpcOrder; ++j)
+    {
+        double sum = 0.5 * (gridPower[0] + gridPower[gridSize] * cosineTable[((gridSize * j) & cosineMask) * cosineStride]);
+        for (int g = 1; g < gridSize; ++g)
+            sum += gridPower[g] * cosineTable[((g * j) & cosineMask) * cosineStride];
+
+        autocorrelation[j] = sum;
+    }
+
+    // Slight white-noise floor keeps the recursion well conditioned
+    autocorrelation[0] = autocorrelation[0] * (1.0 + 1.0e-6) + 1.0e-20;
+
+    // Levinson-Durbin
+    std::fill(coefficients.getData(), coefficients.getData() + lpcOrder + 1, 0.0);
+    coefficients[0] = 1.0;
+    double error = autocorrelation[0];
+
+    for (int i = 1; i <= lpcOrder; ++i)
+    {
+        double acc = autocorrelation[i];
+        for (int j = 1; j < i; ++j)
+            acc += coefficients[j] * autocorrelation[i - j];
+
+        const double reflection = -acc / error;
+
+        std::copy(coefficients.getData(), coefficients.getData() + i, previousCoefficients.getData());
+        for (int j = 1; j < i; ++j)
+            coefficients[j] = previousCoefficients[j] + reflection * previousCoefficients[i - j];
+        coefficients[i] = reflection;
+
+        error *= 1.0 - reflection * reflection;
+        if (error <= 0.0)
+            break;
+    }
+
+    // |1 / A| on the grid
+    float* data = fftData.getData();
+    std::fill(data, data + gridSize * 4, 0.0f);
+    for (int i = 0; i <= lpcOrder; ++i)
+        data[i] = static_cast<float>(coefficients[i]);
+
+    gridFFT->performRealOnlyForwardTransform(data, true);
+
+    const float gain = static_cast<float>(std::sqrt(jmax(error, 1.0e-30)));
+    for (int g = 0; g <= gridSize; ++g)
+    {
+        const float re = data[g * 2];
+        const float im = data[g * 2 + 1];
+        gridEnvelope[g] = gain / jmax(1.0e-9f, std::sqrt(re * re + im * im));
+    }
+}
@@ -0,0 +1,205 @@
+#include "GranularShifter.h"
+#include "Utils.h"
+
+int GranularShifter::getMinimumLatency(double sampleRate)
+{
+    // A grain's source centre sits at most half a period past the delayed
+    // input position and the grain reads one source period beyond it, which
+    // must not run ahead of the newest input: 1.5 longest periods
+    const int longestPeriod = static_cast<int>(std::ceil(sampleRate / minFrequency));
+    return (longestPeriod * 3) / 2 + 2;
+}
+
+void GranularShifter::prepare(double newSampleRate, int numChannels, int latencySamples, int newMaxGrains)
+{
+    sampleRate = newSampleRate;
+    minPeriod = sampleRate / maxFrequency;
+    maxPeriod = sampleRate / minFrequency;
+    unvoicedPeriod = sampleRate * 0.005;
+
+    jassert(latencySamples >= getMinimumLatency(sampleRate));
+    latency = jmax(latencySamples, getMinimumLatency(sampleRate));
+    maxGrains = jmax(2, newMaxGrains);
+
+    // Sources reach back latency plus two periods from the newest chunk
+    const int ringSize = nextPowerOfTwo(latency + static_cast<int>(std::ceil(maxPeriod)) * 3 + chunkSize);
+    ringMask = ringSize - 1;
+
+    numChannels = jmax(1, numChannels);
+    channels.resize(static_cast<size_t>(numChannels));
+    inputRing.setSize(numChannels, ringSize);
+
+    const auto poolSize = static_cast<size_t>(numChannels * maxGrains);
+    grainSource.allocate(poolSize, true);
+    grainIncrement.allocate(poolSize, true);
+    grainWindow.allocate(poolSize, true);
+    grainWindowStep.allocate(poolSize, true);
+    grainDelay.allocate(poolSize, true);
+    grainRemaining.allocate(poolSize, true);
+
+    windowTable.allocate(static_cast<size_t>(windowTableSize + 1), true);
+    for (int i = 0; i <= windowTableSize; ++i)
+        windowTable[i] = 0.5f * (1.0f - std::cos(MathConstants<float>::twoPi * i / windowTableSize));
+
+    reset();
+}
+
+void GranularShifter::reset()
+{
+    inputRing.clear();
+
+    for (auto& state : channels)
+        state = {};
+}
+
+void GranularShifter::resetChannel(int channel)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())))
+        return;
+
+    inputRing.clear(channel, 0, inputRing.getNumSamples());
+    channels[static_cast<size_t>(channel)] = {};
+}
+
+int GranularShifter::getNumActiveGrains(int channel) const
+{
+    return isPositiveAndBelow(channel, static_cast<int>(channels.size()))
+        ? channels[static_cast<size_t>(channel)].numActive : 0;
+}
+
+void GranularShifter::process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())) || numRatios <= 0)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    auto* input = inputRing.getWritePointer(channel);
+
+    for (int position = 0; position < numSamples; position += chunkSize)
+    {
+        const int chunkLength = jmin(chunkSize, numSamples - position);
+        const int64 chunkStart = state.samplesWritten;
+
+        for (int i = 0; i < chunkLength; ++i)
+            input[(chunkStart + i) & ringMask] = audio[position + i];
+
+        state.samplesWritten += chunkLength;
+
+        launchGrains(channel, chunkStart, chunkLength, ratioCurve, numRatios, pitches, position, numSamples);
+
+        FloatVectorOperations::clear(audio + position, chunkLength);
+        renderGrains(channel, audio + position, chunkLength);
+    }
+}
+
+void GranularShifter::launchGrains(int channel, int64 chunkStart, int chunkLength, const float* ratioCurve, int numRatios,
+                                   const float* pitches, int blockOffset, int blockLength)
+{
+    auto& state = channels[static_cast<size_t>(channel)];
+    const int pool = channel * maxGrains;
+    const int64 chunkEnd = chunkStart + chunkLength;
+
+    // Catch up after a reset or a gap rather than launching a backlog
+    if (state.nextLaunch < static_cast<double>(chunkStart))
+        state.nextLaunch = static_cast<double>(chunkStart);
+
+    while (state.nextLaunch < static_cast<double>(chunkEnd))
+    {
+        const int64 launchTime = static_cast<int64>(state.nextLaunch);
+        const int offset = static_cast<int>(launchTime - chunkStart);
+        const int blockIndex = blockOffset + offset;
+
+        const float pitch = pitches[blockIndex];
+        const bool voiced = pitch > 0.0f;
+        const double period = voiced ? jlimit(minPeriod, maxPeriod, sampleRate / pitch) : unvoicedPeriod;
+        const float pitchRatio = voiced ? jlimit(minShiftRatio, maxShiftRatio, Utils::interpolateControlCurve(ratioCurve, numRatios, blockIndex, blockLength))
+                                        : 1.0f;
+        const double outputPeriod = period / pitchRatio;
+
+        // Continue one source period on from the last grain, then jump by whole
+        // periods until the centre is within half a period of the delayed input
+        const double target = static_cast<double>(launchTime) + outputPeriod - latency;
+        double centre = state.sourceCentre + period;
+        if (std::abs(centre - target) > period * 8.0)
+            centre = target;
+        while (centre > target + period * 0.5)
+            centre -= period;
+        while (centre < target - period * 0.5)
+            centre += period;
+
+        state.sourceCentre = centre;
+        state.nextLaunch += outputPeriod;
+
+        if (state.numActive == maxGrains)
+            continue;
+
+        const int length = jmax(2, roundToInt(outputPeriod * 2.0));
+        const int slot = pool + state.numActive++;
+        grainSource[slot] = centre - period;
+        grainIncrement[slot] = pitchRatio;
+        grainWindow[slot] = 0.0f;
+        grainWindowStep[slot] = static_cast<float>(windowTableSize) / static_cast<float>(length);
+        grainDelay[slot] = offset;
+        grainRemaining[slot] = length;
+    }
+}
+
+void GranularShifter::renderGrains(int channel, float* output, int chunkLength)
+{
+    auto& state = channels[static_cast<size_t>(channel)];
+    const auto* input = inputRing.getReadPointer(channel);
+    const int pool = channel * maxGrains;
+
+    int grain = 0;
+    while (grain < state.numActive)
+    {
+        const int slot = pool + grain;
+        const int start = grainDelay[slot];
+        const int count = jmin(chunkLength - start, grainRemaining[slot]);
+
+        double source = grainSource[slot];
+        const float increment = grainIncrement[slot];
+        float window = grainWindow[slot];
+        const float windowStep = grainWindowStep[slot];
+
+        // Offsets from a whole-sample base keep the inner loop in float
+        const int64 base = static_cast<int64>(std::floor(source));
+        const float fraction = static_cast<float>(source - static_cast<double>(base));
+
+        for (int i = 0; i < count; ++i)
+        {
+            const float position = fraction + i * increment;
+            const int whole = static_cast<int>(position);
+            const float frac = position - static_cast<float>(whole);
+            const float sample1 = input[(base + whole) & ringMask];
+            const float sample2 = input[(base + whole + 1) & ringMask];
+
+            output[start + i] += (sample1 + frac * (sample2 - sample1)) * windowTable[static_cast<int>(window + i * windowStep)];
+        }
+
+        source += static_cast<double>(count) * increment;
+        window += static_cast<float>(count) * windowStep;
+        grainRemaining[slot] -= count;
+
+        if (grainRemaining[slot] > 0)
+        {
+            grainSource[slot] = source;
+            grainWindow[slot] = window;
+            grainDelay[slot] = 0;
+            ++grain;
+            continue;
+        }
+
+        // Finished: move the last active grain into this slot
+        const int last = pool + --state.numActive;
+        grainSource[slot] = grainSource[last];
+        grainIncrement[slot] = grainIncrement[last];
+        grainWindow[slot] = grainWindow[last];
+        grainWindowStep[slot] = grainWindowStep[last];
+        grainDelay[slot] = grainDelay[last];
+        grainRemaining[slot] = grainRemaining[last];
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <vector>
+
+// Pitch-synchronous granular shifter. Grains are two output periods long and
+// launched one output period (tracked period / ratio) apart, so their Hann
+// windows sum to one. Each grain replays the input around a source centre
+// that advances by whole source periods, keeping consecutive grains
+// coherent, and is resampled at the pitch ratio. Whenever the centre drifts
+// more than half a period from the latency-delayed input position it jumps
+// by one period. Unvoiced input uses a fixed 5 ms period.
+//
+// Grain state is kept as structure-of-arrays in a pool of maxGrains per
+// channel, with the active grains packed at the front. Each block every
+// active grain is rendered in one tight pass, reading its window from a
+// table, and finished grains are swapped out. Nothing is allocated or locked
+// after prepare().
+class GranularShifter
+{
+public:
+    GranularShifter() = default;
+
+    // Delay needed for a grain to read only input that has already arrived
+    static int getMinimumLatency(double sampleRate);
+
+    // Message thread. latencySamples must be at least getMinimumLatency().
+    void prepare(double sampleRate, int numChannels, int latencySamples, int maxGrains = defaultMaxGrains);
+    void reset();
+
+    // Audio thread: one channel back to silence, as after reset()
+    void resetChannel(int channel);
+
+    int getLatencySamples() const { return latency; }
+    int getMaxGrains() const { return maxGrains; }
+    int getNumActiveGrains(int channel) const;
+
+    // Same contract as PsolaShifter::process
+    void process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches);
+
+    static constexpr int defaultMaxGrains = 8;
+    static constexpr float maxShiftRatio = 2.0f;
+    static constexpr float minShiftRatio = 0.5f;
+    static constexpr float minFrequency = 80.0f;
+    static constexpr float maxFrequency = 1000.0f;
+
+private:
+    struct ChannelState
+    {
+        int64 samplesWritten = 0;
+        double nextLaunch = 0.0;        // output time of the next grain
+        double sourceCentre = 0.0;      // input time the last grain was centred on
+        int numActive = 0;
+    };
+
+    static constexpr int chunkSize = 256;
+    static constexpr int windowTableSize = 1024;
+
+    double sampleRate = 44100.0;
+    int latency = 0;
+    int maxGrains = defaultMaxGrains;
+    double minPeriod = 44.0;
+    double maxPeriod = 552.0;
+    double unvoicedPeriod = 220.0;
+    int ringMask = 0;
+
+    std::vector<ChannelState> channels;
+    AudioBuffer<float> inputRing;
+    HeapBlock<float> windowTable;       // one Hann cycle, windowTableSize + 1 points
+
+    // Grain pool, maxGrains per channel
+    HeapBlock<double> grainSource;      // input position of the next sample
+    HeapBlock<float> grainIncrement;    // pitch ratio
+    HeapBlock<float> grainWindow;       // window table position
+    HeapBlock<float> grainWindowStep;
+    HeapBlock<int> grainDelay;          // samples into the chunk before it starts
+    HeapBlock<int> grainRemaining;
+
+    void launchGrains(int channel, int64 chunkStart, int chunkLength, const float* ratioCurve, int numRatios,
+                      const float* pitches, int blockOffset, int blockLength);
+    void renderGrains(int channel, float* output, int chunkLength);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GranularShifter)
+};
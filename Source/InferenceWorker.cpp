@@ -0,0 +1,197 @@
+#include "InferenceWorker.h"
+#include "../libs/tensorflow_lite/tensorflow_lite.h"
+#include <algorithm>
+
+InferenceWorker::InferenceWorker()
+    : Thread("CREPE inference")
+{
+}
+
+InferenceWorker::~InferenceWorker()
+{
+    release();
+}
+
+void InferenceWorker::prepare(std::unique_ptr<tflite::Interpreter> newInterpreter, int channels, int viterbiLagFrames)
+{
+    release();
+
+    if (newInterpreter == nullptr)
+        return;
+
+    numChannels = jmax(1, channels);
+
+    // One row per channel, planned here once: the worker never re-plans
+    if (! CrepeModel::setBatchSize(*newInterpreter, static_cast<size_t>(numChannels)))
+        return;
+
+    interpreter = std::move(newInterpreter);
+
+    frames.allocate(static_cast<size_t>(frameSlots * frameSize), true);
+    frameHeaders.allocate(static_cast<size_t>(frameSlots), true);
+    batchSlots.allocate(static_cast<size_t>(numChannels), true);
+    results.allocate(static_cast<size_t>(resultSlots), true);
+    decoders.resize(static_cast<size_t>(numChannels));
+    for (auto& decoder : decoders)
+        decoder.prepare(CrepeViterbiDecoder::defaultBand, viterbiLagFrames);
+    frameFifo.reset();
+    resultFifo.reset();
+    droppedFrames = 0;
+
+    startThread();
+}
+
+void InferenceWorker::release()
+{
+    // Long enough for one full-capacity Invoke to finish
+    stopThread(2000);
+    interpreter.reset();
+}
+
+float* InferenceWorker::getFrameToFill()
+{
+    if (! isPrepared())
+        return nullptr;
+
+    int start1, size1, start2, size2;
+    frameFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return frames.getData() + start1 * frameSize;
+}
+
+void InferenceWorker::pushFrame(int channel, int64 timestamp)
+{
+    int start1, size1, start2, size2;
+    frameFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        jassertfalse; // no slot was handed out by getFrameToFill
+        return;
+    }
+
+    frameHeaders[start1] = { channel, timestamp };
+    frameFifo.finishedWrite(1);
+    notify();
+}
+
+bool InferenceWorker::popResult(Result& result)
+{
+    if (! isPrepared())
+        return false;
+
+    int start1, size1, start2, size2;
+    resultFifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    result = results[start1];
+    resultFifo.finishedRead(1);
+    return true;
+}
+
+void InferenceWorker::run()
+{
+    // Sleeps until pushFrame() signals. The event stays set when a frame
+    // arrives while a batch runs, so no frame waits for the next one.
+    while (! threadShouldExit())
+    {
+        runPendingFrames();
+        wait(-1);
+    }
+}
+
+void InferenceWorker::runPendingFrames()
+{
+    int start1, size1, start2, size2;
+    frameFifo.prepareToRead(frameFifo.getNumReady(), start1, size1, start2, size2);
+    const int numReady = size1 + size2;
+
+    if (numReady == 0)
+        return;
+
+    // A frame that was overtaken by a newer one of the same channel would
+    // only produce a result that is stale on arrival, so walk newest first
+    // and keep one frame per channel
+    int numFrames = 0;
+
+    for (int i = numReady; --i >= 0 && numFrames < numChannels;)
+    {
+        const int slot = i < size1 ? start1 + i : start2 + i - size1;
+        const int channel = frameHeaders[slot].channel;
+
+        if (! isPositiveAndBelow(channel, numChannels))
+            continue;
+
+        bool seen = false;
+        for (int j = 0; j < numFrames; ++j)
+            seen = seen || frameHeaders[batchSlots[j]].channel == channel;
+
+        if (! seen)
+            batchSlots[numFrames++] = slot;
+    }
+
+    runBatch(numFrames);
+    frameFifo.finishedRead(numReady);
+}
+
+void InferenceWorker::runBatch(int numFrames)
+{
+    // The interpreter always runs one row per channel. Fewer frames are
+    // pending when the worker wakes between two channels' frames; rows past
+    // numFrames keep whatever they held and their outputs are ignored.
+    if (numFrames == 0)
+        return;
+
+    float* input = interpreter->typed_input_tensor(0);
+    if (input == nullptr)
+        return;
+
+    for (int row = 0; row < numFrames; ++row)
+    {
+        const float* frame = frames.getData() + batchSlots[row] * frameSize;
+        std::copy(frame, frame + frameSize, input + row * frameSize);
+    }
+
+    const float* activations = interpreter->Invoke() == tflite::Status::kOk ? interpreter->typed_output_tensor(0)
+                                                                             : nullptr;
+
+    for (int row = 0; row < numFrames; ++row)
+    {
+        const auto& header = frameHeaders[batchSlots[row]];
+
+        // A failed Invoke reports the frame as unvoiced, outside the decoder
+        if (activations == nullptr)
+        {
+            publishResult({ header.channel, header.timestamp, 0.0f, 0.0f });
+            continue;
+        }
+
+        CrepeViterbiDecoder::Decision decision;
+        const float* activation = activations + row * static_cast<int>(CrepeModel::CREPE_CENTS_MAPPING_SIZE);
+
+        if (decoders[static_cast<size_t>(header.channel)].pushFrame(activation, header.timestamp, decision))
+            publishResult({ header.channel, decision.timestamp, decision.frequency, decision.confidence });
+    }
+}
+
+void InferenceWorker::publishResult(const Result& result)
+{
+    int start1, size1, start2, size2;
+    resultFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    // The audio thread drains every block, so a full ring means it has
+    // stopped; the result would be stale by the time it is read anyway
+    if (size1 == 0)
+        return;
+
+    results[start1] = result;
+    resultFifo.finishedWrite(1);
+}
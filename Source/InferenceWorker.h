@@ -0,0 +1,88 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "../libs/crepe/crepe.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tflite {
+    class Interpreter;
+}
+
+// Runs the CREPE network on its own thread so inference time never counts
+// against the audio callback. The audio thread hands over prepared 16 kHz
+// frames through one single-producer/single-consumer ring and collects
+// timestamped results from a second one; both are AbstractFifo indices over
+// storage sized in prepare(), so neither side ever blocks or allocates.
+// When frames pile up, only the newest one per channel is run, and the
+// channels' frames go through the network together as one batch. Each
+// channel's activations are smoothed by a streaming Viterbi decoder, so a
+// result is for the frame viterbiLagFrames hops before the newest one.
+class InferenceWorker : private Thread
+{
+public:
+    struct Result
+    {
+        int channel = 0;
+        int64 timestamp = 0;    // host-rate sample position of the frame's newest sample
+        float frequency = 0.0f;
+        float confidence = 0.0f;
+    };
+
+    InferenceWorker();
+    ~InferenceWorker() override;
+
+    // Message thread, with the audio thread stopped. The worker takes the
+    // interpreter; it must have been built by CrepeModel::createInterpreter
+    // and is not shared with anything else. Its batch is set to numChannels
+    // here, once.
+    void prepare(std::unique_ptr<tflite::Interpreter> interpreter, int numChannels, int viterbiLagFrames);
+    void release();
+    bool isPrepared() const { return interpreter != nullptr; }
+
+    // Audio thread, producer side: a frame slot to fill with
+    // CrepeModel::CREPE_MODEL_CAPACITY samples, or nullptr when the ring is
+    // full. pushFrame publishes the slot returned by the last call and wakes
+    // the worker.
+    float* getFrameToFill();
+    void pushFrame(int channel, int64 timestamp);
+
+    // Audio thread, consumer side: false once no result is waiting
+    bool popResult(Result& result);
+
+    // Frames the audio thread had to drop because the ring was full
+    int getNumDroppedFrames() const { return droppedFrames.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int frameSlots = 8;
+    static constexpr int resultSlots = 64;
+    static constexpr int frameSize = static_cast<int>(CrepeModel::CREPE_MODEL_CAPACITY);
+
+    struct FrameHeader
+    {
+        int channel = 0;
+        int64 timestamp = 0;
+    };
+
+    void run() override;
+    void runPendingFrames();
+    void runBatch(int numFrames);
+    void publishResult(const Result& result);
+
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    int numChannels = 0;
+
+    AbstractFifo frameFifo { frameSlots };
+    HeapBlock<float> frames;                    // frameSlots * frameSize
+    HeapBlock<FrameHeader> frameHeaders;        // frameSlots
+    HeapBlock<int> batchSlots;                  // per channel, worker thread only
+    std::vector<CrepeViterbiDecoder> decoders;  // per channel, worker thread only
+
+    AbstractFifo resultFifo { resultSlots };
+    HeapBlock<Result> results;                  // resultSlots
+
+    std::atomic<int> droppedFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InferenceWorker)
+};
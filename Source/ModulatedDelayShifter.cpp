@@ -0,0 +1,139 @@
+#include "ModulatedDelayShifter.h"
+#include "Utils.h"
+
+void ModulatedDelayShifter::prepare(double newSampleRate, int numChannels)
+{
+    sampleRate = newSampleRate;
+    minPeriod = sampleRate / maxFrequency;
+    maxPeriod = std::ceil(sampleRate / minFrequency);
+    crossfadeLength = jmax(segmentSize, roundToInt(sampleRate * crossfadeSeconds));
+
+    // A tap moves at most one sample per sample (ratio 2), so a segment never
+    // takes it below minDelay - segmentSize. Splices start while the tap has a
+    // crossfade and a segment left before the edge, and the range has room to
+    // jump one longest period from there.
+    minDelay = static_cast<double>(segmentSize + 1);
+    maxDelay = minDelay + maxPeriod + crossfadeLength + segmentSize;
+    latency = roundToInt((minDelay + maxDelay) * 0.5);
+
+    const int ringSize = nextPowerOfTwo(static_cast<int>(std::ceil(maxDelay)) + segmentSize + 2);
+    ringMask = ringSize - 1;
+
+    numChannels = jmax(1, numChannels);
+    channels.resize(static_cast<size_t>(numChannels));
+    inputRing.setSize(numChannels, ringSize);
+
+    reset();
+}
+
+void ModulatedDelayShifter::reset()
+{
+    inputRing.clear();
+
+    for (auto& state : channels)
+    {
+        state = {};
+        state.delay[0] = state.delay[1] = static_cast<double>(latency);
+    }
+}
+
+void ModulatedDelayShifter::resetChannel(int channel)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())))
+        return;
+
+    inputRing.clear(channel, 0, inputRing.getNumSamples());
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    state = {};
+    state.delay[0] = state.delay[1] = static_cast<double>(latency);
+}
+
+void ModulatedDelayShifter::process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())) || numRatios <= 0)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    auto* ring = inputRing.getWritePointer(channel);
+    const float fadeStep = 1.0f / static_cast<float>(crossfadeLength);
+
+    int position = 0;
+    while (position < numSamples)
+    {
+        const int segment = jmin(segmentSize, numSamples - position);
+        const float pitchRatio = jlimit(minShiftRatio, maxShiftRatio,
+                                        Utils::interpolateControlCurve(ratioCurve, numRatios, position + segment - 1, numSamples));
+        const double slope = 1.0 - pitchRatio;
+
+        // A ratio jump mid-crossfade can carry the outgoing tap past the
+        // range; holding it there costs a repeated sample, reading past the
+        // write point would cost garbage
+        state.delay[0] = jlimit(minDelay, maxDelay, state.delay[0]);
+        state.delay[1] = jlimit(minDelay, maxDelay, state.delay[1]);
+
+        if (state.fadePosition == 0)
+        {
+            const double projected = state.delay[state.activeTap] + slope * (crossfadeLength + segmentSize);
+            if (projected < minDelay || projected > maxDelay)
+            {
+                const float pitch = pitches != nullptr ? pitches[position] : 0.0f;
+                startSplice(state, slope, pitch > 0.0f ? jlimit(minPeriod, maxPeriod, sampleRate / pitch) : 0.0);
+            }
+        }
+
+        for (int i = 0; i < segment; ++i)
+        {
+            ring[state.writePosition] = audio[position + i];
+
+            // Linear interpolation between the two samples around each tap
+            float taps[2];
+            for (int tap = 0; tap < 2; ++tap)
+            {
+                const int whole = static_cast<int>(state.delay[tap]);
+                const float frac = static_cast<float>(state.delay[tap] - whole);
+                const float newer = ring[(state.writePosition - whole) & ringMask];
+                const float older = ring[(state.writePosition - whole - 1) & ringMask];
+                taps[tap] = newer + frac * (older - newer);
+                state.delay[tap] += slope;
+            }
+
+            float output = taps[state.activeTap];
+            if (state.fadePosition > 0)
+            {
+                // Linear: the taps are period-aligned, so they add coherently
+                const float fade = static_cast<float>(state.fadePosition) * fadeStep;
+                output = taps[1 - state.activeTap] + fade * (output - taps[1 - state.activeTap]);
+
+                if (++state.fadePosition > crossfadeLength)
+                    state.fadePosition = 0;
+            }
+
+            audio[position + i] = output;
+            state.writePosition = (state.writePosition + 1) & ringMask;
+        }
+
+        position += segment;
+    }
+}
+
+void ModulatedDelayShifter::startSplice(ChannelState& state, double slope, double period)
+{
+    // Jump the other tap as far across the range as whole periods allow, so
+    // splices are as rare as possible; unvoiced input jumps one longest period
+    const double current = state.delay[state.activeTap];
+    const double step = period > 0.0 ? period : maxPeriod;
+
+    double target = current;
+    if (slope < 0.0)
+        target += step * jmax(1, static_cast<int>((maxDelay - current) / step));
+    else
+        target -= step * jmax(1, static_cast<int>((current - minDelay) / step));
+
+    state.activeTap = 1 - state.activeTap;
+    state.delay[state.activeTap] = jlimit(minDelay, maxDelay, target);
+    state.fadePosition = 1;
+}
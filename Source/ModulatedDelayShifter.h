@@ -0,0 +1,70 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <vector>
+
+// Dual-tap modulated delay line: the cheapest shifter, for sessions running
+// many instances. Each channel has one short input ring and two read taps.
+// The active tap's delay changes by 1 - ratio samples per sample, so it reads
+// the input at ratio times real time. Before it runs off either end of the
+// delay range the other tap is placed a whole number of tracked periods
+// away, where the waveform lines up, and the output crossfades to it.
+//
+// Per sample that is one write, one or two interpolated reads and an add; the
+// splice decision runs once per segment. Timing wanders within the delay range
+// (a few ms) around the fixed latency it reports, which is the price of the
+// technique, and splices are audible on wide shifts of dense material.
+class ModulatedDelayShifter
+{
+public:
+    ModulatedDelayShifter() = default;
+
+    // Message thread
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    // Audio thread: one channel back to silence, as after reset()
+    void resetChannel(int channel);
+
+    // Centre of the delay range; the output is aligned to within half the
+    // range either side of it
+    int getLatencySamples() const { return latency; }
+
+    // Ratio curve as in PitchCorrectionEngine::correctPitch. pitches holds the
+    // tracked frequency in Hz for every sample of the block (0 = unvoiced), or
+    // is null; splices without a period jump by a fixed length.
+    void process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches);
+
+    static constexpr float maxShiftRatio = 2.0f;
+    static constexpr float minShiftRatio = 0.5f;
+    static constexpr float minFrequency = 80.0f;
+    static constexpr float maxFrequency = 1000.0f;
+    static constexpr double crossfadeSeconds = 0.004;
+
+private:
+    struct ChannelState
+    {
+        int writePosition = 0;
+        double delay[2] = {};       // per tap, in samples
+        int activeTap = 0;
+        int fadePosition = 0;       // samples into the crossfade, 0 when none runs
+    };
+
+    static constexpr int segmentSize = 32;
+
+    double sampleRate = 44100.0;
+    int latency = 0;
+    int crossfadeLength = 176;
+    double minPeriod = 44.0;
+    double maxPeriod = 552.0;
+    double minDelay = 1.0;
+    double maxDelay = 800.0;
+    int ringMask = 0;
+
+    std::vector<ChannelState> channels;
+    AudioBuffer<float> inputRing;
+
+    void startSplice(ChannelState& state, double slope, double period);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulatedDelayShifter)
+};
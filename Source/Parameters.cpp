@@ -6,6 +6,10 @@ const String Parameters::AMOUNT_ID = "amount";
 const String Parameters::MODE_ID = "mode";
 const String Parameters::KEY_ID = "key";
 const String Parameters::SCALE_ID = "scale";
+const String Parameters::CHANNEL_LINK_ID = "channelLink";
+const String Parameters::LATENCY_MODE_ID = "latencyMode";
+const String Parameters::LOOKAHEAD_ID = "lookahead";
+const String Parameters::SHIFTER_ID = "shifter";
 
 // Scale definitions (semitone offsets from root)
 const std::vector<int> Parameters::majorScale = {0, 2, 4, 5, 7, 9, 11};
@@ -62,10 +66,45 @@ AudioProcessorValueTreeState::ParameterLayout Parameters::createParameterLayout(
     parameters.push_back(std::make_unique<AudioParameterChoice>(
         SCALE_ID,
         "Scale",
-        StringArray{"Major", "Minor", "Chromatic"},
+        StringArray{"Major", "Minor", "Chromatic", "Custom"},
         static_cast<int>(SCALE_DEFAULT)
     ));
     
+    // Channel link parameter
+    parameters.push_back(std::make_unique<AudioParameterChoice>(
+        CHANNEL_LINK_ID,
+        "Channel Link",
+        StringArray{"Off", "Mid", "Loudest"},
+        static_cast<int>(CHANNEL_LINK_DEFAULT)
+    ));
+    
+    // Latency mode parameter
+    parameters.push_back(std::make_unique<AudioParameterChoice>(
+        LATENCY_MODE_ID,
+        "Latency Mode",
+        StringArray{"Live", "Lookahead"},
+        static_cast<int>(LATENCY_MODE_DEFAULT)
+    ));
+    
+    // Lookahead parameter
+    parameters.push_back(std::make_unique<AudioParameterFloat>(
+        LOOKAHEAD_ID,
+        "Lookahead",
+        NormalisableRange<float>(LOOKAHEAD_MIN, LOOKAHEAD_MAX, LOOKAHEAD_STEP),
+        LOOKAHEAD_DEFAULT,
+        "Lookahead",
+        AudioProcessorParameter::genericParameter,
+        [](float value, int) { return String(value, 0) + " ms"; }
+    ));
+    
+    // Shifter parameter
+    parameters.push_back(std::make_unique<AudioParameterChoice>(
+        SHIFTER_ID,
+        "Shifter",
+        StringArray{"Standard", "Low CPU"},
+        static_cast<int>(SHIFTER_DEFAULT)
+    ));
+    
     return {parameters.begin(), parameters.end()};
 }
 
@@ -108,6 +147,38 @@ String Parameters::getScaleName(Scale scale)
         case Scale::Major: return "Major";
         case Scale::Minor: return "Minor";
         case Scale::Chromatic: return "Chromatic";
+        case Scale::Custom: return "Custom";
         default: return "Major";
     }
 }
+
+String Parameters::getChannelLinkName(ChannelLink link)
+{
+    switch (link)
+    {
+        case ChannelLink::Off: return "Off";
+        case ChannelLink::Mid: return "Mid";
+        case ChannelLink::Loudest: return "Loudest";
+        default: return "Off";
+    }
+}
+
+String Parameters::getLatencyModeName(LatencyMode mode)
+{
+    switch (mode)
+    {
+        case LatencyMode::Live: return "Live";
+        case LatencyMode::Lookahead: return "Lookahead";
+        default: return "Live";
+    }
+}
+
+String Parameters::getShifterName(Shifter shifter)
+{
+    switch (shifter)
+    {
+        case Shifter::Standard: return "Standard";
+        case Shifter::LowCpu: return "Low CPU";
+        default: return "Standard";
+    }
+}
@@ -12,6 +12,10 @@ public:
     static const String MODE_ID;
     static const String KEY_ID;
     static const String SCALE_ID;
+    static const String CHANNEL_LINK_ID;
+    static const String LATENCY_MODE_ID;
+    static const String LOOKAHEAD_ID;
+    static const String SHIFTER_ID;
     
     // Parameter ranges and defaults
     static constexpr float SPEED_MIN = 0.0f;
@@ -24,6 +28,12 @@ public:
     static constexpr float AMOUNT_DEFAULT = 50.0f;
     static constexpr float AMOUNT_STEP = 0.1f;
     
+    // Lookahead in milliseconds
+    static constexpr float LOOKAHEAD_MIN = 10.0f;
+    static constexpr float LOOKAHEAD_MAX = 40.0f;
+    static constexpr float LOOKAHEAD_DEFAULT = 20.0f;
+    static constexpr float LOOKAHEAD_STEP = 1.0f;
+    
     // Enums for discrete parameters
     enum class Mode
     {
@@ -45,10 +55,39 @@ public:
     {
         Major = 0,
         Minor = 1,
-        Chromatic = 2
+        Chromatic = 2,
+        Custom = 3 // user note mask or Scala tuning, set on the processor
     };
     static constexpr Scale SCALE_DEFAULT = Scale::Major;
     
+    // How multichannel input is analysed: each channel on its own, or one
+    // shared pitch track from the channel mean or the loudest channel
+    enum class ChannelLink
+    {
+        Off = 0,
+        Mid = 1,
+        Loudest = 2
+    };
+    static constexpr ChannelLink CHANNEL_LINK_DEFAULT = ChannelLink::Off;
+    
+    // Live adds no delay beyond the shifters'; Lookahead delays the audio by
+    // the Lookahead time so pitch tracking runs ahead of the correction
+    enum class LatencyMode
+    {
+        Live = 0,
+        Lookahead = 1
+    };
+    static constexpr LatencyMode LATENCY_MODE_DEFAULT = LatencyMode::Live;
+    
+    // Standard uses each mode's own shifter; Low CPU replaces them all with a
+    // modulated delay line, for instances stacked by the dozen
+    enum class Shifter
+    {
+        Standard = 0,
+        LowCpu = 1
+    };
+    static constexpr Shifter SHIFTER_DEFAULT = Shifter::Standard;
+    
     // Constructor
     Parameters();
     
@@ -60,6 +99,9 @@ public:
     static String getModeName(Mode mode);
     static String getKeyName(Key key);
     static String getScaleName(Scale scale);
+    static String getChannelLinkName(ChannelLink link);
+    static String getLatencyModeName(LatencyMode mode);
+    static String getShifterName(Shifter shifter);
     
 private:
     // Scale note definitions (semitone offsets from root)
@@ -0,0 +1,318 @@
+#include "PhaseVocoder.h"
+#include "Utils.h"
+#include <cstring>
+
+namespace
+{
+    inline float wrapPhase(float value)
+    {
+        return value - MathConstants<float>::twoPi * std::floor((value + MathConstants<float>::pi) / MathConstants<float>::twoPi);
+    }
+}
+
+void PhaseVocoder::prepare(double sampleRate, int numChannels, int minimumLatency)
+{
+    // ~40 ms frames resolve harmonics of low voices (2048 at 44.1/48 kHz)
+    int order = 8;
+    while ((1 << order) < roundToInt(sampleRate * 0.04))
+        ++order;
+
+    frameSize = 1 << order;
+    numBins = frameSize / 2 + 1;
+    hopSize = frameSize / minOverlap;
+    extraDelay = jmax(0, minimumLatency - frameSize);
+
+    fft = std::make_unique<dsp::FFT>(order);
+    formantEnvelope.prepare(sampleRate, frameSize);
+
+    // Frames land up to extraDelay + frameSize ahead of the read point, and
+    // the longest hop is the live one
+    const int ringSize = nextPowerOfTwo(frameSize + extraDelay + frameSize / minOverlap);
+    ringMask = ringSize - 1;
+
+    numChannels = jmax(1, numChannels);
+    channels.resize(static_cast<size_t>(numChannels));
+    inputRing.setSize(numChannels, ringSize);
+    outputRing.setSize(numChannels, ringSize);
+    windowSumRing.setSize(numChannels, ringSize);
+    previousPhase.setSize(numChannels, numBins);
+    phaseRotation.setSize(numChannels, numBins);
+
+    window.allocate(static_cast<size_t>(frameSize), true);
+    fftData.allocate(static_cast<size_t>(frameSize * 2), true);
+    magnitude.allocate(static_cast<size_t>(numBins), true);
+    phase.allocate(static_cast<size_t>(numBins), true);
+    trueFrequency.allocate(static_cast<size_t>(numBins), true);
+    envelope.allocate(static_cast<size_t>(numBins), true);
+    newRotation.allocate(static_cast<size_t>(numBins), true);
+    peaks.allocate(static_cast<size_t>(numBins), true);
+
+    frame.bins = fftData.getData();
+    frame.magnitude = magnitude.getData();
+    frame.phase = phase.getData();
+    frame.trueFrequency = trueFrequency.getData();
+    frame.envelope = envelope.getData();
+    frame.numBins = numBins;
+
+    // Periodic Hann on both sides; the squared window sums to 1.5 at 4x
+    // overlap and 3 at 8x, and process() divides that back out
+    for (int i = 0; i < frameSize; ++i)
+        window[i] = 0.5f * (1.0f - std::cos(MathConstants<float>::twoPi * i / frameSize));
+
+    reset();
+}
+
+void PhaseVocoder::reset()
+{
+    inputRing.clear();
+    outputRing.clear();
+    windowSumRing.clear();
+    previousPhase.clear();
+    phaseRotation.clear();
+
+    for (auto& state : channels)
+    {
+        state.writePosition = 0;
+        state.samplesUntilHop = hopSize;
+        state.hopSize = hopSize;
+    }
+}
+
+void PhaseVocoder::resetChannel(int channel)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())))
+        return;
+
+    inputRing.clear(channel, 0, inputRing.getNumSamples());
+    outputRing.clear(channel, 0, outputRing.getNumSamples());
+    windowSumRing.clear(channel, 0, windowSumRing.getNumSamples());
+    previousPhase.clear(channel, 0, previousPhase.getNumSamples());
+    phaseRotation.clear(channel, 0, phaseRotation.getNumSamples());
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    state.writePosition = 0;
+    state.samplesUntilHop = hopSize;
+    state.hopSize = hopSize;
+}
+
+void PhaseVocoder::setOverlap(int newOverlap)
+{
+    // Channels pick the new hop up when their current one completes
+    hopSize = frameSize / jlimit(minOverlap, maxOverlap, nextPowerOfTwo(newOverlap));
+}
+
+void PhaseVocoder::process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())) || numRatios <= 0)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    auto* input = inputRing.getWritePointer(channel);
+    auto* output = outputRing.getWritePointer(channel);
+    auto* windowSum = windowSumRing.getWritePointer(channel);
+
+    // The window sum is at least 1.5 once frames overlap fully; below that,
+    // right after a reset, let the first frames fade in rather than amplify them
+    constexpr float minWindowSum = 0.5f;
+
+    int position = 0;
+    while (position < numSamples)
+    {
+        const int segment = jmin(numSamples - position, state.samplesUntilHop);
+        for (int i = 0; i < segment; ++i)
+        {
+            const int index = (state.writePosition + i) & ringMask;
+            input[index] = audio[position + i];
+            audio[position + i] = output[index] / jmax(minWindowSum, windowSum[index]);
+            output[index] = 0.0f;
+            windowSum[index] = 0.0f;
+        }
+
+        state.writePosition = (state.writePosition + segment) & ringMask;
+        state.samplesUntilHop -= segment;
+        position += segment;
+
+        if (state.samplesUntilHop == 0)
+        {
+            const float pitchRatio = Utils::interpolateControlCurve(ratioCurve, numRatios, position - 1, numSamples);
+            processFrame(channel, jlimit(minShiftRatio, maxShiftRatio, pitchRatio));
+            state.hopSize = hopSize;
+            state.samplesUntilHop = hopSize;
+        }
+    }
+}
+
+int PhaseVocoder::findPeaks() const
+{
+    // Local maxima over two neighbours each side, ignoring the noise floor
+    float maxMagnitude = 0.0f;
+    for (int k = 0; k < numBins; ++k)
+        maxMagnitude = jmax(maxMagnitude, magnitude[k]);
+
+    const float floor = maxMagnitude * 1.0e-4f;
+    int numPeaks = 0;
+
+    for (int k = 2; k < numBins - 2; ++k)
+    {
+        const float m = magnitude[k];
+        if (m > floor && m > magnitude[k - 1] && m >= magnitude[k + 1]
+                      && m > magnitude[k - 2] && m >= magnitude[k + 2])
+            peaks[numPeaks++] = k;
+    }
+
+    return numPeaks;
+}
+
+void PhaseVocoder::processFrame(int channel, float pitchRatio)
+{
+    frame.pitchRatio = pitchRatio;
+    frame.hopSize = channels[static_cast<size_t>(channel)].hopSize;
+
+    analyseFrame(channel);
+
+    if (preserveFormants)
+        extractEnvelope();
+
+    remapBins(channel);
+
+    if (preserveFormants)
+        reapplyEnvelope();
+
+    applyGain();
+    synthesiseFrame(channel);
+}
+
+void PhaseVocoder::analyseFrame(int channel)
+{
+    const auto& state = channels[static_cast<size_t>(channel)];
+    const auto* input = inputRing.getReadPointer(channel);
+    auto* lastPhase = previousPhase.getWritePointer(channel);
+    float* data = frame.bins;
+
+    // Newest frame, oldest sample first
+    const int start = state.writePosition - frameSize;
+    for (int i = 0; i < frameSize; ++i)
+        data[i] = input[(start + i) & ringMask] * window[i];
+
+    fft->performRealOnlyForwardTransform(data, true);
+
+    // Polar form, plus each bin's true frequency from the phase advance
+    const int elapsed = frame.hopSize;
+    const float expectedAdvance = MathConstants<float>::twoPi * elapsed / frameSize;
+    for (int k = 0; k < numBins; ++k)
+    {
+        const float re = data[k * 2];
+        const float im = data[k * 2 + 1];
+        frame.magnitude[k] = std::sqrt(re * re + im * im);
+        frame.phase[k] = std::atan2(im, re);
+
+        const float deviation = wrapPhase(frame.phase[k] - lastPhase[k] - expectedAdvance * k);
+        frame.trueFrequency[k] = (expectedAdvance * k + deviation) / elapsed;
+        lastPhase[k] = frame.phase[k];
+    }
+}
+
+void PhaseVocoder::extractEnvelope()
+{
+    // Computed once per hop; reapplyEnvelope() interpolates it at k / ratio
+    formantEnvelope.process(frame.magnitude, frame.envelope);
+}
+
+void PhaseVocoder::remapBins(int channel)
+{
+    auto* rotation = phaseRotation.getWritePointer(channel);
+    float* data = frame.bins;
+    const float pitchRatio = frame.pitchRatio;
+
+    std::fill(data, data + frameSize * 2, 0.0f);
+    std::memcpy(newRotation.getData(), rotation, sizeof(float) * static_cast<size_t>(numBins));
+
+    const int numPeaks = findPeaks();
+    for (int p = 0; p < numPeaks; ++p)
+    {
+        // Region of influence: halfway to the neighbouring peaks
+        const int peak = peaks[p];
+        const int regionStart = p > 0 ? (peaks[p - 1] + peak + 1) / 2 : 0;
+        const int regionEnd = p < numPeaks - 1 ? (peak + peaks[p + 1] + 1) / 2 : numBins;
+
+        const int target = roundToInt(peak * pitchRatio);
+        if (target >= numBins)
+            break;
+
+        // Rotate the peak so its frequency scales with the ratio; the rotation
+        // accumulates in the output bin and is shared by the whole region, so a
+        // peak drifting into a neighbouring bin keeps a continuous phase
+        const float peakRotation = wrapPhase(rotation[target] + frame.hopSize * (pitchRatio - 1.0f) * frame.trueFrequency[peak]);
+        const int shift = target - peak;
+
+        for (int k = regionStart; k < regionEnd; ++k)
+        {
+            const int destination = k + shift;
+            if (destination < 0 || destination >= numBins)
+                continue;
+
+            const float outPhase = frame.phase[k] + peakRotation;
+            data[destination * 2] += frame.magnitude[k] * std::cos(outPhase);
+            data[destination * 2 + 1] += frame.magnitude[k] * std::sin(outPhase);
+            newRotation[destination] = peakRotation;
+        }
+    }
+
+    std::memcpy(rotation, newRotation.getData(), sizeof(float) * static_cast<size_t>(numBins));
+}
+
+void PhaseVocoder::reapplyEnvelope()
+{
+    // Content now at bin k came from bin k / ratio and carries that bin's
+    // envelope; swap it for the envelope at k so the formants stay put. The
+    // correction is capped so a near-silent source bin cannot blow up noise.
+    constexpr float maxCorrection = 8.0f;
+    const float inverseRatio = 1.0f / frame.pitchRatio;
+    float* data = frame.bins;
+
+    for (int k = 1; k < numBins; ++k)
+    {
+        const float source = k * inverseRatio;
+        const int index = static_cast<int>(source);
+        if (index >= numBins - 1)
+            break;
+
+        const float frac = source - static_cast<float>(index);
+        const float sourceEnvelope = frame.envelope[index] + frac * (frame.envelope[index + 1] - frame.envelope[index]);
+        const float correction = jmin(maxCorrection, frame.envelope[k] / (sourceEnvelope + 1.0e-9f));
+
+        data[k * 2] *= correction;
+        data[k * 2 + 1] *= correction;
+    }
+}
+
+void PhaseVocoder::applyGain()
+{
+    if (outputGain == 1.0f)
+        return;
+
+    FloatVectorOperations::multiply(frame.bins, outputGain, numBins * 2);
+}
+
+void PhaseVocoder::synthesiseFrame(int channel)
+{
+    const auto& state = channels[static_cast<size_t>(channel)];
+    auto* output = outputRing.getWritePointer(channel);
+    auto* windowSum = windowSumRing.getWritePointer(channel);
+    float* data = frame.bins;
+
+    fft->performRealOnlyInverseTransform(data);
+
+    // Overlap-add so the frame's first sample comes out latency samples after
+    // it went in
+    const int writeStart = state.writePosition + extraDelay;
+    for (int i = 0; i < frameSize; ++i)
+    {
+        const int index = (writeStart + i) & ringMask;
+        output[index] += data[i] * window[i];
+        windowSum[index] += window[i] * window[i];
+    }
+}
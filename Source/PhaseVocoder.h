@@ -0,0 +1,120 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "FormantEnvelope.h"
+#include <memory>
+
+// One analysed STFT frame. The complex bins live in the FFT buffer itself and
+// every stage works on them in place, so a hop costs exactly one forward and
+// one inverse transform however many stages run.
+struct SpectralFrame
+{
+    float* bins = nullptr;          // interleaved re/im, numBins values
+    float* magnitude = nullptr;     // of the analysed frame
+    float* phase = nullptr;
+    float* trueFrequency = nullptr; // radians per sample, from the hop phase advance
+    float* envelope = nullptr;      // formant envelope of the analysed frame
+    int numBins = 0;
+    int hopSize = 0;                // samples since the channel's previous frame
+    float pitchRatio = 1.0f;
+};
+
+// Streaming STFT pitch shifter. Each hop the newest frame is analysed with a
+// Hann window and run through the stages below on one shared frame:
+//   envelope extraction -> peak-locked bin remap -> envelope reapplication -> gain
+// The remap moves spectral peaks to ratio times their bin, and every bin in a
+// peak's region of influence follows it with its phase locked to the peak
+// (identity phase locking, Laroche & Dolson). The peak's phase is advanced so
+// its true frequency, measured from the phase difference between hops, comes
+// out multiplied by the ratio. Frames are resynthesised with the same window
+// and overlap-added; all state persists across host blocks.
+//
+// The overlap can change while running (4x live, 8x for offline renders).
+// A new hop takes effect at each channel's next frame, the phase advance is
+// always measured over the hop that actually elapsed, and the output is
+// divided by the running sum of squared windows rather than a constant, so
+// the switch does not modulate the level.
+class PhaseVocoder
+{
+public:
+    PhaseVocoder() = default;
+
+    // Message thread. The output delay is padded to at least minimumLatency so
+    // this path can line up with other shifters behind one reported latency.
+    void prepare(double sampleRate, int numChannels, int minimumLatency = 0);
+    void reset();
+
+    // Audio thread: one channel back to silence, as after reset()
+    void resetChannel(int channel);
+
+    int getFrameSize() const { return frameSize; }
+    int getHopSize() const { return hopSize; }
+
+    // Audio thread: frames per frame length, between minOverlap and maxOverlap
+    void setOverlap(int newOverlap);
+    int getOverlap() const { return frameSize / hopSize; }
+    int getLatencySamples() const { return frameSize + extraDelay; }
+
+    // Re-impose the input's spectral envelope after the shift
+    void setFormantPreservation(bool shouldPreserve) { preserveFormants = shouldPreserve; }
+    void setFormantMethod(FormantEnvelope::Method newMethod) { formantEnvelope.setMethod(newMethod); }
+    void setFineFormantResolution(bool shouldUseFine) { formantEnvelope.setFineResolution(shouldUseFine); }
+    void setOutputGain(float newGain) { outputGain = newGain; }
+
+    // Same contract as PitchCorrectionEngine::correctPitch
+    void process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios);
+
+    static constexpr float maxShiftRatio = 2.0f;
+    static constexpr float minShiftRatio = 0.5f;
+    static constexpr int minOverlap = 4;
+    static constexpr int maxOverlap = 8;
+
+private:
+    struct ChannelState
+    {
+        int writePosition = 0;
+        int samplesUntilHop = 0;
+        int hopSize = 0;    // the hop in progress; setOverlap() waits for the next frame
+    };
+
+    std::unique_ptr<dsp::FFT> fft;
+    int frameSize = 2048;
+    int numBins = 1025;
+    int hopSize = 512;
+    int ringMask = 0;
+    int extraDelay = 0;
+    bool preserveFormants = false;
+    float outputGain = 1.0f;
+
+    std::vector<ChannelState> channels;
+    AudioBuffer<float> inputRing;       // frameSize history per channel
+    AudioBuffer<float> outputRing;      // overlap-add accumulator per channel
+    AudioBuffer<float> windowSumRing;   // sum of squared windows under each output sample
+    AudioBuffer<float> previousPhase;   // analysis phase of the last hop, per bin
+    AudioBuffer<float> phaseRotation;   // accumulated synthesis rotation, per output bin
+
+    // Per-hop working buffers, shared by all channels
+    HeapBlock<float> window;
+    HeapBlock<float> fftData;
+    HeapBlock<float> magnitude;
+    HeapBlock<float> phase;
+    HeapBlock<float> trueFrequency;
+    HeapBlock<float> envelope;
+    HeapBlock<float> newRotation;
+    HeapBlock<int> peaks;
+    SpectralFrame frame;
+    FormantEnvelope formantEnvelope;
+
+    void processFrame(int channel, float pitchRatio);
+    int findPeaks() const;
+
+    // Pipeline stages, in order
+    void analyseFrame(int channel);
+    void extractEnvelope();
+    void remapBins(int channel);
+    void reapplyEnvelope();
+    void applyGain();
+    void synthesiseFrame(int channel);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PhaseVocoder)
+};
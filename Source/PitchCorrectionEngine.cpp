@@ -5,604 +5,431 @@
 // Functions now available globally from JuceHeader.h
 #include <cstring>
 
-PitchCorrectionEngine::PitchCorrectionEngine()
+PitchCorrectionEngine::PitchCorrectionEngine(ScratchWorkspace& scratch)
+    : workspace(scratch)
 {
-    // Initialize grain buffers
-    grains.resize(maxGrains);
 }
 
-PitchCorrectionEngine::~PitchCorrectionEngine()
-{
-    releaseGrains();
-}
-
-void PitchCorrectionEngine::prepareToPlay(double sampleRate, int samplesPerBlock)
+void PitchCorrectionEngine::prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels, int maxGrains)
 {
     currentSampleRate = sampleRate;
     currentBlockSize = samplesPerBlock;
     
-    // Initialize buffers
-    analysisBuffer.setSize(1, samplesPerBlock * 2); // Double buffer for pitch detection
-    correlationBuffer.setSize(1, samplesPerBlock * 2);
-    windowBuffer.resize(samplesPerBlock * 2);
-    
-    // Initialize FFT
-    fft = std::make_unique<dsp::FFT>(fftOrder);
-    window = std::make_unique<dsp::WindowingFunction<float>>(fftSize, dsp::WindowingFunction<float>::hann);
-    frequencyData.allocate(fftSize * 2, true);
-    
-    // Initialize overlap buffer
-    overlapBuffer.setSize(1, overlapSize);
-    overlapBuffer.clear();
-    overlapPosition = 0;
-    
-    // Initialize grains
-    initializeGrains();
-}
-
-void PitchCorrectionEngine::reset()
-{
-    analysisBuffer.clear();
-    correlationBuffer.clear();
-    overlapBuffer.clear();
-    overlapPosition = 0;
-    currentGrain = 0;
-    
-    // Reset all grains
-    for (auto& grain : grains)
+    // Pitch tracking window holds three 80 Hz periods (2048 samples at 44.1 kHz)
+    // and is re-analysed sixteen times per window, about every 3 ms, or 64
+    // times when rendering. Estimate storage is sized for the render hop.
+    trackerWindowSize = jmax(2048, nextPowerOfTwo(static_cast<int>(std::ceil(sampleRate / PitchTracker::minFrequency * 3.0))));
+    pitchTrackers.clear();
+    for (int channel = 0; channel < jmax(1, numChannels); ++channel)
     {
-        grain.active = false;
-        grain.position = 0;
-        grain.phase = 0.0f;
-        grain.amplitude = 0.0f;
+        pitchTrackers.push_back(std::make_unique<PitchTracker>());
+        pitchTrackers.back()->prepare(sampleRate, trackerWindowSize, trackerWindowSize / 64, samplesPerBlock);
     }
-}
-
-void PitchCorrectionEngine::detectPitch(const float* input, int numSamples, float* pitchOutput)
-{
-    // Use autocorrelation for basic pitch detection
-    for (int i = 0; i < numSamples; i += 256) // Process in chunks
+    
+    linkedTracker = std::make_unique<PitchTracker>();
+    linkedTracker->prepare(sampleRate, trackerWindowSize, trackerWindowSize / 64, samplesPerBlock);
+    
+    // Every mode reports one latency: the longest of the three shifters, with
+    // the others padded to match
+    const int minimumLatency = jmax(GranularShifter::getMinimumLatency(sampleRate), PsolaShifter::getMinimumLatency(sampleRate));
+    phaseVocoder.prepare(sampleRate, numChannels, minimumLatency);
+    phaseVocoder.setFormantPreservation(true);
+    latencySamples = phaseVocoder.getLatencySamples();
+    granularShifter.prepare(sampleRate, numChannels, latencySamples, maxGrains);
+    psolaShifter.prepare(sampleRate, numChannels, latencySamples);
+    modulatedDelayShifter.prepare(sampleRate, numChannels);
+    
+    maxLookaheadSamples = static_cast<int>(std::ceil(sampleRate * maxLookaheadSeconds));
+    lookaheadRing.setSize(jmax(1, numChannels), nextPowerOfTwo(maxLookaheadSamples + 1));
+    lookaheadRingMask = lookaheadRing.getNumSamples() - 1;
+    lookaheadWritePositions.assign(static_cast<size_t>(jmax(1, numChannels)), 0);
+    lookaheadSamples = jmin(lookaheadSamples, maxLookaheadSamples);
+    
+    // Voicing gates and the dry delay, long enough for either backend's
+    // latency plus a block
+    voicingGates.clear();
+    for (int channel = 0; channel < jmax(1, numChannels); ++channel)
     {
-        int chunkSize = jmin(256, numSamples - i);
-        float pitch = detectPitchAutocorrelation(&input[i], chunkSize);
-        
-        // Fill the output buffer with detected pitch
-        for (int j = 0; j < chunkSize; ++j)
-        {
-            if (i + j < numSamples)
-                pitchOutput[i + j] = pitch;
-        }
+        voicingGates.push_back(std::make_unique<VoicingGate>());
+        voicingGates.back()->prepare(sampleRate);
     }
+    
+    linkedVoicingGate.prepare(sampleRate);
+    voicingStates.assign(static_cast<size_t>(jmax(1, numChannels)), {});
+    
+    const int maxShifterLatency = jmax(latencySamples, modulatedDelayShifter.getLatencySamples());
+    dryRing.setSize(jmax(1, numChannels), nextPowerOfTwo(maxShifterLatency + jmax(1, samplesPerBlock) + 1));
+    dryRingMask = dryRing.getNumSamples() - 1;
+    dryWritePositions.assign(static_cast<size_t>(jmax(1, numChannels)), 0);
+    voicingFadeStep = 1.0f / static_cast<float>(jmax(1, roundToInt(sampleRate * voicingCrossfadeSeconds)));
+    
+    // prepare() put every stage back in its default configuration
+    applyProcessingTier();
+    
+    reset();
 }
 
-void PitchCorrectionEngine::detectPitchAdvanced(const float* input, int numSamples, float* pitchOutput)
+int PitchCorrectionEngine::getLatencySamples(ShifterBackend backend) const
 {
-    // Use YIN algorithm for more accurate pitch detection
-    for (int i = 0; i < numSamples; i += 512) // Larger chunks for better accuracy
-    {
-        int chunkSize = jmin(512, numSamples - i);
-        float pitch = detectPitchYIN(&input[i], chunkSize);
-        
-        // Fill the output buffer with detected pitch
-        for (int j = 0; j < chunkSize; ++j)
-        {
-            if (i + j < numSamples)
-                pitchOutput[i + j] = pitch;
-        }
-    }
+    return backend == ShifterBackend::ModulatedDelay ? modulatedDelayShifter.getLatencySamples() : latencySamples;
 }
 
-void PitchCorrectionEngine::correctPitch(float* audio, int numSamples, float targetFreq, float speed, float amount)
+void PitchCorrectionEngine::setShifterBackend(ShifterBackend newBackend)
 {
-    // Detect current pitch
-    std::vector<float> currentPitches(numSamples);
-    detectPitch(audio, numSamples, currentPitches.data());
+    if (newBackend == shifterBackend)
+        return;
     
-    // Apply smooth pitch correction
-    for (int i = 0; i < numSamples; ++i)
+    // Whatever the incoming shifters still hold is from before the switch
+    shifterBackend = newBackend;
+    
+    if (shifterBackend == ShifterBackend::ModulatedDelay)
     {
-        float currentPitch = currentPitches[i];
-        
-        if (currentPitch > 20.0f && currentPitch < 5000.0f) // Valid pitch range
-        {
-            float pitchRatio = targetFreq / currentPitch;
-            float correction = (pitchRatio - 1.0f) * amount * 0.01f * speed * 0.01f;
-            
-            if (std::abs(correction) > 0.01f)
-            {
-                // Apply gradual pitch shifting using granular synthesis
-                pitchShiftGranular(&audio[i], jmin(grainSize, numSamples - i), 1.0f + correction);
-            }
-        }
+        modulatedDelayShifter.reset();
     }
-}
-
-void PitchCorrectionEngine::correctPitchHard(float* audio, int numSamples, float targetFreq, float speed, float amount)
-{
-    // Detect current pitch
-    std::vector<float> currentPitches(numSamples);
-    detectPitch(audio, numSamples, currentPitches.data());
-    
-    // Apply aggressive pitch correction
-    for (int i = 0; i < numSamples; ++i)
+    else
     {
-        float currentPitch = currentPitches[i];
-        
-        if (currentPitch > 20.0f && currentPitch < 5000.0f)
-        {
-            float pitchRatio = targetFreq / currentPitch;
-            
-            // Hard correction - immediate snap to target
-            if (std::abs(pitchRatio - 1.0f) > 0.005f && amount > 0.1f)
-            {
-                // Calculate hard correction factor
-                float hardCorrection = pitchRatio - 1.0f;
-                hardCorrection *= amount * 0.01f;
-                hardCorrection = jlimit(-0.5f, 0.5f, hardCorrection); // Limit extreme corrections
-                
-                // Apply immediate pitch shift
-                pitchShiftPSOLA(&audio[i], jmin(1024, numSamples - i), 1.0f + hardCorrection);
-            }
-        }
+        granularShifter.reset();
+        phaseVocoder.reset();
+        psolaShifter.reset();
     }
 }
 
-void PitchCorrectionEngine::correctPitchAI(float* audio, int numSamples, float targetFreq, float speed, float amount)
+void PitchCorrectionEngine::setProcessingTier(ProcessingTier newTier)
 {
-    // Use advanced pitch detection for AI mode
-    std::vector<float> currentPitches(numSamples);
-    detectPitchAdvanced(audio, numSamples, currentPitches.data());
+    if (newTier == processingTier)
+        return;
     
-    // Apply AI-style correction with formant preservation
-    for (int i = 0; i < numSamples; i += 256)
-    {
-        int chunkSize = jmin(256, numSamples - i);
-        float currentPitch = currentPitches[i];
-        
-        if (currentPitch > 20.0f && currentPitch < 5000.0f)
-        {
-            float pitchRatio = targetFreq / currentPitch;
-            
-            if (std::abs(pitchRatio - 1.0f) > 0.01f)
-            {
-                // Apply spectral pitch shifting with formant preservation
-                pitchShiftSpectral(&audio[i], chunkSize, pitchRatio);
-                
-                // Preserve formants for natural sound
-                preserveFormants(&audio[i], chunkSize, pitchRatio);
-            }
-        }
-    }
+    processingTier = newTier;
+    applyProcessingTier();
 }
 
-float PitchCorrectionEngine::calculateRMS(const float* buffer, int numSamples)
+void PitchCorrectionEngine::applyProcessingTier()
 {
-    if (numSamples <= 0)
-        return 0.0f;
+    if (linkedTracker == nullptr)
+        return;
     
-    float sum = 0.0f;
-    for (int i = 0; i < numSamples; ++i)
+    const bool render = processingTier == ProcessingTier::Render;
+    
+    for (auto& tracker : pitchTrackers)
     {
-        sum += buffer[i] * buffer[i];
+        tracker->setHopSize(trackerWindowSize / (render ? 64 : 16));
+        tracker->setSpectralCheck(render);
     }
     
-    return std::sqrt(sum / numSamples);
+    linkedTracker->setHopSize(trackerWindowSize / (render ? 64 : 16));
+    linkedTracker->setSpectralCheck(render);
+    
+    phaseVocoder.setOverlap(render ? PhaseVocoder::maxOverlap : PhaseVocoder::minOverlap);
+    phaseVocoder.setFineFormantResolution(render);
 }
 
-void PitchCorrectionEngine::performFFT(const float* input, std::vector<float>& magnitudeOutput)
+void PitchCorrectionEngine::reset()
 {
-    if (magnitudeOutput.size() != fftSize / 2 + 1)
-        magnitudeOutput.resize(fftSize / 2 + 1);
+    for (auto& tracker : pitchTrackers)
+        tracker->reset();
     
-    // Copy input to frequency data (real part)
-    for (int i = 0; i < fftSize; ++i)
-    {
-        if (i < fftSize)
-        {
-            frequencyData[i].real(i < fftSize ? input[i] : 0.0f);
-            frequencyData[i].imag(0.0f);
-        }
-    }
+    if (linkedTracker != nullptr)
+        linkedTracker->reset();
     
-    // Apply window
-    window->multiplyWithWindowingTable(reinterpret_cast<float*>(frequencyData.getData()), fftSize);
+    granularShifter.reset();
+    phaseVocoder.reset();
+    psolaShifter.reset();
+    modulatedDelayShifter.reset();
     
-    // Perform FFT
-    fft->performFrequencyOnlyForwardTransform(reinterpret_cast<float*>(frequencyData.getData()));
+    lookaheadRing.clear();
+    std::fill(lookaheadWritePositions.begin(), lookaheadWritePositions.end(), 0);
     
-    // Calculate magnitude spectrum
-    for (int i = 0; i < fftSize / 2 + 1; ++i)
-    {
-        float real = frequencyData[i].real();
-        float imag = frequencyData[i].imag();
-        magnitudeOutput[i] = std::sqrt(real * real + imag * imag);
-    }
+    for (auto& gate : voicingGates)
+        gate->reset();
+    
+    linkedVoicingGate.reset();
+    std::fill(voicingStates.begin(), voicingStates.end(), VoicingState());
+    dryRing.clear();
+    std::fill(dryWritePositions.begin(), dryWritePositions.end(), 0);
 }
 
-void PitchCorrectionEngine::performIFFT(const std::vector<float>& magnitudeInput, float* output)
+void PitchCorrectionEngine::resetShifterChannel(int channel)
 {
-    // Convert magnitude back to complex spectrum (phase is lost)
-    for (int i = 0; i < fftSize / 2 + 1; ++i)
+    if (shifterBackend == ShifterBackend::ModulatedDelay)
     {
-        frequencyData[i].real(magnitudeInput[i]);
-        frequencyData[i].imag(0.0f); // Zero phase for simplicity
+        modulatedDelayShifter.resetChannel(channel);
     }
-    
-    // Mirror for negative frequencies
-    for (int i = fftSize / 2 + 1; i < fftSize; ++i)
+    else
     {
-        frequencyData[i] = std::conj(frequencyData[fftSize - i]);
-    }
-    
-    // Perform IFFT
-    fft->performRealOnlyInverseTransform(reinterpret_cast<float*>(frequencyData.getData()));
-    
-    // Copy result to output
-    for (int i = 0; i < fftSize; ++i)
-    {
-        output[i] = frequencyData[i].real();
+        granularShifter.resetChannel(channel);
+        phaseVocoder.resetChannel(channel);
+        psolaShifter.resetChannel(channel);
     }
 }
 
-float PitchCorrectionEngine::detectPitchAutocorrelation(const float* input, int numSamples)
+int PitchCorrectionEngine::getScratchSize() const
 {
-    if (numSamples < 100)
-        return 0.0f;
-    
-    // Apply window to input
-    auto* analysisData = analysisBuffer.getWritePointer(0);
-    for (int i = 0; i < numSamples; ++i)
+    // The delayed dry block while a channel crossfades, and the incoming
+    // shifter's block while a channel switches mode
+    return 2 * ScratchWorkspace::slotSize(currentBlockSize);
+}
+
+void PitchCorrectionEngine::trackPitch(int channel, const float* input, int numSamples, float* pitchOutput, bool voiced)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(pitchTrackers.size())))
     {
-        float windowVal = 0.5f * (1.0f - std::cos(Utils::TWO_PI * i / (numSamples - 1))); // Hann window
-        analysisData[i] = input[i] * windowVal;
+        jassertfalse;
+        std::fill(pitchOutput, pitchOutput + numSamples, 0.0f);
+        return;
     }
     
-    // Autocorrelation
-    int minPeriod = static_cast<int>(currentSampleRate / 1000.0); // Min 1000 Hz
-    int maxPeriod = static_cast<int>(currentSampleRate / 80.0);   // Max 80 Hz
-    
-    float maxCorrelation = 0.0f;
-    int bestPeriod = minPeriod;
-    
-    for (int period = minPeriod; period < std::min(maxPeriod, numSamples / 2); ++period)
-    {
-        float correlation = 0.0f;
-        float energy1 = 0.0f;
-        float energy2 = 0.0f;
-        
-        int samples = numSamples - period;
-        for (int i = 0; i < samples; ++i)
-        {
-            correlation += analysisData[i] * analysisData[i + period];
-            energy1 += analysisData[i] * analysisData[i];
-            energy2 += analysisData[i + period] * analysisData[i + period];
-        }
-        
-        // Normalized correlation
-        float normalizedCorr = correlation / std::sqrt(energy1 * energy2 + 1e-10f);
-        
-        if (normalizedCorr > maxCorrelation)
-        {
-            maxCorrelation = normalizedCorr;
-            bestPeriod = period;
-        }
-    }
+    auto& tracker = *pitchTrackers[static_cast<size_t>(channel)];
     
-    // Return frequency if correlation is strong enough
-    if (maxCorrelation > 0.3f)
+    if (voiced)
+        tracker.process(input, numSamples, pitchOutput);
+    else
+        tracker.skip(input, numSamples, pitchOutput);
+}
+
+void PitchCorrectionEngine::trackLinkedPitch(const float* input, int numSamples, float* pitchOutput, bool voiced)
+{
+    if (voiced)
+        linkedTracker->process(input, numSamples, pitchOutput);
+    else
+        linkedTracker->skip(input, numSamples, pitchOutput);
+}
+
+bool PitchCorrectionEngine::detectVoicing(int channel, const float* input, int numSamples)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(voicingGates.size())))
     {
-        return static_cast<float>(currentSampleRate) / bestPeriod;
+        jassertfalse;
+        return true;
     }
     
-    return 0.0f;
+    return voicingGates[static_cast<size_t>(channel)]->process(input, numSamples);
 }
 
-float PitchCorrectionEngine::detectPitchYIN(const float* input, int numSamples)
+bool PitchCorrectionEngine::detectLinkedVoicing(const float* input, int numSamples)
 {
-    if (numSamples < 200)
-        return 0.0f;
-    
-    int maxTau = std::min(numSamples / 2, static_cast<int>(currentSampleRate / 80.0));
-    std::vector<float> yinBuffer(maxTau);
+    return linkedVoicingGate.process(input, numSamples);
+}
+
+PitchCorrectionEngine::Voicing PitchCorrectionEngine::updateVoicing(int channel, bool voiced)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(voicingStates.size())))
+    {
+        jassertfalse;
+        return Voicing::Voiced;
+    }
     
-    // Step 1: Difference function
-    yinBuffer[0] = 1.0f;
-    float runningSum = 0.0f;
+    auto& state = voicingStates[static_cast<size_t>(channel)];
     
-    for (int tau = 1; tau < maxTau; ++tau)
+    if (voiced != state.voiced)
     {
-        yinBuffer[tau] = 0.0f;
+        // The output carries this block one total latency from now. A change
+        // back before a pending one lands leaves the output where it was.
+        state.voiced = voiced;
+        state.switchCountdown = state.switchCountdown > 0 ? 0 : getLatencySamples() + lookaheadSamples;
         
-        for (int i = 0; i < numSamples - tau; ++i)
+        if (voiced && state.suspended)
         {
-            float delta = input[i] - input[i + tau];
-            yinBuffer[tau] += delta * delta;
+            resetShifterChannel(channel);
+            state.suspended = false;
         }
-        
-        // Step 2: Cumulative mean normalized difference
-        runningSum += yinBuffer[tau];
-        yinBuffer[tau] *= tau / runningSum;
     }
     
-    // Step 3: Absolute threshold
-    const float threshold = 0.1f;
-    int tau = 1;
+    state.unvoicedBlocks = voiced ? 0 : state.unvoicedBlocks + 1;
     
-    while (tau < maxTau - 1 && yinBuffer[tau] > threshold)
-        ++tau;
+    if (! voiced && state.unvoicedBlocks >= suspendAfterBlocks && state.switchCountdown == 0 && state.wetGain == 0.0f)
+        state.suspended = true;
     
-    if (tau == maxTau - 1)
-        return 0.0f;
+    if (state.suspended)
+        return Voicing::Suspended;
     
-    // Step 4: Parabolic interpolation
-    float x0 = (tau < 1) ? tau : tau - 1;
-    float x2 = (tau + 1 < maxTau) ? tau + 1 : tau;
-    
-    float a = (yinBuffer[static_cast<int>(x0)] + yinBuffer[static_cast<int>(x2)] - 2 * yinBuffer[tau]) / 2;
-    float b = (yinBuffer[static_cast<int>(x2)] - yinBuffer[static_cast<int>(x0)]) / 2;
-    
-    float betterTau = tau;
-    if (a != 0.0f)
-        betterTau = tau - b / (2 * a);
-    
-    return static_cast<float>(currentSampleRate) / betterTau;
+    return voiced ? Voicing::Voiced : Voicing::Unvoiced;
 }
 
-float PitchCorrectionEngine::detectPitchSpectral(const float* input, int numSamples)
+void PitchCorrectionEngine::bypass(int channel, float* audio, int numSamples)
 {
-    std::vector<float> spectrum(fftSize / 2 + 1);
-    performFFT(input, spectrum);
-    
-    // Find the spectral peak
-    int peakBin = 0;
-    float maxMagnitude = 0.0f;
-    
-    // Look for peaks in the vocal range (80 Hz - 2000 Hz)
-    int minBin = static_cast<int>(80.0f * fftSize / currentSampleRate);
-    int maxBin = static_cast<int>(2000.0f * fftSize / currentSampleRate);
-    
-    for (int i = minBin; i < std::min(maxBin, static_cast<int>(spectrum.size())); ++i)
+    // Both delay lines keep recording, so resuming reads real history
+    applyLookahead(channel, audio, numSamples);
+    delayDry(channel, audio, audio, numSamples);
+}
+
+void PitchCorrectionEngine::delayDry(int channel, const float* input, float* dryOutput, int numSamples)
+{
+    if (! isPositiveAndBelow(channel, dryRing.getNumChannels()))
     {
-        if (spectrum[i] > maxMagnitude)
-        {
-            maxMagnitude = spectrum[i];
-            peakBin = i;
-        }
+        jassertfalse;
+        return;
     }
     
-    if (peakBin > 0 && maxMagnitude > 0.1f)
+    auto* ring = dryRing.getWritePointer(channel);
+    int& writePosition = dryWritePositions[static_cast<size_t>(channel)];
+    const int ringSize = dryRingMask + 1;
+    
+    // The whole block goes in before the delayed block comes out, so the
+    // input and output may be the same buffer
+    for (int done = 0; done < numSamples;)
     {
-        // Parabolic interpolation for better frequency resolution
-        float y1 = peakBin > 0 ? spectrum[peakBin - 1] : 0.0f;
-        float y2 = spectrum[peakBin];
-        float y3 = peakBin < spectrum.size() - 1 ? spectrum[peakBin + 1] : 0.0f;
-        
-        float a = (y1 + y3 - 2 * y2) / 2;
-        float b = (y3 - y1) / 2;
-        
-        float peakOffset = 0.0f;
-        if (a != 0.0f)
-            peakOffset = -b / (2 * a);
-        
-        float interpolatedBin = peakBin + peakOffset;
-        return interpolatedBin * static_cast<float>(currentSampleRate) / fftSize;
+        const int part = jmin(numSamples - done, ringSize - writePosition);
+        std::memcpy(ring + writePosition, input + done, sizeof(float) * static_cast<size_t>(part));
+        writePosition = (writePosition + part) & dryRingMask;
+        done += part;
     }
     
-    return 0.0f;
-}
-
-void PitchCorrectionEngine::pitchShiftPSOLA(float* audio, int numSamples, float pitchRatio)
-{
-    // Simplified PSOLA implementation
-    if (std::abs(pitchRatio - 1.0f) < 0.01f)
+    if (dryOutput == nullptr)
         return;
     
-    int frameSize = 512;
-    int hopSize = frameSize / 4;
-    
-    for (int pos = 0; pos < numSamples - frameSize; pos += hopSize)
+    int readPosition = (writePosition - numSamples - getLatencySamples()) & dryRingMask;
+    for (int done = 0; done < numSamples;)
     {
-        int frameEnd = std::min(pos + frameSize, numSamples);
-        int currentFrameSize = frameEnd - pos;
-        
-        // Apply Hann window
-        for (int i = 0; i < currentFrameSize; ++i)
-        {
-            float window = 0.5f * (1.0f - std::cos(Utils::TWO_PI * i / (currentFrameSize - 1)));
-            audio[pos + i] *= window;
-        }
-        
-        // Simple time-domain pitch shifting
-        if (pitchRatio > 1.0f)
-        {
-            // Higher pitch - compress time
-            for (int i = 0; i < currentFrameSize; ++i)
-            {
-                float sourceIndex = i / pitchRatio;
-                int index1 = static_cast<int>(sourceIndex);
-                int index2 = index1 + 1;
-                
-                if (index2 < currentFrameSize)
-                {
-                    float frac = sourceIndex - index1;
-                    audio[pos + i] = audio[pos + index1] * (1.0f - frac) + audio[pos + index2] * frac;
-                }
-            }
-        }
-        else if (pitchRatio < 1.0f)
-        {
-            // Lower pitch - expand time
-            for (int i = currentFrameSize - 1; i >= 0; --i)
-            {
-                float sourceIndex = i * pitchRatio;
-                int index1 = static_cast<int>(sourceIndex);
-                int index2 = index1 + 1;
-                
-                if (index2 < currentFrameSize && index1 >= 0)
-                {
-                    float frac = sourceIndex - index1;
-                    audio[pos + i] = audio[pos + index1] * (1.0f - frac) + audio[pos + index2] * frac;
-                }
-            }
-        }
+        const int part = jmin(numSamples - done, ringSize - readPosition);
+        std::memcpy(dryOutput + done, ring + readPosition, sizeof(float) * static_cast<size_t>(part));
+        readPosition = (readPosition + part) & dryRingMask;
+        done += part;
     }
 }
 
-void PitchCorrectionEngine::pitchShiftGranular(float* audio, int numSamples, float pitchRatio)
+const PitchTracker* PitchCorrectionEngine::getPitchTracker(int channel) const
 {
-    // Get available grain
-    GrainData* grain = getNextGrain();
-    if (!grain || !grain->buffer)
+    return isPositiveAndBelow(channel, static_cast<int>(pitchTrackers.size()))
+        ? pitchTrackers[static_cast<size_t>(channel)].get() : nullptr;
+}
+
+void PitchCorrectionEngine::setLookaheadSamples(int numSamples)
+{
+    lookaheadSamples = jlimit(0, maxLookaheadSamples, numSamples);
+}
+
+void PitchCorrectionEngine::applyLookahead(int channel, float* audio, int numSamples)
+{
+    if (! isPositiveAndBelow(channel, lookaheadRing.getNumChannels()))
+    {
+        jassertfalse;
         return;
+    }
     
-    // Copy input to grain buffer
-    int grainSamples = std::min(grain->size, numSamples);
-    std::memcpy(grain->buffer, audio, grainSamples * sizeof(float));
-    
-    // Process grain
-    processGrain(*grain, pitchRatio, 1.0f);
+    // The ring always records, so changing the lookahead reads real history
+    auto* ring = lookaheadRing.getWritePointer(channel);
+    int& writePosition = lookaheadWritePositions[static_cast<size_t>(channel)];
     
-    // Apply window and copy back
-    for (int i = 0; i < grainSamples; ++i)
+    for (int i = 0; i < numSamples; ++i)
     {
-        float window = 0.5f * (1.0f - std::cos(Utils::TWO_PI * i / (grainSamples - 1)));
-        audio[i] = grain->buffer[i] * window;
+        ring[writePosition] = audio[i];
+        audio[i] = ring[(writePosition - lookaheadSamples) & lookaheadRingMask];
+        writePosition = (writePosition + 1) & lookaheadRingMask;
     }
 }
 
-void PitchCorrectionEngine::pitchShiftSpectral(float* audio, int numSamples, float pitchRatio)
+void PitchCorrectionEngine::runShifter(ShiftMode mode, int channel, float* audio, int numSamples,
+                                       const float* ratioCurve, int numRatios, const float* pitches)
 {
-    if (numSamples < fftSize)
-        return;
+    applyLookahead(channel, audio, numSamples);
     
-    // Perform FFT
-    std::vector<float> spectrum(fftSize / 2 + 1);
-    performFFT(audio, spectrum);
+    if (! isPositiveAndBelow(channel, static_cast<int>(voicingStates.size())))
+    {
+        jassertfalse;
+        return;
+    }
     
-    // Shift spectrum
-    std::vector<float> shiftedSpectrum(fftSize / 2 + 1, 0.0f);
+    auto& state = voicingStates[static_cast<size_t>(channel)];
     
-    for (int i = 0; i < spectrum.size(); ++i)
+    // A new mode means another shifter unless the modulated delay runs them
+    // all. It restarts, so it plays nothing from before the switch, and stays
+    // faded out until its output is valid: one latency after this block,
+    // counted from the block start. Meanwhile this block still comes from the
+    // outgoing shifter, fading to dry.
+    ShiftMode outgoing = ShiftMode::None;
+    if (mode != state.mode)
     {
-        int targetBin = static_cast<int>(i * pitchRatio);
-        if (targetBin < shiftedSpectrum.size())
+        if (state.mode != ShiftMode::None && shifterBackend == ShifterBackend::Standard)
         {
-            shiftedSpectrum[targetBin] = spectrum[i];
+            if (state.wetGain > 0.0f)
+                outgoing = state.mode;
+            
+            if (mode == ShiftMode::Classic)
+                granularShifter.resetChannel(channel);
+            else if (mode == ShiftMode::Hard)
+                psolaShifter.resetChannel(channel);
+            else
+                phaseVocoder.resetChannel(channel);
+            
+            state.refillCountdown = getLatencySamples() + numSamples;
         }
+        
+        state.mode = mode;
     }
     
-    // Perform IFFT
-    performIFFT(shiftedSpectrum, audio);
-}
-
-void PitchCorrectionEngine::preserveFormants(float* audio, int numSamples, float pitchRatio)
-{
-    // Simple formant preservation by envelope extraction and reapplication
-    std::vector<float> formantEnvelope;
-    extractFormantEnvelope(audio, numSamples, formantEnvelope);
-    applyFormantEnvelope(audio, numSamples, formantEnvelope);
-}
-
-void PitchCorrectionEngine::extractFormantEnvelope(const float* input, int numSamples, std::vector<float>& formants)
-{
-    // Simplified formant extraction using spectral envelope
-    std::vector<float> spectrum(fftSize / 2 + 1);
-    performFFT(input, spectrum);
+    const bool steadyVoiced = state.voiced && state.switchCountdown == 0 && state.refillCountdown == 0 && state.wetGain == 1.0f;
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* dry = steadyVoiced ? nullptr : workspace.allocate(numSamples);
     
-    formants.resize(spectrum.size());
+    delayDry(channel, audio, dry, numSamples);
     
-    // Smooth the spectrum to get formant envelope
-    int smoothingWindow = 8;
-    for (int i = 0; i < spectrum.size(); ++i)
+    if (outgoing != ShiftMode::None)
     {
-        float sum = 0.0f;
-        int count = 0;
-        
-        for (int j = std::max(0, i - smoothingWindow); j <= std::min(static_cast<int>(spectrum.size()) - 1, i + smoothingWindow); ++j)
+        // The incoming shifter takes the block to refill; its output is not heard
+        if (float* incoming = workspace.allocate(numSamples))
         {
-            sum += spectrum[j];
-            ++count;
+            std::memcpy(incoming, audio, sizeof(float) * static_cast<size_t>(numSamples));
+            shift(mode, channel, incoming, numSamples, ratioCurve, numRatios, pitches);
+            shift(outgoing, channel, audio, numSamples, ratioCurve, numRatios, pitches);
         }
-        
-        formants[i] = count > 0 ? sum / count : 0.0f;
-    }
-}
-
-void PitchCorrectionEngine::applyFormantEnvelope(float* audio, int numSamples, const std::vector<float>& formants)
-{
-    // Apply formant envelope to the audio
-    std::vector<float> spectrum(fftSize / 2 + 1);
-    performFFT(audio, spectrum);
-    
-    // Apply formant envelope
-    for (int i = 0; i < std::min(spectrum.size(), formants.size()); ++i)
-    {
-        if (formants[i] > 0.0f && spectrum[i] > 0.0f)
+        else
         {
-            spectrum[i] *= formants[i] / (spectrum[i] + 1e-10f);
+            jassertfalse;
+            shift(mode, channel, audio, numSamples, ratioCurve, numRatios, pitches);
         }
     }
+    else
+    {
+        shift(mode, channel, audio, numSamples, ratioCurve, numRatios, pitches);
+    }
     
-    // Convert back to time domain
-    performIFFT(spectrum, audio);
-}
-
-void PitchCorrectionEngine::initializeGrains()
-{
-    grainBuffers.setSize(maxGrains, grainSize);
-    grainBuffers.clear();
+    if (dry == nullptr)
+        return;
     
-    for (int i = 0; i < maxGrains; ++i)
+    // Fade between the shifter and the dry signal, switching direction when
+    // the block that changed the decision reaches the output
+    for (int i = 0; i < numSamples; ++i)
     {
-        grains[i].buffer = grainBuffers.getWritePointer(i);
-        grains[i].size = grainSize;
-        grains[i].position = 0;
-        grains[i].phase = 0.0f;
-        grains[i].amplitude = 0.0f;
-        grains[i].active = false;
+        if (state.switchCountdown > 0)
+            --state.switchCountdown;
+        
+        if (state.refillCountdown > 0)
+            --state.refillCountdown;
+        
+        const bool wet = (state.switchCountdown > 0 ? ! state.voiced : state.voiced) && state.refillCountdown == 0;
+        state.wetGain = wet ? jmin(1.0f, state.wetGain + voicingFadeStep)
+                            : jmax(0.0f, state.wetGain - voicingFadeStep);
+        audio[i] = dry[i] + state.wetGain * (audio[i] - dry[i]);
     }
 }
 
-void PitchCorrectionEngine::releaseGrains()
+void PitchCorrectionEngine::shift(ShiftMode mode, int channel, float* audio, int numSamples,
+                                  const float* ratioCurve, int numRatios, const float* pitches)
 {
-    for (auto& grain : grains)
-    {
-        grain.buffer = nullptr;
-        grain.active = false;
-    }
+    if (shifterBackend == ShifterBackend::ModulatedDelay)
+        modulatedDelayShifter.process(channel, audio, numSamples, ratioCurve, numRatios, pitches);
+    else if (mode == ShiftMode::Classic)
+        granularShifter.process(channel, audio, numSamples, ratioCurve, numRatios, pitches);
+    else if (mode == ShiftMode::Hard)
+        psolaShifter.process(channel, audio, numSamples, ratioCurve, numRatios, pitches);
+    else
+        phaseVocoder.process(channel, audio, numSamples, ratioCurve, numRatios);
 }
 
-PitchCorrectionEngine::GrainData* PitchCorrectionEngine::getNextGrain()
+void PitchCorrectionEngine::correctPitch(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
 {
-    // Round-robin grain selection
-    GrainData* grain = &grains[currentGrain];
-    currentGrain = (currentGrain + 1) % maxGrains;
-    
-    // Reset grain
-    grain->position = 0;
-    grain->phase = 0.0f;
-    grain->amplitude = 1.0f;
-    grain->active = true;
-    
-    return grain;
+    runShifter(ShiftMode::Classic, channel, audio, numSamples, ratioCurve, numRatios, pitches);
 }
 
-void PitchCorrectionEngine::processGrain(GrainData& grain, float pitchRatio, float speed)
+void PitchCorrectionEngine::correctPitchHard(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
 {
-    if (!grain.active || !grain.buffer)
-        return;
-    
-    // Simple pitch shifting by sample rate conversion
-    for (int i = 0; i < grain.size; ++i)
-    {
-        float sourceIndex = i / pitchRatio;
-        int index1 = static_cast<int>(sourceIndex);
-        int index2 = std::min(index1 + 1, grain.size - 1);
-        
-        if (index1 < grain.size)
-        {
-            float frac = sourceIndex - index1;
-            grain.buffer[i] = grain.buffer[index1] * (1.0f - frac) + grain.buffer[index2] * frac;
-        }
-    }
+    // Pitch-synchronous: epoch marks follow the tracked period
+    runShifter(ShiftMode::Hard, channel, audio, numSamples, ratioCurve, numRatios, pitches);
+}
+
+void PitchCorrectionEngine::correctPitchAI(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
+{
+    // Spectral path: shift and formant correction share one transform pair per hop
+    runShifter(ShiftMode::AI, channel, audio, numSamples, ratioCurve, numRatios, pitches);
 }
@@ -1,93 +1,200 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "ScratchWorkspace.h"
+#include "PitchTracker.h"
+#include "PhaseVocoder.h"
+#include "PsolaShifter.h"
+#include "GranularShifter.h"
+#include "ModulatedDelayShifter.h"
+#include "VoicingGate.h"
 #include <vector>
 #include <memory>
 
 class PitchCorrectionEngine
 {
 public:
-    PitchCorrectionEngine();
-    ~PitchCorrectionEngine();
+    // Realtime is the live configuration. Render, for offline bounces, spends
+    // several times the CPU on the same latency: a quarter of the tracker hop
+    // with a spectral octave check, 8x vocoder overlap and the fine formant
+    // envelope.
+    enum class ProcessingTier
+    {
+        Realtime,
+        Render
+    };
+    
+    // Standard runs each mode's own shifter. ModulatedDelay runs the dual-tap
+    // delay line for every mode, at a few operations per sample and with its
+    // own, shorter latency.
+    enum class ShifterBackend
+    {
+        Standard,
+        ModulatedDelay
+    };
 
-    // Initialization
-    void prepareToPlay(double sampleRate, int samplesPerBlock);
+    // What a channel runs this block. Unvoiced skips detection and fades the
+    // output to the dry signal; Suspended skips the shifter too and only
+    // delays the dry signal by the latency.
+    enum class Voicing
+    {
+        Voiced,
+        Unvoiced,
+        Suspended
+    };
+
+    explicit PitchCorrectionEngine(ScratchWorkspace& scratch);
+
+    // Initialization. maxGrains sizes the Classic-mode grain pool per channel.
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels = 2,
+                       int maxGrains = GranularShifter::defaultMaxGrains);
     void reset();
+    
+    // Floats of workspace scratch the audio-thread calls below may take at once
+    int getScratchSize() const;
 
-    // Pitch detection methods
-    void detectPitch(const float* input, int numSamples, float* pitchOutput);
-    void detectPitchAdvanced(const float* input, int numSamples, float* pitchOutput);
+    // Sliding-window tracking: one tracker per channel keeps its history across
+    // blocks, so the result does not depend on the host block size. Unvoiced
+    // input only updates the history and reports 0 Hz.
+    void trackPitch(int channel, const float* input, int numSamples, float* pitchOutput, bool voiced = true);
+    const PitchTracker* getPitchTracker(int channel) const;
+    
+    // Same, for the one analysis signal that drives every channel when the
+    // channels are linked; it keeps its own history
+    void trackLinkedPitch(const float* input, int numSamples, float* pitchOutput, bool voiced = true);
+    
+    // Voicing gate on the analysis input, per channel or linked like the
+    // trackers: whether the block ends voiced
+    bool detectVoicing(int channel, const float* input, int numSamples);
+    bool detectLinkedVoicing(const float* input, int numSamples);
+    
+    // Audio thread, once per channel and block before trackPitch() and the
+    // correct* calls, with the gate's decision for the channel's analysis
+    // input. The output follows the decision one total latency later, with a
+    // voicingCrossfadeSeconds fade between the shifter and the delayed dry
+    // signal. After suspendAfterBlocks unvoiced blocks, once the fade is
+    // done, the channel is Suspended: call bypass() instead of correct*.
+    // Resuming restarts the channel's shifter, which has refilled by the
+    // time the voiced input reaches the output.
+    Voicing updateVoicing(int channel, bool voiced);
+    void bypass(int channel, float* audio, int numSamples);
+    
+    void setSuspendAfterBlocks(int numBlocks) { suspendAfterBlocks = jmax(1, numBlocks); }
+    static constexpr int defaultSuspendAfterBlocks = 8;
+    static constexpr double voicingCrossfadeSeconds = 0.005;
     
     // Pitch correction methods
-    void correctPitch(float* audio, int numSamples, float targetFreq, float speed, float amount);
-    void correctPitchHard(float* audio, int numSamples, float targetFreq, float speed, float amount);
-    void correctPitchAI(float* audio, int numSamples, float targetFreq, float speed, float amount);
-    
-    // Analysis methods
-    float calculateRMS(const float* buffer, int numSamples);
-    void performFFT(const float* input, std::vector<float>& magnitudeOutput);
-    void performIFFT(const std::vector<float>& magnitudeInput, float* output);
+    // Each call shifts one channel of a whole host block. The ratio curve holds
+    // numRatios control-rate pitch ratios spread evenly across the block, read
+    // with linear interpolation between points (one point = constant ratio for
+    // the block); the output is delayed by getLatencySamples().
+    // Classic and Hard mode also take the per-sample pitch from trackPitch(),
+    // to schedule grains and place epoch marks; AI mode only uses it, when
+    // given, for the modulated delay's splices.
+    // When a channel moves to another mode's shifter, that shifter restarts
+    // from silence: the outgoing one fades out over voicingCrossfadeSeconds
+    // and the incoming one fades in once it has refilled.
+    void correctPitch(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches);
+    void correctPitchHard(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches);
+    void correctPitchAI(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches = nullptr);
+    
+    // Latency of the shifters alone, the same for every mode; it depends on
+    // the backend
+    int getLatencySamples() const { return getLatencySamples(shifterBackend); }
+    int getLatencySamples(ShifterBackend backend) const;
+    
+    // Audio thread, once per block before the correct* calls. The shifters
+    // that take over start from silence.
+    void setShifterBackend(ShifterBackend newBackend);
+    ShifterBackend getShifterBackend() const { return shifterBackend; }
+    
+    // Lookahead: the correct* calls delay the audio by this many samples in
+    // front of the shifter, while trackPitch() still sees the undelayed input.
+    // The tracker's estimate for a note onset is then ready by the time the
+    // onset reaches the shifter. Audio thread; clamped to the maximum, and the
+    // total delay is getLatencySamples() + getLookaheadSamples().
+    void setLookaheadSamples(int numSamples);
+    int getLookaheadSamples() const { return lookaheadSamples; }
+    int getMaxLookaheadSamples() const { return maxLookaheadSamples; }
+    static constexpr double maxLookaheadSeconds = 0.04;
+    
+    // Audio thread, once per block before any other call. Buffers for both
+    // tiers are allocated in prepareToPlay(); each stage switches at its next
+    // frame boundary, so changing tier does not glitch.
+    void setProcessingTier(ProcessingTier newTier);
+    ProcessingTier getProcessingTier() const { return processingTier; }
 
 private:
+    ScratchWorkspace& workspace;
+    
     double currentSampleRate = 44100.0;
     int currentBlockSize = 512;
     
-    // Pitch detection buffers
-    AudioBuffer<float> analysisBuffer;
-    AudioBuffer<float> correlationBuffer;
-    std::vector<float> windowBuffer;
+    std::vector<std::unique_ptr<PitchTracker>> pitchTrackers;
+    std::unique_ptr<PitchTracker> linkedTracker;
+    int trackerWindowSize = 2048;
+    ProcessingTier processingTier = ProcessingTier::Realtime;
+    
+    // One shifter per mode (Classic, AI, Hard), all padded to the same latency
+    int latencySamples = 0;
+    GranularShifter granularShifter;
+    PhaseVocoder phaseVocoder;
+    PsolaShifter psolaShifter;
+    ModulatedDelayShifter modulatedDelayShifter;
+    ShifterBackend shifterBackend = ShifterBackend::Standard;
     
-    // FFT processing
-    std::unique_ptr<dsp::FFT> fft;
-    std::unique_ptr<dsp::WindowingFunction<float>> window;
-    HeapBlock<dsp::Complex<float>> frequencyData;
-    static constexpr int fftOrder = 11; // 2048 samples
-    static constexpr int fftSize = 1 << fftOrder;
+    // Lookahead delay line, one ring per channel
+    AudioBuffer<float> lookaheadRing;
+    std::vector<int> lookaheadWritePositions;
+    int lookaheadRingMask = 0;
+    int lookaheadSamples = 0;
+    int maxLookaheadSamples = 0;
     
-    // Granular synthesis for pitch shifting
-    struct GrainData
+    // Which correct* call a channel ran last
+    enum class ShiftMode
     {
-        float* buffer;
-        int size;
-        int position;
-        float phase;
-        float amplitude;
-        bool active;
-        
-        GrainData() : buffer(nullptr), size(0), position(0), phase(0.0f), amplitude(0.0f), active(false) {}
+        None,
+        Classic,
+        Hard,
+        AI
     };
     
-    std::vector<GrainData> grains;
-    static constexpr int maxGrains = 8;
-    static constexpr int grainSize = 1024;
-    AudioBuffer<float> grainBuffers;
-    int currentGrain = 0;
-    
-    // Overlap-add processing
-    AudioBuffer<float> overlapBuffer;
-    int overlapPosition = 0;
-    static constexpr int overlapSize = 2048;
-    
-    // Pitch detection methods
-    float detectPitchAutocorrelation(const float* input, int numSamples);
-    float detectPitchYIN(const float* input, int numSamples);
-    float detectPitchSpectral(const float* input, int numSamples);
-    
-    // Pitch shifting methods
-    void pitchShiftPSOLA(float* audio, int numSamples, float pitchRatio);
-    void pitchShiftGranular(float* audio, int numSamples, float pitchRatio);
-    void pitchShiftSpectral(float* audio, int numSamples, float pitchRatio);
-    
-    // Formant preservation
-    void preserveFormants(float* audio, int numSamples, float pitchRatio);
-    void extractFormantEnvelope(const float* input, int numSamples, std::vector<float>& formants);
-    void applyFormantEnvelope(float* audio, int numSamples, const std::vector<float>& formants);
-    
-    // Utility methods
-    void initializeGrains();
-    void releaseGrains();
-    GrainData* getNextGrain();
-    void processGrain(GrainData& grain, float pitchRatio, float speed);
+    // Voicing: one gate per channel plus the linked one, and per channel the
+    // dry delay line that lines the input up with the shifter output
+    struct VoicingState
+    {
+        bool voiced = true;         // last decision from updateVoicing()
+        int switchCountdown = 0;    // samples until the output follows it
+        float wetGain = 1.0f;
+        int unvoicedBlocks = 0;
+        bool suspended = false;
+        ShiftMode mode = ShiftMode::None;
+        int refillCountdown = 0;    // samples until a restarted shifter fades in
+    };
+    
+    std::vector<std::unique_ptr<VoicingGate>> voicingGates;
+    VoicingGate linkedVoicingGate;
+    std::vector<VoicingState> voicingStates;
+    AudioBuffer<float> dryRing;
+    std::vector<int> dryWritePositions;
+    int dryRingMask = 0;
+    int suspendAfterBlocks = defaultSuspendAfterBlocks;
+    float voicingFadeStep = 1.0f;
+    
+    void applyLookahead(int channel, float* audio, int numSamples);
+    void applyProcessingTier();
+    void resetShifterChannel(int channel);
+    
+    // Records the post-lookahead input; with dryOutput, also reads it back
+    // delayed by the shifter latency
+    void delayDry(int channel, const float* input, float* dryOutput, int numSamples);
+    
+    // Everything correct* shares: lookahead, dry delay, the backend's shifter
+    // for the mode, the mode switch and the voicing crossfade
+    void runShifter(ShiftMode mode, int channel, float* audio, int numSamples,
+                    const float* ratioCurve, int numRatios, const float* pitches);
+    void shift(ShiftMode mode, int channel, float* audio, int numSamples,
+               const float* ratioCurve, int numRatios, const float* pitches);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchCorrectionEngine)
 };
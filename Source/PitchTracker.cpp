@@ -0,0 +1,283 @@
+#include "PitchTracker.h"
+#include <cstring>
+
+void PitchTracker::prepare(double newSampleRate, int newWindowSize, int newHopSize, int maxBlockSize)
+{
+    sampleRate = newSampleRate;
+    windowSize = nextPowerOfTwo(jmax(64, newWindowSize));
+    minHopSize = jlimit(1, windowSize, newHopSize);
+    hopSize = nextHopSize = minHopSize;
+
+    // Lowest pitch needs one period of lag; keep half the window for the
+    // difference sum so long lags are not judged on a handful of samples
+    maxLag = jmin(windowSize / 2, static_cast<int>(std::ceil(sampleRate / minFrequency)) + 2);
+
+    history.allocate(static_cast<size_t>(windowSize), true);
+    frame.allocate(static_cast<size_t>(windowSize), true);
+
+    // Decimate to at most coarseAnalysisRate; any higher rate gets a factor
+    // of two or more
+    const int factor = jmax(1, static_cast<int>(std::ceil(sampleRate / coarseAnalysisRate - 1.0e-9)));
+    decimator.prepare(factor);
+
+    if (factor > 1)
+    {
+        const double coarseRate = sampleRate / factor;
+        coarseWindowSize = windowSize / factor;
+        coarseMaxLag = jmin(coarseWindowSize / 2, static_cast<int>(std::ceil(coarseRate / minFrequency)) + 2);
+
+        const int coarseRingSize = nextPowerOfTwo(coarseWindowSize);
+        coarseRingMask = coarseRingSize - 1;
+        coarseHistory.allocate(static_cast<size_t>(coarseRingSize), true);
+        coarseFrame.allocate(static_cast<size_t>(coarseWindowSize), true);
+        detector.prepare(coarseWindowSize);
+        fineKernel.selectBestVariant();
+    }
+    else
+    {
+        coarseWindowSize = 0;
+        detector.prepare(windowSize);
+    }
+
+    int order = 0;
+    while ((1 << order) < windowSize)
+        ++order;
+
+    spectrumFFT = std::make_unique<dsp::FFT>(order);
+    spectrum.allocate(static_cast<size_t>(windowSize * 2), true);
+    analysisWindow.allocate(static_cast<size_t>(windowSize), true);
+    for (int i = 0; i < windowSize; ++i)
+        analysisWindow[i] = 0.5f * (1.0f - std::cos(MathConstants<float>::twoPi * i / windowSize));
+
+    // Enough for the shortest hop
+    estimateCapacity = jmax(1, maxBlockSize) / minHopSize + 1;
+    estimates.allocate(static_cast<size_t>(estimateCapacity), true);
+
+    reset();
+}
+
+void PitchTracker::reset()
+{
+    if (history != nullptr)
+        std::fill(history.getData(), history.getData() + windowSize, 0.0f);
+
+    if (coarseHistory != nullptr)
+        std::fill(coarseHistory.getData(), coarseHistory.getData() + coarseRingMask + 1, 0.0f);
+
+    decimator.reset();
+    coarseWritePosition = 0;
+
+    writePosition = 0;
+    hopSize = nextHopSize;
+    samplesUntilHop = hopSize;
+    samplesProcessed = 0;
+    numEstimates = 0;
+    latest = {};
+}
+
+void PitchTracker::setHopSize(int newHopSize)
+{
+    nextHopSize = jlimit(minHopSize, windowSize, newHopSize);
+}
+
+const PitchTracker::Estimate& PitchTracker::getEstimate(int index) const
+{
+    jassert(isPositiveAndBelow(index, numEstimates));
+    return estimates[jlimit(0, jmax(0, numEstimates - 1), index)];
+}
+
+void PitchTracker::process(const float* input, int numSamples, float* pitchOutput)
+{
+    processSamples(input, numSamples, pitchOutput, true);
+}
+
+void PitchTracker::skip(const float* input, int numSamples, float* pitchOutput)
+{
+    latest.frequency = 0.0f;
+    latest.confidence = 0.0f;
+    processSamples(input, numSamples, pitchOutput, false);
+}
+
+void PitchTracker::processSamples(const float* input, int numSamples, float* pitchOutput, bool analyse)
+{
+    numEstimates = 0;
+
+    const int mask = windowSize - 1;
+    int position = 0;
+
+    while (position < numSamples)
+    {
+        // Samples before the next hop still see the previous estimate
+        const int segment = jmin(numSamples - position, samplesUntilHop);
+        for (int i = 0; i < segment; ++i)
+        {
+            history[(writePosition + i) & mask] = input[position + i];
+            pitchOutput[position + i] = latest.frequency;
+        }
+
+        if (coarseWindowSize > 0)
+        {
+            float decimated = 0.0f;
+            for (int i = 0; i < segment; ++i)
+            {
+                if (decimator.pushSample(input[position + i], decimated))
+                {
+                    coarseHistory[coarseWritePosition] = decimated;
+                    coarseWritePosition = (coarseWritePosition + 1) & coarseRingMask;
+                }
+            }
+        }
+
+        writePosition = (writePosition + segment) & mask;
+        samplesUntilHop -= segment;
+        samplesProcessed += segment;
+        position += segment;
+
+        if (samplesUntilHop == 0)
+        {
+            if (analyse)
+                analyseWindow();
+
+            hopSize = nextHopSize;
+            samplesUntilHop = hopSize;
+        }
+    }
+}
+
+void PitchTracker::analyseWindow()
+{
+    // Unroll the ring so the window runs oldest to newest
+    const int firstPart = windowSize - writePosition;
+    std::memcpy(frame.getData(), history.getData() + writePosition, sizeof(float) * static_cast<size_t>(firstPart));
+    std::memcpy(frame.getData() + firstPart, history.getData(), sizeof(float) * static_cast<size_t>(writePosition));
+
+    latest.samplePosition = samplesProcessed - windowSize / 2;
+    latest.frequency = coarseWindowSize > 0 ? estimateCoarseToFine()
+                                            : detector.estimatePitch(frame.getData(), windowSize, sampleRate, maxLag);
+
+    // The confidence stays YIN's, for the period it found
+    if (spectralCheck && latest.frequency > 0.0f)
+        latest.frequency = checkOctave(latest.frequency);
+
+    latest.confidence = latest.frequency > 0.0f ? detector.getLastConfidence() : 0.0f;
+
+    jassert(numEstimates < estimateCapacity); // block larger than prepared
+    if (numEstimates < estimateCapacity)
+        estimates[numEstimates++] = latest;
+}
+
+float PitchTracker::estimateCoarseToFine()
+{
+    // Newest coarseWindowSize decimated samples, oldest first
+    const int start = coarseWritePosition - coarseWindowSize;
+    for (int i = 0; i < coarseWindowSize; ++i)
+        coarseFrame[i] = coarseHistory[(start + i) & coarseRingMask];
+
+    const int factor = decimator.getFactor();
+    const float coarseFrequency = detector.estimatePitch(coarseFrame.getData(), coarseWindowSize, sampleRate / factor, coarseMaxLag);
+
+    if (coarseFrequency <= 0.0f)
+        return 0.0f;
+
+    // A coarse lag is accurate to about one decimated sample, i.e. factor
+    // full-rate samples, so that is all the fine search has to cover
+    const float coarseLag = static_cast<float>(sampleRate) / coarseFrequency;
+    const float fineLag = refineLag(coarseLag, factor);
+
+    return fineLag > 0.0f ? static_cast<float>(sampleRate) / fineLag : 0.0f;
+}
+
+float PitchTracker::refineLag(float coarseLag, int searchRadius) const
+{
+    constexpr int maxLags = 64;
+    searchRadius = jlimit(1, maxLags / 2 - 2, searchRadius);
+
+    const int firstLag = jmax(1, roundToInt(coarseLag) - searchRadius - 1);
+    const int numLags = searchRadius * 2 + 3;
+
+    // Keep at least half the window overlapping, as for the coarse search
+    if (firstLag + numLags > windowSize / 2)
+        return coarseLag;
+
+    // Normalised, so lags with different overlaps compare directly
+    float correlations[maxLags];
+    fineKernel.process(frame.getData(), windowSize, firstLag, firstLag + numLags, correlations);
+
+    int best = 0;
+    for (int lag = 1; lag < numLags; ++lag)
+        if (correlations[lag] > correlations[best])
+            best = lag;
+
+    // Parabolic interpolation, unless the peak sits on the search edge
+    if (best == 0 || best == numLags - 1)
+        return static_cast<float>(firstLag + best);
+
+    const float a = (correlations[best - 1] + correlations[best + 1] - 2.0f * correlations[best]) / 2.0f;
+    const float b = (correlations[best + 1] - correlations[best - 1]) / 2.0f;
+
+    return firstLag + best - (a < 0.0f ? b / (2.0f * a) : 0.0f);
+}
+
+float PitchTracker::checkOctave(float frequency)
+{
+    // Magnitude spectrum of the window, written over the front of the FFT buffer
+    float* data = spectrum.getData();
+    for (int i = 0; i < windowSize; ++i)
+        data[i] = frame[i] * analysisWindow[i];
+
+    spectrumFFT->performRealOnlyForwardTransform(data, true);
+
+    for (int k = 0; k <= windowSize / 2; ++k)
+        data[k] = std::sqrt(data[k * 2] * data[k * 2] + data[k * 2 + 1] * data[k * 2 + 1]);
+
+    // Subharmonic summation decays fast enough that half the frequency only
+    // wins when the odd harmonics of it are really there
+    const float lower = frequency * 0.5f;
+    if (lower >= minFrequency && harmonicSalience(lower) > harmonicSalience(frequency) * octaveSwitchMargin)
+        return lower;
+
+    // It leans the other way for double the frequency, so that takes the odd
+    // harmonics of the estimate itself (fundamental included) being next to
+    // nothing against the even ones
+    const float limit = jmin(spectralCheckMaxFrequency, static_cast<float>(sampleRate * 0.5));
+    if (frequency * 4.0f <= limit)
+    {
+        float odd = 0.0f, even = 0.0f;
+        for (int harmonic = 1; harmonic * frequency <= limit; ++harmonic)
+        {
+            const float peak = harmonicPeak(harmonic * frequency);
+            (harmonic % 2 != 0 ? odd : even) += peak * peak;
+        }
+
+        if (odd < even * missingOddPowerRatio)
+            return frequency * 2.0f;
+    }
+
+    return frequency;
+}
+
+float PitchTracker::harmonicPeak(float frequency) const
+{
+    // Strongest bin within one of the harmonic, which covers the Hann main
+    // lobe and the small error in the estimate
+    const int bin = roundToInt(frequency * static_cast<float>(windowSize / sampleRate));
+    const int lastBin = windowSize / 2;
+
+    return jmax(spectrum[jlimit(0, lastBin, bin - 1)], spectrum[jlimit(0, lastBin, bin)], spectrum[jlimit(0, lastBin, bin + 1)]);
+}
+
+float PitchTracker::harmonicSalience(float frequency) const
+{
+    const float limit = jmin(spectralCheckMaxFrequency, static_cast<float>(sampleRate * 0.5));
+
+    float salience = 0.0f;
+    float weight = 1.0f;
+
+    for (int harmonic = 1; harmonic * frequency <= limit; ++harmonic)
+    {
+        salience += weight * harmonicPeak(harmonic * frequency);
+        weight *= harmonicDecay;
+    }
+
+    return salience;
+}
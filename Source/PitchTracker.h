@@ -0,0 +1,134 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "YinPitchDetector.h"
+#include "AutocorrelationKernel.h"
+#include "PolyphaseDecimator.h"
+#include <memory>
+
+// Streaming pitch tracker. Input is kept in a history ring across host
+// blocks and a fixed analysis window is re-analysed (FFT YIN) every hop
+// samples, so the estimates depend only on the signal and the sample rate,
+// not on how the host slices it. Each analysis produces a timestamped
+// estimate; process() also writes the most recent pitch for every sample.
+//
+// Above coarseAnalysisRate, i.e. at every common host rate, the lag search
+// runs coarse-to-fine: a streaming decimator keeps a second history at
+// sampleRate / ceil(sampleRate / coarseAnalysisRate) (a factor of 4 at
+// 44.1 kHz, 5 at 48 kHz, 9 at 96 kHz), YIN finds the period there, and only
+// the few full-rate lags around it are evaluated, as a normalised
+// autocorrelation through the SIMD kernel.
+//
+// For offline renders the hop can be shortened and each YIN estimate
+// cross-checked against the window's spectrum. Half the estimate replaces it
+// when subharmonic summation scores it clearly higher, double the estimate
+// when the estimate's odd harmonics are all but missing. YIN reads the
+// waveform and the check reads harmonic peaks, so they mostly disagree where
+// the signal is changing within the window, and that is where YIN's octave
+// errors come from.
+class PitchTracker
+{
+public:
+    struct Estimate
+    {
+        int64 samplePosition = 0;   // stream time of the window centre, in samples
+        float frequency = 0.0f;     // Hz, 0 when unvoiced
+        float confidence = 0.0f;    // 0..1
+    };
+
+    PitchTracker() = default;
+
+    // Message thread. windowSize is rounded up to a power of two; maxBlockSize
+    // bounds the number of estimates a single process() call can emit. hopSize
+    // is also the shortest hop setHopSize() accepts later.
+    void prepare(double sampleRate, int windowSize, int hopSize, int maxBlockSize);
+    void reset();
+
+    // Audio thread: hop between analyses, from the prepared hop up to the
+    // window size. Takes effect once the hop in progress completes.
+    void setHopSize(int newHopSize);
+
+    // Audio thread: cross-check every estimate against the spectrum of its
+    // window, at the cost of one window-sized FFT per hop
+    void setSpectralCheck(bool shouldCheck) { spectralCheck = shouldCheck; }
+    bool isSpectralCheckEnabled() const { return spectralCheck; }
+
+    // Audio thread: pitchOutput receives the latest estimate (Hz) per sample
+    void process(const float* input, int numSamples, float* pitchOutput);
+
+    // Audio thread: keeps the history current but runs no analysis and
+    // reports unvoiced, for input the voicing gate has already rejected. The
+    // window is complete again as soon as analysis resumes.
+    void skip(const float* input, int numSamples, float* pitchOutput);
+
+    // Estimates emitted by the last process() call, oldest first
+    int getNumEstimates() const { return numEstimates; }
+    const Estimate& getEstimate(int index) const;
+    const Estimate& getLatestEstimate() const { return latest; }
+
+    int getWindowSize() const { return windowSize; }
+    int getHopSize() const { return nextHopSize; }
+    int64 getSamplesProcessed() const { return samplesProcessed; }
+
+    int getDecimationFactor() const { return decimator.getFactor(); }
+
+    static constexpr float minFrequency = 80.0f;
+    static constexpr double coarseAnalysisRate = 11025.0;
+
+    // Spectral check: harmonics up to spectralCheckMaxFrequency count. In the
+    // subharmonic sum each is weighted by harmonicDecay to the power of its
+    // number minus one, and half the estimate has to score octaveSwitchMargin
+    // times higher. Double it needs odd harmonics under missingOddPowerRatio
+    // of the even ones' power.
+    static constexpr float spectralCheckMaxFrequency = 5000.0f;
+    static constexpr float harmonicDecay = 0.84f;
+    static constexpr float octaveSwitchMargin = 1.1f;
+    static constexpr float missingOddPowerRatio = 0.01f;
+
+private:
+    YinPitchDetector detector;
+
+    double sampleRate = 44100.0;
+    int windowSize = 2048;
+    int hopSize = 128;      // the hop in progress
+    int nextHopSize = 128;
+    int minHopSize = 128;
+    int maxLag = 0;
+
+    HeapBlock<float> history;       // windowSize ring
+    HeapBlock<float> frame;         // unrolled window handed to the detector
+    int writePosition = 0;
+    int samplesUntilHop = 0;
+    int64 samplesProcessed = 0;
+
+    // Decimated copy of the history for the coarse search
+    PolyphaseDecimator decimator;
+    HeapBlock<float> coarseHistory;
+    HeapBlock<float> coarseFrame;
+    int coarseWindowSize = 0;
+    int coarseRingMask = 0;
+    int coarseWritePosition = 0;
+    int coarseMaxLag = 0;
+    AutocorrelationKernel fineKernel;   // variant picked in prepare()
+
+    // Spectral cross-check
+    std::unique_ptr<dsp::FFT> spectrumFFT;  // windowSize points
+    HeapBlock<float> spectrum;              // 2 * windowSize, in place
+    HeapBlock<float> analysisWindow;        // Hann, windowSize
+    bool spectralCheck = false;
+
+    HeapBlock<Estimate> estimates;
+    int estimateCapacity = 0;
+    int numEstimates = 0;
+    Estimate latest;
+
+    void processSamples(const float* input, int numSamples, float* pitchOutput, bool analyse);
+    void analyseWindow();
+    float estimateCoarseToFine();
+    float refineLag(float coarseLag, int searchRadius) const;
+    float checkOctave(float frequency);
+    float harmonicPeak(float frequency) const;
+    float harmonicSalience(float frequency) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchTracker)
+};
@@ -96,6 +96,7 @@ void AutoTuneAudioProcessorEditor::setupControls()
     scaleSelector.addItem("Major", 1);
     scaleSelector.addItem("Minor", 2);
     scaleSelector.addItem("Chromatic", 3);
+    scaleSelector.addItem("Custom", 4);
     scaleSelector.setSelectedId(1);
     addAndMakeVisible(scaleSelector);
     
@@ -14,9 +14,10 @@ AutoTuneAudioProcessor::AutoTuneAudioProcessor()
     pluginParameters(),
     parameters(*this, nullptr, Identifier("AutoTuneParameters"), pluginParameters.createParameterLayout()),
     presetManager(parameters),
-    pitchEngine(),
+    workspace(),
+    pitchEngine(workspace),
     modeSelector(),
-    aiModelLoader()
+    aiModelLoader(workspace)
 {
     // Add parameter listeners
     parameters.addParameterListener(Parameters::SPEED_ID, this);
@@ -24,9 +25,22 @@ AutoTuneAudioProcessor::AutoTuneAudioProcessor()
     parameters.addParameterListener(Parameters::MODE_ID, this);
     parameters.addParameterListener(Parameters::KEY_ID, this);
     parameters.addParameterListener(Parameters::SCALE_ID, this);
+    parameters.addParameterListener(Parameters::CHANNEL_LINK_ID, this);
+    parameters.addParameterListener(Parameters::LATENCY_MODE_ID, this);
+    parameters.addParameterListener(Parameters::LOOKAHEAD_ID, this);
+    parameters.addParameterListener(Parameters::SHIFTER_ID, this);
+
+    customTuning = ScaleQuantizer::fromNoteMask(customScaleMask);
+    updateScaleTable();
 
     // Initialize pitch correction engine
     pitchEngine.prepareToPlay(44100.0, 512);
+    aiModelLoader.prepareToPlay(44100.0, 512);
+    workspace.prepare(getScratchSize());
+    
+    // AI mode runs the CREPE network when a model is installed and the
+    // tracked fallback otherwise
+    aiModelLoader.loadModels();
     
     // Initialize FFT
     fft = std::make_unique<dsp::FFT>(fftOrder);
@@ -36,11 +50,16 @@ AutoTuneAudioProcessor::AutoTuneAudioProcessor()
 
 AutoTuneAudioProcessor::~AutoTuneAudioProcessor()
 {
+    cancelPendingUpdate();
     parameters.removeParameterListener(Parameters::SPEED_ID, this);
     parameters.removeParameterListener(Parameters::AMOUNT_ID, this);
     parameters.removeParameterListener(Parameters::MODE_ID, this);
     parameters.removeParameterListener(Parameters::KEY_ID, this);
     parameters.removeParameterListener(Parameters::SCALE_ID, this);
+    parameters.removeParameterListener(Parameters::CHANNEL_LINK_ID, this);
+    parameters.removeParameterListener(Parameters::LATENCY_MODE_ID, this);
+    parameters.removeParameterListener(Parameters::LOOKAHEAD_ID, this);
+    parameters.removeParameterListener(Parameters::SHIFTER_ID, this);
 }
 
 const String AutoTuneAudioProcessor::getProgramName(int index)
@@ -60,13 +79,19 @@ void AutoTuneAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     currentBlockSize = samplesPerBlock;
 
     // Prepare pitch correction engine
-    pitchEngine.prepareToPlay(sampleRate, samplesPerBlock);
+    pitchEngine.prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+    aiModelLoader.prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+    updateLatency();
+
+    // One scratch block shared by everything that runs on the audio thread
+    workspace.prepare(getScratchSize());
 
     // Initialize buffers
     pitchBuffer.setSize(2, samplesPerBlock);
     correctedBuffer.setSize(2, samplesPerBlock);
     overlapBuffer.setSize(2, overlapSize);
     fftBuffer.setSize(1, fftSize);
+    ratioCurve.resize(static_cast<size_t>(samplesPerBlock / controlInterval + 1));
 
     overlapBuffer.clear();
     overlapPosition = 0;
@@ -108,9 +133,9 @@ bool AutoTuneAudioProcessor::isBusesLayoutSupported(const AudioProcessor::BusesL
     ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Any channel count works: every channel gets its own shifter state, and
+    // the analysis is either per channel or linked across all of them
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
 #if !JucePlugin_IsSynth
@@ -127,6 +152,8 @@ void AutoTuneAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
 {
     ignoreUnused(midiMessages);
 
+    // Nothing below may touch the heap; trap builds count it if something does
+    AllocationTrap::ScopedArm allocationTrap;
     ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -138,6 +165,16 @@ void AutoTuneAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     if (buffer.getNumSamples() == 0)
         return;
 
+    // Pick up the scale table if key or scale changed since the last block
+    scaleQuantizer.acquireLatestTable();
+    pitchEngine.setLookaheadSamples(appliedLookaheadSamples.load());
+    pitchEngine.setShifterBackend(appliedShifterBackend.load());
+
+    // Offline bounces get the heavier analysis; the latency is the same
+    pitchEngine.setProcessingTier(isNonRealtime() ? PitchCorrectionEngine::ProcessingTier::Render
+                                                  : PitchCorrectionEngine::ProcessingTier::Realtime);
+    aiModelLoader.setSynchronousInference(isNonRealtime());
+
     // Update smoothed parameter values
     speedSmoothed.setTargetValue(*parameters.getRawParameterValue(Parameters::SPEED_ID));
     amountSmoothed.setTargetValue(*parameters.getRawParameterValue(Parameters::AMOUNT_ID));
@@ -147,8 +184,21 @@ void AutoTuneAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
         static_cast<int>(*parameters.getRawParameterValue(Parameters::MODE_ID))
     );
 
+    // Every buffer and scratch slice is sized for the block size promised in
+    // prepareToPlay, so hosts that overshoot it get processed in slices
+    const int numSamples = buffer.getNumSamples();
+    for (int start = 0; start < numSamples; start += currentBlockSize)
+    {
+        AudioBuffer<float> subBlock(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                    start, jmin(currentBlockSize, numSamples - start));
+        processSubBlock(subBlock, currentMode);
+    }
+}
+
+void AutoTuneAudioProcessor::processSubBlock(AudioBuffer<float>& buffer, Parameters::Mode mode)
+{
     // Process based on selected mode
-    switch (currentMode)
+    switch (mode)
     {
         case Parameters::Mode::Classic:
             processClassicMode(buffer);
@@ -162,57 +212,203 @@ void AutoTuneAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     }
 }
 
+int AutoTuneAudioProcessor::getScratchSize() const
+{
+    // Pitch curve and linked-analysis mix, plus whatever the components ask
+    // for
+    return 2 * ScratchWorkspace::slotSize(currentBlockSize)
+         + pitchEngine.getScratchSize()
+         + aiModelLoader.getScratchSize();
+}
+
+int AutoTuneAudioProcessor::getNumRatioPoints(int numSamples) const
+{
+    const int numPoints = (numSamples + controlInterval - 1) / controlInterval;
+    return jlimit(1, static_cast<int>(ratioCurve.size()), numPoints);
+}
+
+Parameters::ChannelLink AutoTuneAudioProcessor::getChannelLink(int numChannels) const
+{
+    if (numChannels < 2)
+        return Parameters::ChannelLink::Off;
+    
+    return static_cast<Parameters::ChannelLink>(
+        static_cast<int>(*parameters.getRawParameterValue(Parameters::CHANNEL_LINK_ID))
+    );
+}
+
+const float* AutoTuneAudioProcessor::getLinkedAnalysisInput(const AudioBuffer<float>& buffer, Parameters::ChannelLink link, float* mix) const
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = buffer.getNumChannels();
+    
+    if (link == Parameters::ChannelLink::Loudest)
+    {
+        int loudest = 0;
+        float loudestEnergy = -1.0f;
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* data = buffer.getReadPointer(channel);
+            float energy = 0.0f;
+            for (int i = 0; i < numSamples; ++i)
+                energy += data[i] * data[i];
+            
+            if (energy > loudestEnergy)
+            {
+                loudestEnergy = energy;
+                loudest = channel;
+            }
+        }
+        
+        return buffer.getReadPointer(loudest);
+    }
+    
+    // Mid: the mean of all channels
+    FloatVectorOperations::copy(mix, buffer.getReadPointer(0), numSamples);
+    for (int channel = 1; channel < numChannels; ++channel)
+        FloatVectorOperations::add(mix, buffer.getReadPointer(channel), numSamples);
+    
+    FloatVectorOperations::multiply(mix, 1.0f / static_cast<float>(numChannels), numSamples);
+    return mix;
+}
+
+bool AutoTuneAudioProcessor::analysePitch(const AudioBuffer<float>& buffer, int channel, Parameters::ChannelLink link, float* pitches)
+{
+    const int numSamples = buffer.getNumSamples();
+    
+    if (link == Parameters::ChannelLink::Off)
+    {
+        const auto* input = buffer.getReadPointer(channel);
+        const bool voiced = pitchEngine.detectVoicing(channel, input, numSamples);
+        pitchEngine.trackPitch(channel, input, numSamples, pitches, voiced);
+        return voiced;
+    }
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* mix = workspace.allocate(numSamples);
+    if (mix == nullptr)
+    {
+        std::fill(pitches, pitches + numSamples, 0.0f);
+        return true;
+    }
+    
+    const auto* input = getLinkedAnalysisInput(buffer, link, mix);
+    const bool voiced = pitchEngine.detectLinkedVoicing(input, numSamples);
+    pitchEngine.trackLinkedPitch(input, numSamples, pitches, voiced);
+    return voiced;
+}
+
+void AutoTuneAudioProcessor::updateRatioCurve(const float* pitches, int numSamples, int numRatios, Parameters::Mode mode,
+                                              float speed, float amount)
+{
+    // The tracker holds its estimate for a whole analysis hop, so neighbouring
+    // control points usually see the same pitch; reuse the last target then
+    float lastPitch = 0.0f;
+    float lastTargetRatio = 1.0f;
+    
+    for (int point = 0; point < numRatios; ++point)
+    {
+        // Points sit where the shifters expect them, evenly across the block
+        const float currentPitch = pitches[jmin(numSamples - 1, point * numSamples / numRatios)];
+        float pitchRatio = 1.0f;
+        
+        if (currentPitch > 0.0f) // Valid pitch detected
+        {
+            if (currentPitch != lastPitch)
+            {
+                lastPitch = currentPitch;
+                lastTargetRatio = scaleQuantizer.getTargetRatio(currentPitch);
+            }
+            
+            const float targetRatio = lastTargetRatio;
+            
+            switch (mode)
+            {
+                case Parameters::Mode::Classic:
+                {
+                    // Smooth correction scaled by amount and speed
+                    float correction = (targetRatio - 1.0f) * amount * 0.01f * speed * 0.01f;
+                    
+                    if (std::abs(correction) > 0.01f)
+                        pitchRatio = 1.0f + correction;
+                    break;
+                }
+                case Parameters::Mode::Hard:
+                {
+                    // Hard correction - immediate snap to target
+                    if (std::abs(targetRatio - 1.0f) > 0.005f && amount > 0.1f)
+                    {
+                        float hardCorrection = (targetRatio - 1.0f) * amount * 0.01f;
+                        pitchRatio = 1.0f + jlimit(-0.5f, 0.5f, hardCorrection); // Limit extreme corrections
+                    }
+                    break;
+                }
+                case Parameters::Mode::AI:
+                {
+                    // AI-style correction goes all the way to the target
+                    if (std::abs(targetRatio - 1.0f) > 0.01f)
+                        pitchRatio = targetRatio;
+                    break;
+                }
+            }
+        }
+        
+        ratioCurve[static_cast<size_t>(point)] = pitchRatio;
+    }
+}
+
+void AutoTuneAudioProcessor::bypassAllChannels(AudioBuffer<float>& buffer)
+{
+    // The workspace is sized in prepareToPlay, so running out is a bug. The
+    // block still leaves dry at the reported latency and the delay lines
+    // advance, so the next block lines up.
+    jassertfalse;
+    
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        pitchEngine.bypass(channel, buffer.getWritePointer(channel), buffer.getNumSamples());
+}
+
 void AutoTuneAudioProcessor::processClassicMode(AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    const int numRatios = getNumRatioPoints(numSamples);
 
     // Get parameter values
     float speed = speedSmoothed.getNextValue();
     float amount = amountSmoothed.getNextValue();
-    auto key = static_cast<Parameters::Key>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::KEY_ID))
-    );
-    auto scale = static_cast<Parameters::Scale>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::SCALE_ID))
-    );
 
-    // Process each channel
+    // Linked channels share one pitch track and ratio curve, computed before
+    // the first channel is corrected in place
+    const auto link = getChannelLink(numChannels);
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* pitches = workspace.allocate(numSamples);
+    if (pitches == nullptr)
+    {
+        bypassAllChannels(buffer);
+        return;
+    }
+    
+    bool voiced = true;
+    
     for (int channel = 0; channel < numChannels; ++channel)
     {
         auto* channelData = buffer.getWritePointer(channel);
         
-        // Pitch detection and correction
-        std::vector<float> pitches(numSamples);
-        pitchEngine.detectPitch(channelData, numSamples, pitches.data());
-        
-        // Apply pitch correction
-        for (int sample = 0; sample < numSamples; ++sample)
+        if (link == Parameters::ChannelLink::Off || channel == 0)
         {
-            float currentPitch = pitches[sample];
+            // Pitch detection
+            voiced = analysePitch(buffer, channel, link, pitches);
             
-            if (currentPitch > 0.0f) // Valid pitch detected
-            {
-                // Convert to MIDI note number
-                float midiNote = Utils::frequencyToMidiNote(currentPitch);
-                
-                // Quantize to scale
-                float targetNote = Utils::quantizeToScale(midiNote, key, scale);
-                float targetFrequency = Utils::midiNoteToFrequency(targetNote);
-                
-                // Calculate correction amount
-                float correction = (targetFrequency - currentPitch) * amount * 0.01f;
-                
-                // Apply smooth correction with speed control
-                float smoothedCorrection = correction * speed * 0.01f;
-                
-                // Apply pitch correction
-                if (std::abs(smoothedCorrection) > 0.01f)
-                {
-                    pitchEngine.correctPitch(&channelData[sample], 1, targetFrequency, speed, amount);
-                }
-            }
+            updateRatioCurve(pitches, numSamples, numRatios, Parameters::Mode::Classic, speed, amount);
         }
+        
+        if (pitchEngine.updateVoicing(channel, voiced) == PitchCorrectionEngine::Voicing::Suspended)
+            pitchEngine.bypass(channel, channelData, numSamples);
+        else
+            pitchEngine.correctPitch(channel, channelData, numSamples, ratioCurve.data(), numRatios, pitches);
     }
 }
 
@@ -220,46 +416,40 @@ void AutoTuneAudioProcessor::processHardMode(AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    const int numRatios = getNumRatioPoints(numSamples);
 
     // Get parameter values
-    float speed = speedSmoothed.getNextValue();
     float amount = amountSmoothed.getNextValue();
-    auto key = static_cast<Parameters::Key>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::KEY_ID))
-    );
-    auto scale = static_cast<Parameters::Scale>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::SCALE_ID))
-    );
 
+    const auto link = getChannelLink(numChannels);
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* pitches = workspace.allocate(numSamples);
+    if (pitches == nullptr)
+    {
+        bypassAllChannels(buffer);
+        return;
+    }
+    
+    bool voiced = true;
+    
     // Hard mode applies immediate, aggressive correction
     for (int channel = 0; channel < numChannels; ++channel)
     {
         auto* channelData = buffer.getWritePointer(channel);
         
-        // Detect pitch
-        std::vector<float> pitches(numSamples);
-        pitchEngine.detectPitch(channelData, numSamples, pitches.data());
-        
-        // Apply hard correction
-        for (int sample = 0; sample < numSamples; ++sample)
+        if (link == Parameters::ChannelLink::Off || channel == 0)
         {
-            float currentPitch = pitches[sample];
+            // Detect pitch
+            voiced = analysePitch(buffer, channel, link, pitches);
             
-            if (currentPitch > 0.0f)
-            {
-                float midiNote = Utils::frequencyToMidiNote(currentPitch);
-                float targetNote = Utils::quantizeToScale(midiNote, key, scale);
-                float targetFrequency = Utils::midiNoteToFrequency(targetNote);
-                
-                // Hard correction - immediate snap to target
-                float pitchRatio = targetFrequency / currentPitch;
-                if (std::abs(pitchRatio - 1.0f) > 0.005f && amount > 0.1f)
-                {
-                    // Hard snap to target with formant preservation
-                    pitchEngine.correctPitchHard(&channelData[sample], 1, targetFrequency, speed, amount);
-                }
-            }
+            updateRatioCurve(pitches, numSamples, numRatios, Parameters::Mode::Hard, 0.0f, amount);
         }
+        
+        if (pitchEngine.updateVoicing(channel, voiced) == PitchCorrectionEngine::Voicing::Suspended)
+            pitchEngine.bypass(channel, channelData, numSamples);
+        else
+            pitchEngine.correctPitchHard(channel, channelData, numSamples, ratioCurve.data(), numRatios, pitches);
     }
 }
 
@@ -267,93 +457,153 @@ void AutoTuneAudioProcessor::processAIMode(AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    const int numRatios = getNumRatioPoints(numSamples);
 
     // Get parameter values
     float speed = speedSmoothed.getNextValue();
     float amount = amountSmoothed.getNextValue();
-    auto key = static_cast<Parameters::Key>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::KEY_ID))
-    );
-    auto scale = static_cast<Parameters::Scale>(
-        static_cast<int>(*parameters.getRawParameterValue(Parameters::SCALE_ID))
-    );
 
-    // AI-enhanced processing
+    const auto link = getChannelLink(numChannels);
+    bool voiced = true;
+    
+    ScratchWorkspace::Scope scratchScope(workspace);
+    float* pitches = workspace.allocate(numSamples);
+    if (pitches == nullptr)
+    {
+        bypassAllChannels(buffer);
+        return;
+    }
+
+    // AI-enhanced processing. Linked channels reuse the first channel's analysis.
     for (int channel = 0; channel < numChannels; ++channel)
     {
         auto* channelData = buffer.getWritePointer(channel);
         
-        if (aiModelLoader.areModelsLoaded())
+        if (link == Parameters::ChannelLink::Off || channel == 0)
         {
-            // Use AI models for pitch detection and synthesis
-            auto pitchPrediction = aiModelLoader.predictPitch(channelData, numSamples, currentSampleRate);
+            // The tracker and the voicing gate keep running under the network,
+            // so its history is ready whenever a network result comes back late
+            voiced = analysePitch(buffer, channel, link, pitches);
             
-            if (pitchPrediction.confidence > 0.3f)
+            // A current network result replaces the tracker's pitches, per
+            // sample. The audio takes the same shifter path either way, so
+            // the output never jumps by the latency when results arrive late
+            // or resume.
+            if (aiModelLoader.areModelsLoaded())
             {
-                float currentPitch = pitchPrediction.frequency;
-                float midiNote = Utils::frequencyToMidiNote(currentPitch);
-                float targetNote = Utils::quantizeToScale(midiNote, key, scale);
-                float targetFrequency = Utils::midiNoteToFrequency(targetNote);
-                
-                // Create synthesis parameters
-                AIModelLoader::SynthesisParams synthParams;
-                synthParams.fundamentalFreq = targetFrequency;
-                synthParams.harmonicAmplitudes = pitchPrediction.harmonics;
-                synthParams.loudness = amount * 0.01f;
-                
-                // Process with AI synthesis
-                std::vector<float> tempBuffer(numSamples);
-                std::copy(channelData, channelData + numSamples, tempBuffer.begin());
-                
-                if (aiModelLoader.processWithDDSP(tempBuffer.data(), channelData, numSamples, synthParams))
+                if (link == Parameters::ChannelLink::Off)
                 {
-                    // Blend original and AI-processed audio
-                    float blendFactor = speed * 0.01f;
-                    for (int i = 0; i < numSamples; ++i)
-                    {
-                        channelData[i] = tempBuffer[i] * (1.0f - blendFactor) + channelData[i] * blendFactor;
-                    }
+                    aiModelLoader.predictPitch(channel, channelData, numSamples, currentSampleRate, pitches);
                 }
-            }
-        }
-        else
-        {
-            // Fallback to advanced pitch detection
-            std::vector<float> pitches(numSamples);
-            pitchEngine.detectPitchAdvanced(channelData, numSamples, pitches.data());
-            
-            // Apply intelligent correction
-            for (int sample = 0; sample < numSamples; ++sample)
-            {
-                float currentPitch = pitches[sample];
-                
-                if (currentPitch > 0.0f)
+                else
                 {
-                    float midiNote = Utils::frequencyToMidiNote(currentPitch);
-                    float targetNote = Utils::quantizeToScale(midiNote, key, scale);
-                    float targetFrequency = Utils::midiNoteToFrequency(targetNote);
-                    
-                    // AI-style correction with formant preservation
-                    float pitchRatio = targetFrequency / currentPitch;
-                    if (std::abs(pitchRatio - 1.0f) > 0.01f)
-                    {
-                        pitchEngine.correctPitchAI(&channelData[sample], 1, targetFrequency, speed, amount);
-                    }
+                    ScratchWorkspace::Scope mixScope(workspace);
+                    if (float* mix = workspace.allocate(numSamples))
+                        aiModelLoader.predictPitch(0, getLinkedAnalysisInput(buffer, link, mix), numSamples, currentSampleRate, pitches);
                 }
             }
+            
+            updateRatioCurve(pitches, numSamples, numRatios, Parameters::Mode::AI, speed, amount);
         }
+        
+        if (pitchEngine.updateVoicing(channel, voiced) == PitchCorrectionEngine::Voicing::Suspended)
+            pitchEngine.bypass(channel, channelData, numSamples);
+        else
+            pitchEngine.correctPitchAI(channel, channelData, numSamples, ratioCurve.data(), numRatios, pitches);
     }
 }
 
 void AutoTuneAudioProcessor::parameterChanged(const String& parameterID, float newValue)
 {
-    ignoreUnused(parameterID, newValue);
-    // Parameter changes are handled through smoothed values in processBlock
+    ignoreUnused(newValue);
+    
+    // This can arrive on the audio thread, so the scale table and the
+    // reported latency are updated from the message thread. Other parameters
+    // are read through smoothed values in processBlock.
+    if (parameterID == Parameters::KEY_ID || parameterID == Parameters::SCALE_ID
+        || parameterID == Parameters::LATENCY_MODE_ID || parameterID == Parameters::LOOKAHEAD_ID
+        || parameterID == Parameters::SHIFTER_ID)
+        triggerAsyncUpdate();
+}
+
+void AutoTuneAudioProcessor::handleAsyncUpdate()
+{
+    // Both are cheap, so whichever parameter changed, refresh both
+    updateScaleTable();
+    updateLatency();
+}
+
+int AutoTuneAudioProcessor::getLookaheadSamples() const
+{
+    const auto latencyMode = static_cast<Parameters::LatencyMode>(
+        static_cast<int>(*parameters.getRawParameterValue(Parameters::LATENCY_MODE_ID))
+    );
+    
+    if (latencyMode == Parameters::LatencyMode::Live)
+        return 0;
+    
+    const float milliseconds = *parameters.getRawParameterValue(Parameters::LOOKAHEAD_ID);
+    return jmin(pitchEngine.getMaxLookaheadSamples(), roundToInt(milliseconds * 0.001 * currentSampleRate));
+}
+
+void AutoTuneAudioProcessor::updateLatency()
+{
+    const auto backend = getShifterBackend();
+    const int lookaheadSamples = getLookaheadSamples();
+    setLatencySamples(pitchEngine.getLatencySamples(backend) + lookaheadSamples);
+    
+    appliedLookaheadSamples = lookaheadSamples;
+    appliedShifterBackend = backend;
+}
+
+PitchCorrectionEngine::ShifterBackend AutoTuneAudioProcessor::getShifterBackend() const
+{
+    const auto shifter = static_cast<Parameters::Shifter>(
+        static_cast<int>(*parameters.getRawParameterValue(Parameters::SHIFTER_ID))
+    );
+    
+    return shifter == Parameters::Shifter::LowCpu ? PitchCorrectionEngine::ShifterBackend::ModulatedDelay
+                                                  : PitchCorrectionEngine::ShifterBackend::Standard;
+}
+
+void AutoTuneAudioProcessor::updateScaleTable()
+{
+    const int key = static_cast<int>(*parameters.getRawParameterValue(Parameters::KEY_ID));
+    const auto scale = static_cast<Parameters::Scale>(
+        static_cast<int>(*parameters.getRawParameterValue(Parameters::SCALE_ID))
+    );
+    
+    if (scale == Parameters::Scale::Custom)
+        scaleQuantizer.setTuning(customTuning, key);
+    else
+        scaleQuantizer.setTuning(ScaleQuantizer::fromScaleNotes(Parameters::getScaleNotes(scale)), key);
+}
+
+void AutoTuneAudioProcessor::setCustomScaleMask(int noteMask)
+{
+    customScaleMask = noteMask & 0xfff;
+    customScalaText = {};
+    customTuning = ScaleQuantizer::fromNoteMask(customScaleMask);
+    updateScaleTable();
+}
+
+bool AutoTuneAudioProcessor::loadScalaTuning(const String& scalaText, String& error)
+{
+    ScaleQuantizer::Tuning tuning;
+    if (! ScaleQuantizer::parseScala(scalaText, tuning, error))
+        return false;
+    
+    customScalaText = scalaText;
+    customTuning = tuning;
+    updateScaleTable();
+    return true;
 }
 
 void AutoTuneAudioProcessor::getStateInformation(MemoryBlock& destData)
 {
     auto state = parameters.copyState();
+    state.setProperty("customScaleMask", customScaleMask, nullptr);
+    state.setProperty("customScala", customScalaText, nullptr);
     std::unique_ptr<XmlElement> xml(state.createXml());
     copyXmlToBinary(*xml, destData);
 }
@@ -367,6 +617,18 @@ void AutoTuneAudioProcessor::setStateInformation(const void* data, int sizeInByt
         if (xmlState->hasTagName(parameters.state.getType()))
         {
             parameters.replaceState(ValueTree::fromXml(*xmlState));
+            
+            customScaleMask = static_cast<int>(parameters.state.getProperty("customScaleMask", defaultCustomScaleMask)) & 0xfff;
+            customScalaText = parameters.state.getProperty("customScala", String()).toString();
+            
+            String error;
+            if (customScalaText.isEmpty() || ! ScaleQuantizer::parseScala(customScalaText, customTuning, error))
+            {
+                customScalaText = {};
+                customTuning = ScaleQuantizer::fromNoteMask(customScaleMask);
+            }
+            
+            triggerAsyncUpdate();
         }
     }
 }
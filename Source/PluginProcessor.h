@@ -2,18 +2,23 @@
 
 #include "JuceHeader.h"
 #include <memory>
+#include <atomic>
 #include "PitchCorrectionEngine.h"
+#include "ScratchWorkspace.h"
+#include "AllocationTrap.h"
 #include "Parameters.h"
 #include "PresetManager.h"
 #include "ModeSelector.h"
 #include "AIModelLoader.h"
+#include "ScaleQuantizer.h"
 
 #ifdef USE_RUBBERBAND
 #include <rubberband/RubberBandStretcher.h>
 #endif
 
 class AutoTuneAudioProcessor : public AudioProcessor,
-                                public AudioProcessorValueTreeState::Listener
+                                public AudioProcessorValueTreeState::Listener,
+                                private AsyncUpdater
 {
 public:
     AutoTuneAudioProcessor();
@@ -51,6 +56,12 @@ public:
     // Parameter listener
     void parameterChanged(const String& parameterID, float newValue) override;
 
+    // Scale used when the Scale parameter is Custom: a 12-bit note mask
+    // relative to the key (bit 0 = root), or a Scala (.scl) tuning rooted on
+    // the key that replaces it. Message thread; saved with the plugin state.
+    void setCustomScaleMask(int noteMask);
+    bool loadScalaTuning(const String& scalaText, String& error);
+
     // Public accessors
     AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
     Parameters& getParameters() { return pluginParameters; }
@@ -63,14 +74,27 @@ private:
     Parameters pluginParameters;                       // Must be initialized BEFORE parameters
     AudioProcessorValueTreeState parameters;
     PresetManager presetManager;
+    ScratchWorkspace workspace;                        // Must be initialized BEFORE the engine and AI loader
     PitchCorrectionEngine pitchEngine;
     ModeSelector modeSelector;
     AIModelLoader aiModelLoader;
 
+    // Scale lookup table, rebuilt on the message thread when key or scale change
+    ScaleQuantizer scaleQuantizer;
+    static constexpr int defaultCustomScaleMask = 0xab5; // major
+    ScaleQuantizer::Tuning customTuning;
+    int customScaleMask = defaultCustomScaleMask;
+    String customScalaText;
+
     // Audio processing variables
     double currentSampleRate = 44100.0;
     int currentBlockSize = 512;
     
+    // Lookahead and backend the engine runs with, published by updateLatency()
+    // once the host has been told the latency they add up to
+    std::atomic<int> appliedLookaheadSamples { 0 };
+    std::atomic<PitchCorrectionEngine::ShifterBackend> appliedShifterBackend { PitchCorrectionEngine::ShifterBackend::Standard };
+    
     // Pitch detection buffers
     AudioBuffer<float> pitchBuffer;
     AudioBuffer<float> correctedBuffer;
@@ -88,6 +112,11 @@ private:
     static constexpr int fftOrder = 11; // 2^11 = 2048
     static constexpr int fftSize = 1 << fftOrder;
 
+    // Control stage output: the target pitch ratio once every controlInterval
+    // samples. The shifters interpolate between points at audio rate.
+    std::vector<float> ratioCurve;
+    static constexpr int controlInterval = 64;
+
     // Smoothing filters for parameters
     SmoothedValue<float> speedSmoothed;
     SmoothedValue<float> amountSmoothed;
@@ -97,9 +126,41 @@ private:
 #endif
 
     // Processing methods
+    void processSubBlock(AudioBuffer<float>& buffer, Parameters::Mode mode);
     void processClassicMode(AudioBuffer<float>& buffer);
     void processHardMode(AudioBuffer<float>& buffer);
     void processAIMode(AudioBuffer<float>& buffer);
+    void bypassAllChannels(AudioBuffer<float>& buffer);
+    
+    int getScratchSize() const;
+    int getNumRatioPoints(int numSamples) const;
+    
+    // Channel linking: one pitch track for every channel, from the channel
+    // mean (written to mix) or the loudest channel of the block
+    Parameters::ChannelLink getChannelLink(int numChannels) const;
+    const float* getLinkedAnalysisInput(const AudioBuffer<float>& buffer, Parameters::ChannelLink link, float* mix) const;
+    
+    // Runs the voicing gate and the tracker on the analysis input and returns
+    // the gate's decision; unvoiced blocks skip detection and get 0 Hz
+    bool analysePitch(const AudioBuffer<float>& buffer, int channel, Parameters::ChannelLink link, float* pitches);
+    
+    // Control stage: fills ratioCurve from the pitch track with the mode's
+    // correction law, one scale lookup per control point
+    void updateRatioCurve(const float* pitches, int numSamples, int numRatios, Parameters::Mode mode,
+                          float speed, float amount);
+    
+    // Builds and publishes the scale table for the current key and scale
+    void updateScaleTable();
+    
+    // Lookahead delay from the Latency Mode and Lookahead parameters, the
+    // shifter backend from the Shifter parameter, and the latency reported to
+    // the host: the backend's plus the lookahead. updateLatency() reports it
+    // and only then hands both to the audio thread, so the engine never runs
+    // a latency the host has not been told about.
+    int getLookaheadSamples() const;
+    PitchCorrectionEngine::ShifterBackend getShifterBackend() const;
+    void updateLatency();
+    void handleAsyncUpdate() override;
     
     void performPitchCorrection(AudioBuffer<float>& buffer, 
                                float speed, float amount, 
@@ -0,0 +1,64 @@
+#include "PolyphaseDecimator.h"
+
+void PolyphaseDecimator::prepare(int newFactor, int tapsPerPhase)
+{
+    factor = jmax(1, newFactor);
+    numTaps = factor * jmax(1, tapsPerPhase) + 1;
+
+    coefficients.allocate(static_cast<size_t>(numTaps), true);
+    history.allocate(static_cast<size_t>(numTaps * 2), true);
+
+    // Blackman-windowed sinc, cut off at 80% of the output Nyquist so the
+    // transition band stays clear of aliasing into the vocal range
+    const double cutoff = 0.8 * 0.5 / factor;
+    const double centre = 0.5 * (numTaps - 1);
+    double sum = 0.0;
+
+    for (int i = 0; i < numTaps; ++i)
+    {
+        const double x = i - centre;
+        const double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * MathConstants<double>::pi * cutoff * x) / (MathConstants<double>::pi * x);
+        const double phaseRatio = numTaps > 1 ? static_cast<double>(i) / (numTaps - 1) : 0.5;
+        const double window = 0.42 - 0.5 * std::cos(2.0 * MathConstants<double>::pi * phaseRatio)
+                                   + 0.08 * std::cos(4.0 * MathConstants<double>::pi * phaseRatio);
+
+        coefficients[i] = static_cast<float>(sinc * window);
+        sum += sinc * window;
+    }
+
+    // Unity gain at DC
+    for (int i = 0; i < numTaps; ++i)
+        coefficients[i] = static_cast<float>(coefficients[i] / sum);
+
+    reset();
+}
+
+void PolyphaseDecimator::reset()
+{
+    if (history != nullptr)
+        std::fill(history.getData(), history.getData() + numTaps * 2, 0.0f);
+
+    writeIndex = 0;
+    phase = 0;
+}
+
+bool PolyphaseDecimator::pushSample(float input, float& output)
+{
+    history[writeIndex] = input;
+    history[writeIndex + numTaps] = input;
+    writeIndex = writeIndex + 1 == numTaps ? 0 : writeIndex + 1;
+
+    if (++phase < factor)
+        return false;
+
+    phase = 0;
+
+    // The last numTaps samples, oldest first; the filter is symmetric
+    const float* recent = history.getData() + writeIndex;
+    float sum = 0.0f;
+    for (int i = 0; i < numTaps; ++i)
+        sum += recent[i] * coefficients[i];
+
+    output = sum;
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+// Streaming anti-aliased decimator for the analysis path. A linear-phase
+// windowed-sinc low-pass runs over a history line, but only every factor-th
+// output is ever computed, so the cost is tapsPerPhase multiply-adds per
+// input sample, the same as the polyphase form. State carries across calls,
+// so block boundaries do not matter.
+class PolyphaseDecimator
+{
+public:
+    PolyphaseDecimator() = default;
+
+    // Message thread
+    void prepare(int factor, int tapsPerPhase = 8);
+    void reset();
+
+    int getFactor() const { return factor; }
+
+    // Group delay of the filter, in input samples
+    float getLatencySamples() const { return 0.5f * static_cast<float>(numTaps - 1); }
+
+    // Feeds one input sample; returns true when a decimated sample is due
+    bool pushSample(float input, float& output);
+
+private:
+    HeapBlock<float> coefficients;
+    HeapBlock<float> history;       // 2 * numTaps, written twice so reads never wrap
+    int factor = 1;
+    int numTaps = 1;
+    int writeIndex = 0;
+    int phase = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseDecimator)
+};
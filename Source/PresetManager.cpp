@@ -145,7 +145,7 @@ void PresetManager::resetToDefaults()
     parameters.getParameter(Parameters::KEY_ID)->setValueNotifyingHost(
         static_cast<float>(Parameters::KEY_DEFAULT) / 11.0f);
     parameters.getParameter(Parameters::SCALE_ID)->setValueNotifyingHost(
-        static_cast<float>(Parameters::SCALE_DEFAULT) / 2.0f);
+        static_cast<float>(Parameters::SCALE_DEFAULT) / 3.0f);
     
     currentPresetIndex = -1;
     
@@ -386,7 +386,7 @@ void PresetManager::applyPresetToParameters(const Preset& preset)
     parameters.getParameter(Parameters::KEY_ID)->setValueNotifyingHost(
         static_cast<float>(preset.key) / 11.0f);
     parameters.getParameter(Parameters::SCALE_ID)->setValueNotifyingHost(
-        static_cast<float>(preset.scale) / 2.0f);
+        static_cast<float>(preset.scale) / 3.0f);
 }
 
 ValueTree PresetManager::presetToValueTree(const Preset& preset)
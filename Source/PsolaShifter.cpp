@@ -0,0 +1,206 @@
+#include "PsolaShifter.h"
+#include "Utils.h"
+
+int PsolaShifter::getMinimumLatency(double sampleRate)
+{
+    // A synthesis mark is rendered once the epoch after it has been found and
+    // the nearest epoch's grain is complete, at most 2.25 periods (plus one
+    // segment) after the mark. Its grain starts one period before the mark.
+    const int longestPeriod = static_cast<int>(std::ceil(sampleRate / minFrequency));
+    return static_cast<int>(std::ceil(longestPeriod * 3.25)) + segmentSize * 2;
+}
+
+void PsolaShifter::prepare(double newSampleRate, int numChannels, int latencySamples)
+{
+    sampleRate = newSampleRate;
+    minPeriod = jmax(2, static_cast<int>(sampleRate / maxFrequency));
+    maxPeriod = static_cast<int>(std::ceil(sampleRate / minFrequency));
+    unvoicedSpacing = roundToInt(sampleRate / 200.0);
+
+    jassert(latencySamples >= getMinimumLatency(sampleRate));
+    latency = jmax(latencySamples, getMinimumLatency(sampleRate));
+
+    // Grains read up to a few periods behind the newest input and land up to
+    // latency plus a period ahead of it
+    const int ringSize = nextPowerOfTwo(latency + maxPeriod * 4 + segmentSize);
+    ringMask = ringSize - 1;
+
+    numChannels = jmax(1, numChannels);
+    channels.resize(static_cast<size_t>(numChannels));
+    epochs.resize(static_cast<size_t>(numChannels * epochCapacity));
+    inputRing.setSize(numChannels, ringSize);
+    outputRing.setSize(numChannels, ringSize);
+
+    windowTable.allocate(static_cast<size_t>(windowTableSize + 1), true);
+    for (int i = 0; i <= windowTableSize; ++i)
+        windowTable[i] = 0.5f * (1.0f - std::cos(MathConstants<float>::twoPi * i / windowTableSize));
+
+    reset();
+}
+
+void PsolaShifter::reset()
+{
+    inputRing.clear();
+    outputRing.clear();
+
+    for (auto& state : channels)
+        state = {};
+}
+
+void PsolaShifter::resetChannel(int channel)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())))
+        return;
+
+    inputRing.clear(channel, 0, inputRing.getNumSamples());
+    outputRing.clear(channel, 0, outputRing.getNumSamples());
+    channels[static_cast<size_t>(channel)] = {};
+}
+
+void PsolaShifter::process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches)
+{
+    if (! isPositiveAndBelow(channel, static_cast<int>(channels.size())) || numRatios <= 0)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    auto* input = inputRing.getWritePointer(channel);
+    auto* output = outputRing.getWritePointer(channel);
+
+    int position = 0;
+    while (position < numSamples)
+    {
+        const int segment = jmin(segmentSize, numSamples - position);
+        for (int i = 0; i < segment; ++i)
+        {
+            const int index = static_cast<int>((state.samplesWritten + i) & ringMask);
+            input[index] = audio[position + i];
+            audio[position + i] = output[index];
+            output[index] = 0.0f;
+        }
+
+        state.samplesWritten += segment;
+        position += segment;
+
+        const float pitch = pitches[position - 1];
+        const double period = pitch > 0.0f ? jlimit(static_cast<double>(minPeriod), static_cast<double>(maxPeriod), sampleRate / pitch) : 0.0;
+        const float pitchRatio = Utils::interpolateControlCurve(ratioCurve, numRatios, position - 1, numSamples);
+
+        findEpochs(channel, period);
+        placeGrains(channel, jlimit(minShiftRatio, maxShiftRatio, pitchRatio));
+    }
+}
+
+void PsolaShifter::findEpochs(int channel, double period)
+{
+    auto& state = channels[static_cast<size_t>(channel)];
+    const auto* input = inputRing.getReadPointer(channel);
+
+    for (;;)
+    {
+        Epoch epoch;
+
+        if (period > 0.0)
+        {
+            // The next glottal pulse is the waveform peak within a quarter
+            // period of where the tracked period puts it
+            const int64 searchStart = state.lastEpoch + static_cast<int64>(period * 0.75);
+            const int64 searchEnd = state.lastEpoch + static_cast<int64>(period * 1.25);
+            if (searchEnd >= state.samplesWritten)
+                break;
+
+            epoch.position = searchStart;
+            float peak = input[searchStart & ringMask];
+            for (int64 i = searchStart + 1; i <= searchEnd; ++i)
+            {
+                if (input[i & ringMask] > peak)
+                {
+                    peak = input[i & ringMask];
+                    epoch.position = i;
+                }
+            }
+
+            epoch.period = period;
+            epoch.halfGrain = roundToInt(period);
+            epoch.voiced = true;
+        }
+        else
+        {
+            epoch.position = state.lastEpoch + unvoicedSpacing;
+            if (epoch.position >= state.samplesWritten)
+                break;
+
+            epoch.period = unvoicedSpacing;
+            epoch.halfGrain = unvoicedSpacing;
+        }
+
+        if (state.numEpochs == epochCapacity)
+        {
+            ++state.firstEpoch;
+            --state.numEpochs;
+        }
+
+        epochAt(channel, state.firstEpoch + state.numEpochs) = epoch;
+        ++state.numEpochs;
+        state.lastEpoch = epoch.position;
+    }
+}
+
+void PsolaShifter::placeGrains(int channel, float pitchRatio)
+{
+    auto& state = channels[static_cast<size_t>(channel)];
+
+    while (state.numEpochs > 0)
+    {
+        const int64 mark = static_cast<int64>(std::llround(state.nextMark));
+
+        // The nearest epoch is settled once one at or past the mark exists
+        if (epochAt(channel, state.firstEpoch + state.numEpochs - 1).position < mark)
+            break;
+
+        // Keep the last epoch before the mark as the oldest entry
+        while (state.numEpochs > 1 && epochAt(channel, state.firstEpoch + 1).position <= mark)
+        {
+            ++state.firstEpoch;
+            --state.numEpochs;
+        }
+
+        const Epoch* nearest = &epochAt(channel, state.firstEpoch);
+        if (state.numEpochs > 1)
+        {
+            const Epoch& next = epochAt(channel, state.firstEpoch + 1);
+            if (next.position - mark < mark - nearest->position)
+                nearest = &next;
+        }
+
+        if (nearest->position + nearest->halfGrain > state.samplesWritten)
+            break;
+
+        // Hann grains two periods long sum to period / hop, so scale by the hop
+        const double hop = nearest->voiced ? nearest->period / pitchRatio : nearest->period;
+        renderGrain(channel, *nearest, mark, static_cast<float>(hop / nearest->period));
+        state.nextMark += hop;
+    }
+}
+
+void PsolaShifter::renderGrain(int channel, const Epoch& epoch, int64 centre, float gain)
+{
+    const auto& state = channels[static_cast<size_t>(channel)];
+    const auto* input = inputRing.getReadPointer(channel);
+    auto* output = outputRing.getWritePointer(channel);
+
+    const int grainSize = epoch.halfGrain * 2;
+    const int64 sourceStart = epoch.position - epoch.halfGrain;
+    const int64 outputStart = centre + latency - epoch.halfGrain;
+
+    // Anything before the read point has already been handed out
+    const int first = static_cast<int>(jlimit<int64>(0, grainSize, state.samplesWritten - outputStart));
+
+    for (int i = first; i < grainSize; ++i)
+    {
+        const float window = windowTable[(i * windowTableSize) / grainSize];
+        output[(outputStart + i) & ringMask] += input[(sourceStart + i) & ringMask] * window * gain;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <vector>
+
+// Streaming TD-PSOLA pitch shifter. Epoch marks (one per glottal pulse) are
+// found by searching the input around one tracked period past the previous
+// mark, so marks carry across host blocks. Synthesis marks are laid out at
+// the target period; each takes the two-period Hann grain centred on the
+// nearest epoch and overlap-adds it into an output ring. Unvoiced input gets
+// marks at a fixed spacing and passes through at unit ratio.
+//
+// There is no transform anywhere: the work is one peak search and one grain
+// per pitch period, and grain windows are read from a precomputed table.
+class PsolaShifter
+{
+public:
+    PsolaShifter() = default;
+
+    // Delay the shifter needs for a grain to land ahead of the read point
+    static int getMinimumLatency(double sampleRate);
+
+    // Message thread. latencySamples must be at least getMinimumLatency().
+    void prepare(double sampleRate, int numChannels, int latencySamples);
+    void reset();
+
+    // Audio thread: one channel back to silence, as after reset()
+    void resetChannel(int channel);
+
+    int getLatencySamples() const { return latency; }
+
+    // Ratio curve as in PitchCorrectionEngine::correctPitch; pitches holds the
+    // tracked frequency in Hz for every sample of the block (0 = unvoiced)
+    void process(int channel, float* audio, int numSamples, const float* ratioCurve, int numRatios, const float* pitches);
+
+    static constexpr float maxShiftRatio = 2.0f;
+    static constexpr float minShiftRatio = 0.5f;
+    static constexpr float minFrequency = 80.0f;
+    static constexpr float maxFrequency = 1000.0f;
+
+private:
+    struct Epoch
+    {
+        int64 position = 0;
+        double period = 0.0;        // tracked period, for the synthesis spacing
+        int halfGrain = 0;          // grain reaches this far either side
+        bool voiced = false;
+    };
+
+    struct ChannelState
+    {
+        int64 samplesWritten = 0;
+        int64 lastEpoch = 0;
+        double nextMark = 0.0;      // next synthesis mark, in input time
+        int firstEpoch = 0;         // oldest retained entry in the epoch ring
+        int numEpochs = 0;
+    };
+
+    static constexpr int epochCapacity = 64;
+    static constexpr int segmentSize = 32;
+    static constexpr int windowTableSize = 4096;
+
+    double sampleRate = 44100.0;
+    int latency = 0;
+    int minPeriod = 44;
+    int maxPeriod = 630;
+    int unvoicedSpacing = 220;
+    int ringMask = 0;
+
+    std::vector<ChannelState> channels;
+    std::vector<Epoch> epochs;          // epochCapacity per channel
+    AudioBuffer<float> inputRing;
+    AudioBuffer<float> outputRing;
+    HeapBlock<float> windowTable;       // one Hann cycle, windowTableSize + 1 points
+
+    void findEpochs(int channel, double period);
+    void placeGrains(int channel, float pitchRatio);
+    void renderGrain(int channel, const Epoch& epoch, int64 centre, float gain);
+
+    Epoch& epochAt(int channel, int index) { return epochs[static_cast<size_t>(channel * epochCapacity + (index & (epochCapacity - 1)))]; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PsolaShifter)
+};
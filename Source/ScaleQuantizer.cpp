@@ -0,0 +1,177 @@
+#include "ScaleQuantizer.h"
+#include "Utils.h"
+#include <algorithm>
+
+ScaleQuantizer::Tuning ScaleQuantizer::fromScaleNotes(const std::vector<int>& scaleNotes)
+{
+    Tuning tuning;
+    tuning.degrees.clear();
+
+    for (int note : scaleNotes)
+        tuning.degrees.push_back(static_cast<double>(note * centsPerNote));
+
+    if (tuning.degrees.empty())
+        tuning.degrees.push_back(0.0);
+
+    return tuning;
+}
+
+ScaleQuantizer::Tuning ScaleQuantizer::fromNoteMask(int noteMask)
+{
+    std::vector<int> scaleNotes;
+
+    for (int note = 0; note < 12; ++note)
+        if ((noteMask >> note) & 1)
+            scaleNotes.push_back(note);
+
+    return fromScaleNotes(scaleNotes);
+}
+
+bool ScaleQuantizer::parseScala(const String& text, Tuning& tuning, String& error)
+{
+    StringArray lines;
+    lines.addLines(text);
+
+    // Everything except comment lines ('!') is significant, including a blank
+    // description line
+    StringArray fields;
+    for (const auto& line : lines)
+        if (! line.trimStart().startsWithChar('!'))
+            fields.add(line.trim());
+
+    if (fields.size() < 2)
+    {
+        error = "Missing description or note count";
+        return false;
+    }
+
+    const int numPitches = fields[1].getIntValue();
+    if (numPitches <= 0 || fields.size() < numPitches + 2)
+    {
+        error = "Note count does not match the pitch lines";
+        return false;
+    }
+
+    std::vector<double> pitches;
+
+    for (int i = 0; i < numPitches; ++i)
+    {
+        // Anything after the value is a label
+        const auto value = fields[i + 2].upToFirstOccurrenceOf(" ", false, false)
+                                        .upToFirstOccurrenceOf("\t", false, false);
+        double cents = 0.0;
+
+        if (value.containsChar('.'))
+        {
+            cents = value.getDoubleValue();
+        }
+        else
+        {
+            const double numerator = value.upToFirstOccurrenceOf("/", false, false).getDoubleValue();
+            const double denominator = value.containsChar('/') ? value.fromFirstOccurrenceOf("/", false, false).getDoubleValue()
+                                                               : 1.0;
+
+            if (numerator <= 0.0 || denominator <= 0.0)
+            {
+                error = "Invalid ratio '" + value + "'";
+                return false;
+            }
+
+            cents = 1200.0 * std::log2(numerator / denominator);
+        }
+
+        pitches.push_back(cents);
+    }
+
+    // The last pitch is the period; the rest are degrees within it
+    const double period = pitches.back();
+    if (period <= 0.0)
+    {
+        error = "The last pitch must be above 1/1";
+        return false;
+    }
+
+    Tuning result;
+    result.period = period;
+
+    for (size_t i = 0; i + 1 < pitches.size(); ++i)
+    {
+        double degree = std::fmod(pitches[i], period);
+        if (degree < 0.0)
+            degree += period;
+
+        result.degrees.push_back(degree);
+    }
+
+    std::sort(result.degrees.begin(), result.degrees.end());
+    result.degrees.erase(std::unique(result.degrees.begin(), result.degrees.end()), result.degrees.end());
+
+    tuning = std::move(result);
+    return true;
+}
+
+ScaleQuantizer::ScaleQuantizer()
+{
+    // No correction until the first table is published
+    for (auto& table : tables)
+        table.assign(tableSize, 1.0f);
+}
+
+void ScaleQuantizer::setTuning(const Tuning& tuning, int rootNote)
+{
+    const ScopedLock lock(writerLock);
+
+    buildTable(tables[static_cast<size_t>(backTable)], tuning, rootNote);
+    backTable = middleTable.exchange(backTable | newTableFlag) & tableIndexMask;
+}
+
+void ScaleQuantizer::acquireLatestTable()
+{
+    if (middleTable.load(std::memory_order_acquire) & newTableFlag)
+        frontTable = middleTable.exchange(frontTable) & tableIndexMask;
+}
+
+float ScaleQuantizer::getTargetRatio(float frequency) const
+{
+    if (frequency <= 0.0f)
+        return 1.0f;
+
+    const int index = roundToInt(Utils::frequencyToMidiNote(frequency) * static_cast<float>(centsPerNote));
+    if (! isPositiveAndBelow(index, tableSize))
+        return 1.0f;
+
+    return tables[static_cast<size_t>(frontTable)][static_cast<size_t>(index)];
+}
+
+void ScaleQuantizer::buildTable(std::vector<float>& table, const Tuning& tuning, int rootNote) const
+{
+    const double periodNotes = tuning.period / centsPerNote;
+    const double root = static_cast<double>(((rootNote % 12) + 12) % 12);
+
+    // Every scale note from one period below the table to one period above,
+    // so each entry has a neighbour on both sides
+    std::vector<double> targets;
+    const int firstPeriod = static_cast<int>(std::floor(-root / periodNotes)) - 1;
+
+    for (int period = firstPeriod; root + period * periodNotes <= numNotes + periodNotes; ++period)
+        for (double degree : tuning.degrees)
+            targets.push_back(root + period * periodNotes + degree / centsPerNote);
+
+    std::sort(targets.begin(), targets.end());
+
+    // One sweep: the nearest target only moves up as the note does
+    size_t upper = 0;
+    for (int index = 0; index < tableSize; ++index)
+    {
+        const double note = static_cast<double>(index) / centsPerNote;
+
+        while (upper + 1 < targets.size() && targets[upper] < note)
+            ++upper;
+
+        double target = targets[upper];
+        if (upper > 0 && note - targets[upper - 1] < target - note)
+            target = targets[upper - 1];
+
+        table[static_cast<size_t>(index)] = static_cast<float>(std::exp2((target - note) / 12.0));
+    }
+}
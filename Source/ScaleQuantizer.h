@@ -0,0 +1,69 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Scale quantization by table lookup. Whenever the key or scale changes, a
+// table holding the correction ratio (target / input frequency) for every
+// cent of the MIDI range is built on the message thread. The audio thread
+// then needs one log2 and one table read per pitch, whatever the scale.
+//
+// Tables are handed over through a triple buffer: the writer fills a spare
+// table and swaps it into the middle slot, and the audio thread swaps the
+// middle slot with the one it reads when a newer table is waiting. Neither
+// side locks or allocates on the audio thread.
+class ScaleQuantizer
+{
+public:
+    // Scale degrees in cents above the root (the first is always 0) and the
+    // interval the pattern repeats at, 1200 cents for octave scales
+    struct Tuning
+    {
+        std::vector<double> degrees { 0.0 };
+        double period = 1200.0;
+    };
+
+    // Equal-tempered scale from semitone offsets, or from a 12-bit mask with
+    // bit n set when the note n semitones above the root is in the scale
+    static Tuning fromScaleNotes(const std::vector<int>& scaleNotes);
+    static Tuning fromNoteMask(int noteMask);
+
+    // Scala (.scl) scale: a description line, a note count and that many
+    // pitches in cents (with a '.') or as ratios, the last one being the
+    // period. Returns false with a reason in error if the text is malformed.
+    static bool parseScala(const String& text, Tuning& tuning, String& error);
+
+    ScaleQuantizer();
+
+    // Writer side (message thread): builds the table for the tuning with its
+    // degree 0 on rootNote (0 = C) and publishes it
+    void setTuning(const Tuning& tuning, int rootNote);
+
+    // Audio thread: switches to the newest published table. Call once per
+    // block, before any lookups.
+    void acquireLatestTable();
+
+    // Audio thread: target / input frequency for a detected frequency in Hz,
+    // to the nearest cent. 1 outside the MIDI range.
+    float getTargetRatio(float frequency) const;
+
+    static constexpr int centsPerNote = 100;
+    static constexpr int numNotes = 128;
+    static constexpr int tableSize = numNotes * centsPerNote + 1;
+
+private:
+    void buildTable(std::vector<float>& table, const Tuning& tuning, int rootNote) const;
+
+    std::array<std::vector<float>, 3> tables;
+    std::atomic<int> middleTable { 1 };
+    int frontTable = 0; // audio thread
+    int backTable = 2;  // writer, under writerLock
+    CriticalSection writerLock;
+
+    static constexpr int tableIndexMask = 3;
+    static constexpr int newTableFlag = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScaleQuantizer)
+};
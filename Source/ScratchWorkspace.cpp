@@ -0,0 +1,40 @@
+#include "ScratchWorkspace.h"
+
+void ScratchWorkspace::prepare(int numFloats)
+{
+    capacity = jmax(0, numFloats);
+    used = 0;
+    highWaterMark = 0;
+
+    // Over-allocate so the first slice can start on a 64-byte boundary
+    storage.allocate(static_cast<size_t>(capacity + alignmentFloats), true);
+
+    auto address = reinterpret_cast<uintptr_t>(storage.getData());
+    auto alignBytes = static_cast<uintptr_t>(alignmentFloats * sizeof(float));
+    alignedStart = reinterpret_cast<float*>((address + alignBytes - 1) & ~(alignBytes - 1));
+}
+
+void ScratchWorkspace::release()
+{
+    storage.free();
+    alignedStart = nullptr;
+    capacity = 0;
+    used = 0;
+}
+
+float* ScratchWorkspace::allocate(int numFloats)
+{
+    // Round every slice up so the next one stays aligned too
+    const int rounded = slotSize(jmax(0, numFloats));
+
+    if (alignedStart == nullptr || used + rounded > capacity)
+    {
+        jassertfalse; // a component under-reported its scratch requirement
+        return nullptr;
+    }
+
+    float* slice = alignedStart + used;
+    used += rounded;
+    highWaterMark = jmax(highWaterMark, used);
+    return slice;
+}
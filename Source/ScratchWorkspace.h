@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+// Per-instance scratch memory for the audio thread. Components report how many
+// floats of temporary storage they need while being prepared, the processor
+// sizes one block for all of them in prepareToPlay, and the audio thread then
+// carves aligned slices out of it. A Scope rewinds everything allocated inside
+// it, so scratch never outlives the call that asked for it.
+class ScratchWorkspace
+{
+public:
+    ScratchWorkspace() = default;
+
+    // Message thread only
+    void prepare(int numFloats);
+    void release();
+
+    // Audio thread: returns nullptr (and asserts) when the workspace is exhausted
+    float* allocate(int numFloats);
+
+    class Scope
+    {
+    public:
+        explicit Scope(ScratchWorkspace& owner) : workspace(owner), mark(owner.used) {}
+        ~Scope() { workspace.used = mark; }
+
+    private:
+        ScratchWorkspace& workspace;
+        const int mark;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    int getCapacity() const { return capacity; }
+    int getHighWaterMark() const { return highWaterMark; }
+
+    // Space one allocate(numFloats) call takes, for scratch size estimates
+    static constexpr int slotSize(int numFloats)
+    {
+        return (numFloats + alignmentFloats - 1) / alignmentFloats * alignmentFloats;
+    }
+
+private:
+    static constexpr int alignmentFloats = 16; // 64 bytes
+
+    HeapBlock<float> storage;
+    float* alignedStart = nullptr;
+    int capacity = 0;
+    int used = 0;
+    int highWaterMark = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScratchWorkspace)
+};
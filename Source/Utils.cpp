@@ -1,10 +1,102 @@
 #include "Utils.h"
 #include <algorithm>
+#include <cstring>
 #include <numeric>
 
-// Initialize static lookup tables
-std::vector<float> Utils::sinLookupTable(LOOKUP_TABLE_SIZE);
-std::vector<float> Utils::cosLookupTable(LOOKUP_TABLE_SIZE);
+namespace
+{
+    // Polynomial approximations shared by the scalar and block functions.
+    // They avoid tables and branches; the bit casts compile to register moves.
+    inline uint32 floatToBits(float x)
+    {
+        uint32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+    
+    inline float bitsToFloat(uint32 bits)
+    {
+        float x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+    
+    // condition ? ifTrue : ifFalse through bit masks. A plain ?: on floats
+    // gets turned back into a branch around the arithmetic feeding it, which
+    // stops the loop vectorising.
+    inline float selectFloat(bool condition, float ifTrue, float ifFalse)
+    {
+        const uint32 mask = 0u - static_cast<uint32>(condition);
+        return bitsToFloat((floatToBits(ifTrue) & mask) | (floatToBits(ifFalse) & ~mask));
+    }
+    
+    // 2 / ln(2) / (2k + 1): the series log2(m) = 2/ln2 * atanh(t)
+    constexpr float log2Series[] = { 2.88539008f, 0.961796694f, 0.577078016f, 0.412198583f, 0.320598898f };
+    
+    // ln(2)^k / k!: the series 2^f = exp(f ln2)
+    constexpr float exp2Series[] = { 1.0f, 0.693147181f, 0.240226507f, 0.0555041087f,
+                                     0.00961812911f, 0.00133335581f, 0.000154035304f };
+    
+    // (-1)^k / (2k + 1)!: the series for sin
+    constexpr float sinSeries[] = { 1.0f, -0.166666667f, 0.00833333333f, -0.000198412698f,
+                                    2.75573192e-6f, -2.50521084e-8f };
+    
+    // pi in three parts; the first has few enough bits that multiples of it
+    // up to 2^15 are exact
+    constexpr float piHigh = 3.140625f;
+    constexpr float piMid = 9.67653585e-4f;
+    constexpr float piLow = 5.12656584e-12f;
+    
+    inline float log2Approx(float x)
+    {
+        // Split x = m * 2^e with m in [sqrt(1/2), sqrt(2)) by offsetting the
+        // bits with those of sqrt(1/2), so t = (m - 1) / (m + 1) stays below
+        // 0.172 and the series converges in five terms
+        const int32 offset = static_cast<int32>(floatToBits(x)) - 0x3f3504f3;
+        const int32 exponent = offset >> 23;
+        const float mantissa = bitsToFloat(floatToBits(x) - static_cast<uint32>(exponent) * 0x00800000u);
+        
+        const float t = (mantissa - 1.0f) / (mantissa + 1.0f);
+        const float t2 = t * t;
+        const float series = log2Series[0] + t2 * (log2Series[1] + t2 * (log2Series[2] + t2 * (log2Series[3] + t2 * log2Series[4])));
+        return static_cast<float>(exponent) + t * series;
+    }
+    
+    constexpr float minExp2Argument = -126.0f;
+    constexpr float maxExp2Argument = 127.0f;
+    
+    // Needs x in [minExp2Argument, maxExp2Argument]. The block callers clamp
+    // in a separate pass: a clamp inside the loop stops it vectorising.
+    inline float exp2Approx(float x)
+    {
+        // Split into a whole power of two, built directly as float bits, and
+        // a fraction in [-0.5, 0.5] for the series
+        const int whole = static_cast<int>(x + 126.5f) - 126;
+        const float f = x - static_cast<float>(whole);
+        
+        const float series = exp2Series[0] + f * (exp2Series[1] + f * (exp2Series[2] + f * (exp2Series[3]
+                           + f * (exp2Series[4] + f * (exp2Series[5] + f * exp2Series[6])))));
+        return series * bitsToFloat(static_cast<uint32>(whole + 127) << 23);
+    }
+    
+    inline float sinApprox(float x, float quarterTurns)
+    {
+        // sin(x + quarterTurns * pi/2) for quarterTurns of 0 (sin) or 1 (cos):
+        // reduce by the nearest multiple of pi to r in [-pi/2, pi/2] and flip
+        // the sign for odd multiples
+        const float turns = x * Utils::INV_PI + quarterTurns * 0.5f;
+        const int half = static_cast<int>(turns + (turns >= 0.0f ? 0.5f : -0.5f));
+        const float multiple = static_cast<float>(half) - quarterTurns * 0.5f;
+        
+        const float r = ((x - multiple * piHigh) - multiple * piMid) - multiple * piLow;
+        const float r2 = r * r;
+        const float series = sinSeries[0] + r2 * (sinSeries[1] + r2 * (sinSeries[2] + r2 * (sinSeries[3]
+                           + r2 * (sinSeries[4] + r2 * sinSeries[5]))));
+        
+        const float value = r * series;
+        return bitsToFloat(floatToBits(value) ^ (static_cast<uint32>(half & 1) << 31));
+    }
+}
 
 float Utils::frequencyToMidiNote(float frequency)
 {
@@ -19,6 +111,25 @@ float Utils::midiNoteToFrequency(float midiNote)
     return CONCERT_A_FREQ * std::pow(2.0f, (midiNote - MIDI_A4) / 12.0f);
 }
 
+void Utils::frequencyToMidiNote(const float* frequencies, float* midiNotes, int numValues)
+{
+    for (int i = 0; i < numValues; ++i)
+    {
+        const float frequency = frequencies[i];
+        const float midiNote = MIDI_A4 + 12.0f * log2Approx(frequency * (1.0f / CONCERT_A_FREQ));
+        midiNotes[i] = selectFloat(frequency > 0.0f, midiNote, 0.0f);
+    }
+}
+
+void Utils::midiNoteToFrequency(const float* midiNotes, float* frequencies, int numValues)
+{
+    for (int i = 0; i < numValues; ++i)
+        frequencies[i] = (midiNotes[i] - MIDI_A4) * (1.0f / 12.0f);
+    
+    fastExp2(frequencies, frequencies, numValues);
+    FloatVectorOperations::multiply(frequencies, CONCERT_A_FREQ, numValues);
+}
+
 float Utils::quantizeToScale(float midiNote, Parameters::Key key, Parameters::Scale scale)
 {
     if (midiNote <= 0.0f)
@@ -117,6 +228,21 @@ float Utils::hermiteInterpolation(float y0, float y1, float y2, float y3, float
     return ((c3 * x + c2) * x + c1) * x + c0;
 }
 
+float Utils::interpolateControlCurve(const float* curve, int numPoints, int sampleIndex, int numSamples)
+{
+    if (numPoints <= 1 || numSamples <= 0)
+        return curve[0];
+    
+    const float position = static_cast<float>(sampleIndex) * static_cast<float>(numPoints) / static_cast<float>(numSamples);
+    const int point = jlimit(0, numPoints - 1, static_cast<int>(position));
+    
+    if (point == numPoints - 1)
+        return curve[point];
+    
+    const float fraction = position - static_cast<float>(point);
+    return curve[point] + fraction * (curve[point + 1] - curve[point]);
+}
+
 void Utils::applyWindow(float* buffer, int numSamples, WindowType windowType)
 {
     switch (windowType)
@@ -305,6 +431,22 @@ float Utils::ratioToCents(float ratio)
     return 1200.0f * std::log2(ratio);
 }
 
+void Utils::centsToRatio(const float* cents, float* ratios, int numValues)
+{
+    FloatVectorOperations::multiply(ratios, cents, 1.0f / 1200.0f, numValues);
+    fastExp2(ratios, ratios, numValues);
+}
+
+void Utils::ratioToCents(const float* ratios, float* cents, int numValues)
+{
+    for (int i = 0; i < numValues; ++i)
+    {
+        const float ratio = ratios[i];
+        const float value = 1200.0f * log2Approx(ratio);
+        cents[i] = selectFloat(ratio > 0.0f, value, 0.0f);
+    }
+}
+
 void Utils::normalize(float* buffer, int numSamples, float targetLevel)
 {
     if (numSamples <= 0)
@@ -374,69 +516,26 @@ void Utils::fadeInOut(float* buffer, int numSamples, int fadeLength)
     }
 }
 
-// Fast trigonometric functions using lookup tables
-void Utils::initializeLookupTables()
+float Utils::fastSin(float x)
 {
-    static bool initialized = false;
-    if (initialized)
-        return;
-    
-    for (int i = 0; i < LOOKUP_TABLE_SIZE; ++i)
-    {
-        float angle = TWO_PI * i / LOOKUP_TABLE_SIZE;
-        sinLookupTable[i] = std::sin(angle);
-        cosLookupTable[i] = std::cos(angle);
-    }
-    
-    initialized = true;
+    return sinApprox(x, 0.0f);
 }
 
-float Utils::lookupSin(float x)
+float Utils::fastCos(float x)
 {
-    initializeLookupTables();
-    
-    // Normalize to [0, 2π)
-    x = std::fmod(x, TWO_PI);
-    if (x < 0.0f)
-        x += TWO_PI;
-    
-    // Convert to table index
-    float indexFloat = x * LOOKUP_TABLE_SIZE * INV_TWO_PI;
-    size_t index = static_cast<size_t>(indexFloat);
-    float fraction = indexFloat - static_cast<float>(index);
-    
-    // Linear interpolation between adjacent values
-    size_t nextIndex = (index + 1) % LOOKUP_TABLE_SIZE;
-    return sinLookupTable[index] + fraction * (sinLookupTable[nextIndex] - sinLookupTable[index]);
+    return sinApprox(x, 1.0f);
 }
 
-float Utils::lookupCos(float x)
+void Utils::fastSin(const float* input, float* output, int numValues)
 {
-    initializeLookupTables();
-    
-    // Normalize to [0, 2π)
-    x = std::fmod(x, TWO_PI);
-    if (x < 0.0f)
-        x += TWO_PI;
-    
-    // Convert to table index
-    float indexFloat = x * LOOKUP_TABLE_SIZE * INV_TWO_PI;
-    size_t index = static_cast<size_t>(indexFloat);
-    float fraction = indexFloat - static_cast<float>(index);
-    
-    // Linear interpolation between adjacent values
-    size_t nextIndex = (index + 1) % LOOKUP_TABLE_SIZE;
-    return cosLookupTable[index] + fraction * (cosLookupTable[nextIndex] - cosLookupTable[index]);
-}
-
-float Utils::fastSin(float x)
-{
-    return lookupSin(x);
+    for (int i = 0; i < numValues; ++i)
+        output[i] = sinApprox(input[i], 0.0f);
 }
 
-float Utils::fastCos(float x)
+void Utils::fastCos(const float* input, float* output, int numValues)
 {
-    return lookupCos(x);
+    for (int i = 0; i < numValues; ++i)
+        output[i] = sinApprox(input[i], 1.0f);
 }
 
 float Utils::fastAtan2(float y, float x)
@@ -463,21 +562,15 @@ float Utils::fastAtan2(float y, float x)
 
 float Utils::fastLog2(float x)
 {
-    // Fast log2 approximation using bit manipulation
     if (x <= 0.0f)
         return -100.0f; // Approximation of -infinity
     
-    union { float f; int i; } u;
-    u.f = x;
-    
-    float exponent = static_cast<float>((u.i >> 23) & 0xFF) - 127.0f;
-    u.i = (u.i & 0x007FFFFF) | 0x3F800000; // Keep mantissa, set exponent to 0
-    
-    // Polynomial approximation for mantissa
-    float mantissa = u.f;
-    float mantissaLog = -1.49278f + (2.11263f + (-0.729104f + 0.10969f * mantissa) * mantissa) * mantissa;
-    
-    return exponent + mantissaLog;
+    return log2Approx(x);
+}
+
+float Utils::fastExp2(float x)
+{
+    return exp2Approx(jlimit(minExp2Argument, maxExp2Argument, x));
 }
 
 float Utils::fastPow(float base, float exponent)
@@ -485,5 +578,23 @@ float Utils::fastPow(float base, float exponent)
     if (base <= 0.0f)
         return 0.0f;
     
-    return std::pow(2.0f, exponent * fastLog2(base));
+    return fastExp2(exponent * log2Approx(base));
+}
+
+void Utils::fastLog2(const float* input, float* output, int numValues)
+{
+    for (int i = 0; i < numValues; ++i)
+    {
+        const float x = input[i];
+        const float value = log2Approx(x);
+        output[i] = selectFloat(x > 0.0f, value, -100.0f);
+    }
+}
+
+void Utils::fastExp2(const float* input, float* output, int numValues)
+{
+    FloatVectorOperations::clip(output, input, minExp2Argument, maxExp2Argument, numValues);
+    
+    for (int i = 0; i < numValues; ++i)
+        output[i] = exp2Approx(output[i]);
 }
@@ -12,6 +12,11 @@ public:
     static float frequencyToMidiNote(float frequency);
     static float midiNoteToFrequency(float midiNote);
     
+    // Block versions built on fastLog2/fastExp2, for whole pitch curves.
+    // Input and output may be the same array. Frequencies <= 0 give note 0.
+    static void frequencyToMidiNote(const float* frequencies, float* midiNotes, int numValues);
+    static void midiNoteToFrequency(const float* midiNotes, float* frequencies, int numValues);
+    
     // Scale quantization
     static float quantizeToScale(float midiNote, Parameters::Key key, Parameters::Scale scale);
     static int findNearestScaleNote(float midiNote, const std::vector<int>& scaleNotes, int keyOffset);
@@ -26,6 +31,11 @@ public:
     static float cubicInterpolation(float y0, float y1, float y2, float y3, float x);
     static float hermiteInterpolation(float y0, float y1, float y2, float y3, float x);
     
+    // Value of a control-rate curve at one sample of the block it spans. The
+    // numPoints values sit evenly across numSamples (point p at sample
+    // p * numSamples / numPoints) and are joined linearly; the last one holds.
+    static float interpolateControlCurve(const float* curve, int numPoints, int sampleIndex, int numSamples);
+    
     // Window type enumeration
     enum class WindowType
     {
@@ -49,6 +59,8 @@ public:
     static int noteNameToNoteNumber(const String& noteName);
     static float centsToRatio(float cents);
     static float ratioToCents(float ratio);
+    static void centsToRatio(const float* cents, float* ratios, int numValues);
+    static void ratioToCents(const float* ratios, float* cents, int numValues); // ratios <= 0 give 0
     
     // Audio processing utilities
     static void normalize(float* buffer, int numSamples, float targetLevel = 1.0f);
@@ -56,12 +68,26 @@ public:
     static void fadeInOut(float* buffer, int numSamples, int fadeLength);
     
     // Math utilities
+    // Polynomial approximations without tables or branches, so the block
+    // versions vectorise. Error bounds, checked by the FastMathErrorBounds
+    // test (Benchmarks/FastMathCheck.cpp) against the std:: functions:
+    //   fastSin/fastCos  absolute < 2.5e-7 for |x| <= 2^12, < 5e-7 for |x| <= 2^15
+    //   fastLog2         absolute < 1.2e-7 plus float rounding of the result,
+    //                    for x > 0 (x <= 0 gives -100)
+    //   fastExp2         relative < 2.5e-7, x clamped to [-126, 127]
+    //   fastPow          relative < 2e-7 * (1 + |exponent * log2(base)|)
     static float fastSin(float x);
     static float fastCos(float x);
     static float fastAtan2(float y, float x);
     static float fastLog2(float x);
+    static float fastExp2(float x);
     static float fastPow(float base, float exponent);
     
+    static void fastSin(const float* input, float* output, int numValues);
+    static void fastCos(const float* input, float* output, int numValues);
+    static void fastLog2(const float* input, float* output, int numValues);
+    static void fastExp2(const float* input, float* output, int numValues);
+    
     // Constants
     static constexpr float PI = 3.14159265359f;
     static constexpr float TWO_PI = 2.0f * PI;
@@ -78,15 +104,5 @@ public:
 private:
     Utils() = delete; // Static class only
     
-    // Fast lookup tables
-    static std::vector<float> sinLookupTable;
-    static std::vector<float> cosLookupTable;
-    static constexpr int LOOKUP_TABLE_SIZE = 8192;
-    
-    // Internal utility functions
-    static void initializeLookupTables();
-    static float lookupSin(float x);
-    static float lookupCos(float x);
-    
     JUCE_DECLARE_NON_COPYABLE(Utils)
 };
@@ -0,0 +1,146 @@
+#include "VoicingGate.h"
+#include "Utils.h"
+#include <cstring>
+
+void VoicingGate::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    windowSize = nextPowerOfTwo(jmax(64, static_cast<int>(std::ceil(sampleRate * windowSeconds))));
+    hopSize = windowSize / 2;
+    releaseHops = jmax(1, static_cast<int>(std::ceil(sampleRate * releaseSeconds / hopSize)));
+
+    const double binWidth = sampleRate / windowSize;
+    minBin = jmax(1, static_cast<int>(std::ceil(flatnessMinFrequency / binWidth)));
+    maxBin = jlimit(minBin + 1, windowSize / 2, static_cast<int>(flatnessMaxFrequency / binWidth));
+
+    history.allocate(static_cast<size_t>(windowSize), true);
+    frame.allocate(static_cast<size_t>(windowSize * 2), true);
+    analysisWindow.allocate(static_cast<size_t>(windowSize), true);
+    for (int i = 0; i < windowSize; ++i)
+        analysisWindow[i] = 0.5f * (1.0f - std::cos(MathConstants<float>::twoPi * i / windowSize));
+
+    int order = 0;
+    while ((1 << order) < windowSize)
+        ++order;
+
+    fft = std::make_unique<dsp::FFT>(order);
+
+    reset();
+}
+
+void VoicingGate::reset()
+{
+    if (history != nullptr)
+        std::fill(history.getData(), history.getData() + windowSize, 0.0f);
+
+    writePosition = 0;
+    samplesUntilHop = hopSize;
+    open = false;
+    unvoicedHops = 0;
+    features = {};
+}
+
+bool VoicingGate::process(const float* input, int numSamples)
+{
+    const int mask = windowSize - 1;
+    int position = 0;
+
+    while (position < numSamples)
+    {
+        const int segment = jmin(numSamples - position, samplesUntilHop);
+        for (int i = 0; i < segment; ++i)
+            history[(writePosition + i) & mask] = input[position + i];
+
+        writePosition = (writePosition + segment) & mask;
+        samplesUntilHop -= segment;
+        position += segment;
+
+        if (samplesUntilHop == 0)
+        {
+            analyseWindow();
+            samplesUntilHop = hopSize;
+        }
+    }
+
+    return open;
+}
+
+void VoicingGate::analyseWindow()
+{
+    // Unroll the ring so the window runs oldest to newest
+    const int firstPart = windowSize - writePosition;
+    std::memcpy(frame.getData(), history.getData() + writePosition, sizeof(float) * static_cast<size_t>(firstPart));
+    std::memcpy(frame.getData() + firstPart, history.getData(), sizeof(float) * static_cast<size_t>(writePosition));
+
+    float energy = 0.0f;
+    int crossings = 0;
+    for (int i = 0; i < windowSize; ++i)
+    {
+        energy += frame[i] * frame[i];
+        if (i > 0 && (frame[i] >= 0.0f) != (frame[i - 1] >= 0.0f))
+            ++crossings;
+    }
+
+    features.levelDb = Decibels::gainToDecibels(std::sqrt(energy / windowSize), -100.0f);
+    features.crossingRate = static_cast<float>(crossings * sampleRate / (windowSize - 1));
+    features.flatness = 0.0f;
+
+    const float levelLimit = open ? closeLevelDb : openLevelDb;
+    const float crossingLimit = open ? closeCrossingRate : openCrossingRate;
+    const float flatnessLimit = open ? closeFlatness : openFlatness;
+
+    bool voiced = features.levelDb > levelLimit && features.crossingRate < crossingLimit;
+    if (voiced)
+    {
+        features.flatness = measureFlatness();
+        voiced = features.flatness < flatnessLimit;
+    }
+
+    if (voiced)
+    {
+        open = true;
+        unvoicedHops = 0;
+    }
+    else if (open && ++unvoicedHops >= releaseHops)
+    {
+        open = false;
+        unvoicedHops = 0;
+    }
+}
+
+float VoicingGate::measureFlatness()
+{
+    // Pre-emphasis takes out the downward tilt that voice and breath noise
+    // share, so only the harmonic peaks keep the flatness low
+    for (int i = windowSize - 1; i > 0; --i)
+        frame[i] -= preEmphasis * frame[i - 1];
+
+    frame[0] *= 1.0f - preEmphasis;
+
+    FloatVectorOperations::multiply(frame.getData(), analysisWindow.getData(), windowSize);
+    std::fill(frame.getData() + windowSize, frame.getData() + windowSize * 2, 0.0f);
+    fft->performFrequencyOnlyForwardTransform(frame.getData());
+
+    // Power in the band, then its log in the spare upper half of the frame
+    const int numBins = maxBin - minBin;
+    float* power = frame.getData() + minBin;
+    float* logPower = frame.getData() + windowSize;
+
+    constexpr float powerFloor = 1.0e-12f;
+    float sum = 0.0f;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        power[bin] = power[bin] * power[bin] + powerFloor;
+        sum += power[bin];
+    }
+
+    Utils::fastLog2(power, logPower, numBins);
+
+    float logSum = 0.0f;
+    for (int bin = 0; bin < numBins; ++bin)
+        logSum += logPower[bin];
+
+    const float arithmeticMean = sum / numBins;
+    const float geometricMean = Utils::fastExp2(logSum / numBins);
+    return jlimit(0.0f, 1.0f, geometricMean / arithmeticMean);
+}
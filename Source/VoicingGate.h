@@ -0,0 +1,80 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <memory>
+
+// Cheap voiced/unvoiced decision that runs in front of the pitch detector.
+// Input is kept in a short history ring, and every hop the last window is
+// measured for RMS level, zero-crossing rate and spectral flatness. Silence
+// fails on level alone, sibilants mostly on crossing rate, and breaths on
+// flatness; the FFT is only taken when the two cheaper measures have not
+// decided already.
+//
+// Thresholds have hysteresis: an open gate stays open on looser limits than
+// it takes to open it. The gate opens on the first voiced hop, so onsets are
+// never late, and closes only after releaseSeconds of unvoiced hops, so the
+// short unvoiced gaps inside a phrase do not chop the correction.
+class VoicingGate
+{
+public:
+    struct Features
+    {
+        float levelDb = -100.0f;    // RMS of the window, dBFS
+        float crossingRate = 0.0f;  // zero crossings per second
+        float flatness = 0.0f;      // geometric over arithmetic mean power, 0..1; 0 when not measured
+    };
+
+    VoicingGate() = default;
+
+    // Message thread
+    void prepare(double sampleRate);
+    void reset();
+
+    // Audio thread: returns whether the input is voiced as of the block's end
+    bool process(const float* input, int numSamples);
+
+    bool isOpen() const { return open; }
+    const Features& getLastFeatures() const { return features; }
+    int getWindowSize() const { return windowSize; }
+
+    static constexpr double windowSeconds = 0.01;
+    static constexpr double releaseSeconds = 0.1;
+
+    // Open when every measure is inside its open limit; stay open while every
+    // measure is inside its close limit
+    static constexpr float openLevelDb = -45.0f;
+    static constexpr float closeLevelDb = -50.0f;
+    static constexpr float openCrossingRate = 3000.0f;
+    static constexpr float closeCrossingRate = 4500.0f;
+    static constexpr float openFlatness = 0.25f;
+    static constexpr float closeFlatness = 0.35f;
+
+    // Flatness is measured over the band where voiced harmonics dominate
+    static constexpr float flatnessMinFrequency = 100.0f;
+    static constexpr float flatnessMaxFrequency = 6000.0f;
+    static constexpr float preEmphasis = 0.97f;
+
+private:
+    double sampleRate = 44100.0;
+    int windowSize = 512;
+    int hopSize = 256;
+    int releaseHops = 1;
+    int minBin = 1;
+    int maxBin = 128;
+
+    HeapBlock<float> history;       // windowSize ring
+    HeapBlock<float> frame;         // 2 * windowSize, unrolled window, then the spectrum in place
+    HeapBlock<float> analysisWindow;
+    std::unique_ptr<dsp::FFT> fft;
+    int writePosition = 0;
+    int samplesUntilHop = 0;
+
+    bool open = false;
+    int unvoicedHops = 0;
+    Features features;
+
+    void analyseWindow();
+    float measureFlatness();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoicingGate)
+};
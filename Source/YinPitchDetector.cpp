@@ -0,0 +1,113 @@
+#include "YinPitchDetector.h"
+#include <cstring>
+
+void YinPitchDetector::prepare(int newMaxFrameSize)
+{
+    maxFrameSize = jmax(2, newMaxFrameSize);
+
+    // Zero-padding to twice the frame keeps the autocorrelation linear: no lag
+    // below the frame length wraps around
+    int order = 1;
+    while ((1 << order) < maxFrameSize * 2)
+        ++order;
+
+    fftSize = 1 << order;
+    fft = std::make_unique<dsp::FFT>(order);
+    fftData.allocate(static_cast<size_t>(fftSize * 2), true);
+    difference.allocate(static_cast<size_t>(maxFrameSize), true);
+}
+
+void YinPitchDetector::computeDifference(const float* input, int numSamples, int numLags, float* differenceOut)
+{
+    jassert(fft != nullptr && numSamples <= maxFrameSize && numLags <= numSamples);
+    numSamples = jmin(numSamples, maxFrameSize);
+    numLags = jlimit(0, numSamples, numLags);
+
+    if (fft == nullptr || numLags == 0)
+        return;
+
+    // Autocorrelation = inverse transform of the power spectrum
+    float* data = fftData.getData();
+    std::memcpy(data, input, sizeof(float) * static_cast<size_t>(numSamples));
+    std::fill(data + numSamples, data + fftSize * 2, 0.0f);
+
+    fft->performRealOnlyForwardTransform(data, true);
+
+    for (int bin = 0; bin <= fftSize / 2; ++bin)
+    {
+        const float re = data[bin * 2];
+        const float im = data[bin * 2 + 1];
+        data[bin * 2] = re * re + im * im;
+        data[bin * 2 + 1] = 0.0f;
+    }
+
+    fft->performRealOnlyInverseTransform(data);
+
+    // head(tau) covers x[0, N - tau), tail(tau) covers x[tau, N); each loses
+    // one sample per lag. Accumulate in double so the subtraction stays exact
+    // enough near the period, where d(tau) is tiny compared with the energy.
+    double head = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+        head += static_cast<double>(input[i]) * input[i];
+
+    double tail = head;
+    differenceOut[0] = 0.0f;
+
+    for (int tau = 1; tau < numLags; ++tau)
+    {
+        head -= static_cast<double>(input[numSamples - tau]) * input[numSamples - tau];
+        tail -= static_cast<double>(input[tau - 1]) * input[tau - 1];
+        differenceOut[tau] = jmax(0.0f, static_cast<float>(head + tail - 2.0 * data[tau]));
+    }
+}
+
+float YinPitchDetector::estimatePitch(const float* input, int numSamples, double sampleRate, int maxLag, float threshold)
+{
+    lastConfidence = 0.0f;
+
+    maxLag = jmin(maxLag, numSamples, maxFrameSize);
+    if (maxLag < 3)
+        return 0.0f;
+
+    float* yinBuffer = difference.getData();
+    computeDifference(input, numSamples, maxLag, yinBuffer);
+
+    // Cumulative mean normalized difference
+    yinBuffer[0] = 1.0f;
+    float runningSum = 0.0f;
+
+    for (int tau = 1; tau < maxLag; ++tau)
+    {
+        runningSum += yinBuffer[tau];
+        yinBuffer[tau] = runningSum > 0.0f ? yinBuffer[tau] * tau / runningSum : 1.0f;
+    }
+
+    // Absolute threshold
+    int tau = 1;
+    while (tau < maxLag - 1 && yinBuffer[tau] > threshold)
+        ++tau;
+
+    if (tau == maxLag - 1)
+        return 0.0f;
+
+    // Follow the dip down to its minimum: with long windows the threshold is
+    // crossed well before it, and interpolating there biases the period
+    while (tau + 2 < maxLag && yinBuffer[tau + 1] < yinBuffer[tau])
+        ++tau;
+
+    lastConfidence = jlimit(0.0f, 1.0f, 1.0f - yinBuffer[tau]);
+
+    // Parabolic interpolation
+    const float y0 = yinBuffer[tau - 1];
+    const float y1 = yinBuffer[tau];
+    const float y2 = yinBuffer[tau + 1];
+
+    const float a = (y0 + y2 - 2.0f * y1) / 2.0f;
+    const float b = (y2 - y0) / 2.0f;
+
+    float betterTau = static_cast<float>(tau);
+    if (a != 0.0f)
+        betterTau = tau - b / (2.0f * a);
+
+    return static_cast<float>(sampleRate) / betterTau;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <memory>
+
+// YIN pitch estimator with an FFT-based difference function. Instead of the
+// direct O(N * maxLag) sum it uses
+//
+//     d(tau) = head(tau) + tail(tau) - 2 * r(tau)
+//
+// where r is the linear autocorrelation from one forward/inverse real FFT and
+// head/tail are the energies of the two overlapping segments, updated by one
+// sample per lag. All buffers are allocated in prepare(), so both calls below
+// are safe on the audio thread.
+class YinPitchDetector
+{
+public:
+    YinPitchDetector() = default;
+
+    // Message thread: sizes the FFT for frames of up to maxFrameSize samples
+    void prepare(int maxFrameSize);
+    int getMaxFrameSize() const { return maxFrameSize; }
+
+    // Raw difference d(tau) = sum over i < N - tau of (x[i] - x[i + tau])^2,
+    // for tau in [0, numLags). numLags must not exceed numSamples.
+    void computeDifference(const float* input, int numSamples, int numLags, float* difference);
+
+    // Cumulative mean normalised difference, absolute threshold, descent to the
+    // local minimum and parabolic interpolation over lags [1, maxLag). Returns Hz, or 0 when no lag dips
+    // under the threshold.
+    float estimatePitch(const float* input, int numSamples, double sampleRate, int maxLag, float threshold = 0.1f);
+
+    // 1 - normalised difference at the lag picked by the last estimatePitch()
+    // call, or 0 if it found none
+    float getLastConfidence() const { return lastConfidence; }
+
+private:
+    std::unique_ptr<dsp::FFT> fft;
+    HeapBlock<float> fftData;       // 2 * fftSize floats, in place
+    HeapBlock<float> difference;    // maxFrameSize lags
+    int fftSize = 0;
+    int maxFrameSize = 0;
+    float lastConfidence = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(YinPitchDetector)
+};
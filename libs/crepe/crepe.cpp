@@ -5,16 +5,40 @@
 #include <numeric>
 #include <cstring>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CREPE_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CREPE_SIMD_NEON 1
+#endif
+
 bool CrepeModel::initialized_ = false;
+std::string CrepeModel::modelPath_;
 std::unique_ptr<tflite::Interpreter> CrepeModel::interpreter_ = nullptr;
 std::unique_ptr<tflite::FlatBufferModel> CrepeModel::model_ = nullptr;
-std::array<float, CrepeModel::CREPE_CENTS_MAPPING_SIZE> CrepeModel::centsMapping_;
+bool CrepeModel::viterbiEnabled_ = false;
+int64_t CrepeModel::viterbiFrame_ = 0;
+CrepeViterbiDecoder CrepeModel::viterbi_;
+std::vector<float> CrepeModel::fallbackFrame_;
+std::vector<float> CrepeModel::yinDifference_;
+
+// Cents above 10 Hz at the centre of each output bin, as in crepe.core:
+// 360 bins 20 cents apart, from 1997.38 cents (~31.7 Hz) up to ~2006 Hz
+const std::array<float, CrepeModel::CREPE_CENTS_MAPPING_SIZE> CrepeModel::centsMapping_ = [] {
+    std::array<float, CREPE_CENTS_MAPPING_SIZE> mapping {};
+    for (size_t i = 0; i < CREPE_CENTS_MAPPING_SIZE; ++i) {
+        mapping[i] = 1997.3794084376191f + 20.0f * static_cast<float>(i);
+    }
+    return mapping;
+}();
 
 bool CrepeModel::initialize() {
     if (initialized_) return true;
     
-    // Generate cents mapping for CREPE output
-    generateCentsMapping();
+    // The fallbacks' buffers, sized for the one 16 kHz frame they analyse
+    fallbackFrame_.assign(CREPE_MODEL_CAPACITY, 0.0f);
+    yinDifference_.assign(static_cast<size_t>(CREPE_SAMPLE_RATE / MIN_FREQUENCY) + 1, 0.0f);
     
     // Try to load TensorFlow Lite model
     if (loadModel()) {
@@ -31,6 +55,10 @@ bool CrepeModel::isInitialized() {
     return initialized_;
 }
 
+bool CrepeModel::hasModel() {
+    return interpreter_ != nullptr;
+}
+
 void CrepeModel::shutdown() {
     interpreter_.reset();
     model_.reset();
@@ -38,29 +66,21 @@ void CrepeModel::shutdown() {
 }
 
 void CrepeModel::setModelPath(const std::string& path) {
-    // Store model path for future loading
+    // The next estimatePitch loads from the new path
+    modelPath_ = path;
+    shutdown();
 }
 
-void CrepeModel::setViterbiDecoder(bool enabled) {
-    // Configure Viterbi decoding (for smoothing pitch tracks)
+void CrepeModel::setViterbiDecoder(bool enabled, int lagFrames) {
+    viterbiEnabled_ = enabled;
+    viterbiFrame_ = 0;
+    if (enabled) viterbi_.prepare(CrepeViterbiDecoder::defaultBand, lagFrames);
 }
 
-void CrepeModel::setCenterFrequency(bool center) {
+void CrepeModel::setCenterFrequency(bool /*center*/) {
     // Configure frequency centering
 }
 
-void CrepeModel::generateCentsMapping() {
-    // CREPE outputs 360 values corresponding to cents
-    // This maps output indices to frequencies
-    const float CENTS_PER_OCTAVE = 1200.0f;
-    const float REFERENCE_FREQ = 10.0f; // Reference frequency in Hz
-    
-    for (size_t i = 0; i < CREPE_CENTS_MAPPING_SIZE; ++i) {
-        float cents = (i / static_cast<float>(CREPE_CENTS_MAPPING_SIZE - 1)) * CENTS_PER_OCTAVE * 6; // 6 octaves
-        centsMapping_[i] = centsToFrequency(cents);
-    }
-}
-
 float CrepeModel::centsToFrequency(float cents) {
     const float REFERENCE_FREQ = 10.0f; // 10 Hz reference
     return REFERENCE_FREQ * std::pow(2.0f, cents / 1200.0f);
@@ -73,23 +93,44 @@ float CrepeModel::frequencyToCents(float frequency) {
 }
 
 bool CrepeModel::loadModel() {
+    if (modelPath_.empty()) return false;
+    
     try {
-        // Create a minimal TensorFlow Lite model for CREPE
-        // In a real implementation, this would load a pre-trained CREPE model
-        model_ = tflite::FlatBufferModel::BuildFromBuffer(nullptr, 0);
+        model_ = tflite::FlatBufferModel::BuildFromFile(modelPath_.c_str());
         if (!model_ || !model_->initialized()) return false;
         
-        tflite::InterpreterBuilder builder(*model_);
-        if (!builder(&interpreter_)) return false;
-        
-        if (!interpreter_->AllocateTensors()) return false;
+        interpreter_ = createInterpreter(*model_);
+        if (!interpreter_) {
+            model_.reset();
+            return false;
+        }
         
         return true;
     } catch (...) {
+        interpreter_.reset();
+        model_.reset();
         return false;
     }
 }
 
+std::unique_ptr<tflite::Interpreter> CrepeModel::createInterpreter(const tflite::FlatBufferModel& model) {
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    tflite::InterpreterBuilder builder(model);
+    if (builder(&interpreter) != tflite::Status::kOk) return nullptr;
+    if (interpreter->AllocateTensors() != tflite::Status::kOk) return nullptr;
+    
+    // Anything but one 1024-sample frame in and 360 bins out is not CREPE
+    const auto* input = interpreter->input_tensor(0);
+    const auto* output = interpreter->output_tensor(0);
+    const std::vector<int> inputShape = {1, static_cast<int>(CREPE_MODEL_CAPACITY)};
+    const std::vector<int> outputShape = {1, static_cast<int>(CREPE_CENTS_MAPPING_SIZE)};
+    if (input == nullptr || output == nullptr || input->shape != inputShape || output->shape != outputShape) {
+        return nullptr;
+    }
+    
+    return interpreter;
+}
+
 CrepeModel::PitchResult CrepeModel::estimatePitch(const std::vector<float>& audioBuffer, float sampleRate) {
     if (!initialized_) initialize();
     
@@ -100,106 +141,184 @@ CrepeModel::PitchResult CrepeModel::estimatePitch(const std::vector<float>& audi
         return result;
     }
     
-    // Preprocess audio for CREPE
-    std::vector<float> processedAudio = preprocessAudio(audioBuffer, sampleRate);
-    
     // Try TensorFlow Lite inference first
-    if (interpreter_ && processedAudio.size() == CREPE_MODEL_CAPACITY) {
-        auto* input_tensor = interpreter_->input_tensor(0);
-        if (input_tensor && input_tensor->data) {
-            // Copy preprocessed audio to input tensor
-            std::memcpy(input_tensor->data, processedAudio.data(), 
-                       CREPE_MODEL_CAPACITY * sizeof(float));
-            
-            // Run inference
-            if (interpreter_->Invoke()) {
-                auto* output_tensor = interpreter_->output_tensor(0);
-                if (output_tensor && output_tensor->data) {
-                    result = postprocessOutput(output_tensor->data, output_tensor->size);
-                    if (result.isValid()) return result;
-                }
-            }
+    if (interpreter_) {
+        result = runFrame(*interpreter_, audioBuffer.data(), audioBuffer.size(), sampleRate);
+        
+        const float* activation = interpreter_->typed_output_tensor(0);
+        CrepeViterbiDecoder::Decision decision;
+        if (viterbiEnabled_ && activation != nullptr) {
+            result = viterbi_.pushFrame(activation, viterbiFrame_++, decision)
+                ? PitchResult{decision.frequency, decision.confidence} : PitchResult{0.0f, 0.0f};
         }
+        
+        if (result.isValid()) return result;
     }
     
+    // The fallbacks look at the same 16 kHz frame the network sees
+    prepareFrame(audioBuffer.data(), audioBuffer.size(), sampleRate, fallbackFrame_.data());
+    
     // Fallback to YIN algorithm
-    result = yinPitchDetection(processedAudio, sampleRate);
+    result = yinPitchDetection(fallbackFrame_.data(), fallbackFrame_.size(), CREPE_SAMPLE_RATE);
     if (result.isValid()) return result;
     
     // Final fallback to autocorrelation
-    return autocorrelationPitch(processedAudio, sampleRate);
+    return autocorrelationPitch(fallbackFrame_.data(), fallbackFrame_.size(), CREPE_SAMPLE_RATE);
 }
 
-std::vector<float> CrepeModel::preprocessAudio(const std::vector<float>& audio, float sampleRate) {
-    std::vector<float> processed;
-    processed.reserve(CREPE_MODEL_CAPACITY);
+CrepeModel::PitchResult CrepeModel::runFrame(tflite::Interpreter& interpreter, const float* audio,
+                                             size_t numSamples, float sampleRate) {
+    float* input = interpreter.typed_input_tensor(0);
+    if (input == nullptr || audio == nullptr || sampleRate <= 0.0f) return {0.0f, 0.0f};
     
-    // Resample to CREPE's expected sample rate (16kHz)
-    const float TARGET_SAMPLE_RATE = 16000.0f;
-    const float resampleRatio = sampleRate / TARGET_SAMPLE_RATE;
+    prepareFrame(audio, numSamples, sampleRate, input);
+    if (interpreter.Invoke() != tflite::Status::kOk) return {0.0f, 0.0f};
     
-    // Simple linear interpolation resampling
-    for (size_t i = 0; i < CREPE_MODEL_CAPACITY && processed.size() < CREPE_MODEL_CAPACITY; ++i) {
-        float srcIndex = i * resampleRatio;
-        size_t idx1 = static_cast<size_t>(srcIndex);
-        size_t idx2 = idx1 + 1;
+    const float* activation = interpreter.typed_output_tensor(0);
+    return activation != nullptr ? decodeActivation(activation) : PitchResult{0.0f, 0.0f};
+}
+
+bool CrepeModel::setBatchSize(tflite::Interpreter& interpreter, size_t batchSize) {
+    if (batchSize == 0) return false;
+    if (getBatchSize(interpreter) == batchSize) return true;
+    
+    const std::vector<int> dims = {static_cast<int>(batchSize), static_cast<int>(CREPE_MODEL_CAPACITY)};
+    return interpreter.ResizeInputTensor(0, dims) == tflite::Status::kOk
+        && interpreter.AllocateTensors() == tflite::Status::kOk;
+}
+
+size_t CrepeModel::getBatchSize(tflite::Interpreter& interpreter) {
+    const auto* input = interpreter.input_tensor(0);
+    return input != nullptr && !input->shape.empty() ? static_cast<size_t>(input->shape[0]) : 0;
+}
+
+size_t CrepeModel::getNumFrames(size_t numSamples, float sampleRate, size_t hopSamples) {
+    const size_t frameSamples = getInputSamplesNeeded(sampleRate);
+    if (numSamples < frameSamples || hopSamples == 0) return 0;
+    return 1 + (numSamples - frameSamples) / hopSamples;
+}
+
+size_t CrepeModel::runFrames(tflite::Interpreter& interpreter, const float* audio, size_t numSamples, float sampleRate,
+                             size_t hopSamples, size_t numFrames, float* activations, PitchResult* pitches) {
+    const size_t batchSize = getBatchSize(interpreter);
+    float* input = interpreter.typed_input_tensor(0);
+    if (input == nullptr || audio == nullptr || sampleRate <= 0.0f || batchSize == 0) return 0;
+    
+    numFrames = std::min(numFrames, getNumFrames(numSamples, sampleRate, hopSamples));
+    const size_t frameSamples = getInputSamplesNeeded(sampleRate);
+    
+    for (size_t first = 0; first < numFrames; first += batchSize) {
+        const size_t count = std::min(batchSize, numFrames - first);
         
-        if (idx2 < audio.size()) {
-            float frac = srcIndex - idx1;
-            float sample = audio[idx1] + frac * (audio[idx2] - audio[idx1]);
-            processed.push_back(sample);
-        } else if (idx1 < audio.size()) {
-            processed.push_back(audio[idx1]);
-        } else {
-            processed.push_back(0.0f);
+        // Rows past count keep whatever they held; their outputs are ignored
+        for (size_t row = 0; row < count; ++row) {
+            prepareFrame(audio + (first + row) * hopSamples, frameSamples, sampleRate,
+                         input + row * CREPE_MODEL_CAPACITY);
+        }
+        
+        if (interpreter.Invoke() != tflite::Status::kOk) return first;
+        
+        const float* output = interpreter.typed_output_tensor(0);
+        if (output == nullptr) return first;
+        
+        for (size_t row = 0; row < count; ++row) {
+            const float* activation = output + row * CREPE_CENTS_MAPPING_SIZE;
+            if (activations != nullptr) {
+                std::copy(activation, activation + CREPE_CENTS_MAPPING_SIZE,
+                          activations + (first + row) * CREPE_CENTS_MAPPING_SIZE);
+            }
+            if (pitches != nullptr) pitches[first + row] = decodeActivation(activation);
         }
     }
     
-    // Pad or trim to exact size
-    processed.resize(CREPE_MODEL_CAPACITY, 0.0f);
+    return numFrames;
+}
+
+size_t CrepeModel::getInputSamplesNeeded(float sampleRate) {
+    return static_cast<size_t>(std::ceil((CREPE_MODEL_CAPACITY - 1) * sampleRate / CREPE_SAMPLE_RATE)) + 1;
+}
+
+void CrepeModel::prepareFrame(const float* audio, size_t numSamples, float sampleRate, float* frame) {
+    if (numSamples == 0) {
+        std::fill(frame, frame + CREPE_MODEL_CAPACITY, 0.0f);
+        return;
+    }
     
-    // Apply Hanning window
-    applyHanningWindow(processed);
+    // Linear interpolation onto CREPE's 16 kHz grid, ending on the newest
+    // sample; a short buffer is zero-padded at the front
+    const double step = sampleRate / CREPE_SAMPLE_RATE;
+    const double start = static_cast<double>(numSamples - 1) - (CREPE_MODEL_CAPACITY - 1) * step;
     
-    // Normalize
-    float rms = calculateRMS(processed);
-    if (rms > 1e-6f) {
-        float scale = 1.0f / rms;
-        for (float& sample : processed) {
-            sample *= scale;
+    for (size_t i = 0; i < CREPE_MODEL_CAPACITY; ++i) {
+        const double position = start + i * step;
+        if (position < 0.0) {
+            frame[i] = 0.0f;
+            continue;
         }
+        
+        const size_t index = static_cast<size_t>(position);
+        const float frac = static_cast<float>(position - static_cast<double>(index));
+        const float next = index + 1 < numSamples ? audio[index + 1] : audio[index];
+        frame[i] = audio[index] + frac * (next - audio[index]);
     }
     
-    return processed;
+    // The network was trained on zero-mean, unit-variance frames
+    float mean = 0.0f;
+    for (size_t i = 0; i < CREPE_MODEL_CAPACITY; ++i) mean += frame[i];
+    mean /= CREPE_MODEL_CAPACITY;
+    
+    float variance = 0.0f;
+    for (size_t i = 0; i < CREPE_MODEL_CAPACITY; ++i) {
+        frame[i] -= mean;
+        variance += frame[i] * frame[i];
+    }
+    
+    const float scale = 1.0f / std::max(std::sqrt(variance / CREPE_MODEL_CAPACITY), 1e-8f);
+    for (size_t i = 0; i < CREPE_MODEL_CAPACITY; ++i) frame[i] *= scale;
 }
 
-CrepeModel::PitchResult CrepeModel::postprocessOutput(const float* output, size_t outputSize) {
-    if (!output || outputSize < 2) return {0.0f, 0.0f};
-    
-    // For our simplified implementation, output[0] = frequency, output[1] = confidence
-    float frequency = output[0];
-    float confidence = output[1];
+CrepeModel::PitchResult CrepeModel::decodeActivation(const float* activation) {
+    // Peak bin, refined as below
+    const size_t center = static_cast<size_t>(std::max_element(activation, activation + CREPE_CENTS_MAPPING_SIZE) - activation);
+    return decodeActivation(activation, center);
+}
+
+CrepeModel::PitchResult CrepeModel::decodeActivation(const float* activation, size_t center) {
+    // Activation-weighted mean of the cents within four bins of the centre
+    // (crepe.core.to_local_average_cents)
+    center = std::min(center, CREPE_CENTS_MAPPING_SIZE - 1);
+    const size_t first = center >= 4 ? center - 4 : 0;
+    const size_t last = std::min(center + 5, CREPE_CENTS_MAPPING_SIZE);
+    
+    float weightedCents = 0.0f;
+    float weightSum = 0.0f;
+    for (size_t bin = first; bin < last; ++bin) {
+        weightedCents += activation[bin] * centsMapping_[bin];
+        weightSum += activation[bin];
+    }
     
-    // Clamp to valid range
-    frequency = std::max(MIN_FREQUENCY, std::min(frequency, MAX_FREQUENCY));
-    confidence = std::max(0.0f, std::min(confidence, 1.0f));
+    const float confidence = std::max(0.0f, std::min(activation[center], 1.0f));
+    if (weightSum <= 0.0f) return {0.0f, confidence};
     
-    return {frequency, confidence};
+    return {centsToFrequency(weightedCents / weightSum), confidence};
 }
 
-CrepeModel::PitchResult CrepeModel::yinPitchDetection(const std::vector<float>& signal, float sampleRate) {
+CrepeModel::PitchResult CrepeModel::yinPitchDetection(const float* signal, size_t numSamples, float sampleRate) {
     const int minPeriod = static_cast<int>(sampleRate / MAX_FREQUENCY);
     const int maxPeriod = static_cast<int>(sampleRate / MIN_FREQUENCY);
     
-    if (minPeriod >= maxPeriod || maxPeriod >= static_cast<int>(signal.size())) {
+    if (minPeriod >= maxPeriod || maxPeriod >= static_cast<int>(numSamples)
+        || maxPeriod >= static_cast<int>(yinDifference_.size())) {
         return {0.0f, 0.0f};
     }
     
-    std::vector<float> cumulativeDifference(maxPeriod + 1, 0.0f);
+    float* cumulativeDifference = yinDifference_.data();
+    std::fill(cumulativeDifference, cumulativeDifference + maxPeriod + 1, 0.0f);
     
-    // Calculate difference function
+    // Calculate difference function. The frame is always 1024 samples at
+    // 16 kHz, so the direct sum is a fixed ~300k multiply-adds.
     for (int tau = minPeriod; tau <= maxPeriod; ++tau) {
-        for (size_t j = 0; j + tau < signal.size(); ++j) {
+        for (size_t j = 0; j + tau < numSamples; ++j) {
             float diff = signal[j] - signal[j + tau];
             cumulativeDifference[tau] += diff * diff;
         }
@@ -245,15 +364,15 @@ CrepeModel::PitchResult CrepeModel::yinPitchDetection(const std::vector<float>&
     return {0.0f, 0.0f};
 }
 
-CrepeModel::PitchResult CrepeModel::autocorrelationPitch(const std::vector<float>& signal, float sampleRate) {
+CrepeModel::PitchResult CrepeModel::autocorrelationPitch(const float* signal, size_t numSamples, float sampleRate) {
     const int minPeriod = static_cast<int>(sampleRate / MAX_FREQUENCY);
     const int maxPeriod = static_cast<int>(sampleRate / MIN_FREQUENCY);
     
     float bestCorrelation = 0.0f;
     int bestPeriod = 0;
     
-    for (int period = minPeriod; period <= maxPeriod && period < static_cast<int>(signal.size() / 2); ++period) {
-        float correlation = autocorrelation(signal, period);
+    for (int period = minPeriod; period <= maxPeriod && period < static_cast<int>(numSamples / 2); ++period) {
+        float correlation = autocorrelation(signal, numSamples, period);
         if (correlation > bestCorrelation) {
             bestCorrelation = correlation;
             bestPeriod = period;
@@ -269,12 +388,12 @@ CrepeModel::PitchResult CrepeModel::autocorrelationPitch(const std::vector<float
     return {0.0f, 0.0f};
 }
 
-float CrepeModel::autocorrelation(const std::vector<float>& signal, int lag) {
+float CrepeModel::autocorrelation(const float* signal, size_t numSamples, int lag) {
     float sum = 0.0f;
     float norm1 = 0.0f, norm2 = 0.0f;
     int count = 0;
     
-    for (size_t i = 0; i + lag < signal.size(); ++i) {
+    for (size_t i = 0; i + lag < numSamples; ++i) {
         sum += signal[i] * signal[i + lag];
         norm1 += signal[i] * signal[i];
         norm2 += signal[i + lag] * signal[i + lag];
@@ -287,16 +406,6 @@ float CrepeModel::autocorrelation(const std::vector<float>& signal, int lag) {
     return 0.0f;
 }
 
-void CrepeModel::applyHanningWindow(std::vector<float>& buffer) {
-    if (buffer.empty()) return;
-    
-    const size_t N = buffer.size();
-    for (size_t i = 0; i < N; ++i) {
-        float window = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (N - 1)));
-        buffer[i] *= window;
-    }
-}
-
 float CrepeModel::calculateRMS(const std::vector<float>& buffer) {
     if (buffer.empty()) return 0.0f;
     
@@ -313,4 +422,161 @@ bool CrepeModel::isAudioValid(const std::vector<float>& buffer) {
     // Check for non-silent audio
     float rms = calculateRMS(buffer);
     return rms > 1e-6f;
-}
\ No newline at end of file
+}
+//==============================================================================
+// CrepeViterbiDecoder
+
+namespace {
+
+constexpr size_t kBins = CrepeModel::CREPE_CENTS_MAPPING_SIZE;
+constexpr int kMaxBand = 64;
+
+// crepe.core: the peak bin is the true one with probability 0.1, and the
+// remaining 0.9 is spread evenly over all 360 bins. Only the ratio between
+// the observed bin and the rest matters to the path.
+constexpr float kSelfEmission = 0.1f;
+const float kObservedGain = std::log((kSelfEmission + (1.0f - kSelfEmission) / kBins) / ((1.0f - kSelfEmission) / kBins));
+
+// Stands in for -inf, which -ffast-math builds need not honour
+constexpr float kUnreachable = -1.0e30f;
+
+static_assert(kBins % 4 == 0, "the transition step works on four bins at a time");
+
+#if CREPE_SIMD_SSE
+using Vec4 = __m128;
+inline Vec4 load4(const float* p) { return _mm_loadu_ps(p); }
+inline void store4(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+inline Vec4 splat4(float x) { return _mm_set1_ps(x); }
+inline Vec4 add4(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+inline Vec4 max4(Vec4 a, Vec4 b) { return _mm_max_ps(a, b); }
+// Per lane: a > b ? x : y
+inline Vec4 selectGreater4(Vec4 a, Vec4 b, Vec4 x, Vec4 y) {
+    const Vec4 mask = _mm_cmpgt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+#elif CREPE_SIMD_NEON
+using Vec4 = float32x4_t;
+inline Vec4 load4(const float* p) { return vld1q_f32(p); }
+inline void store4(float* p, Vec4 v) { vst1q_f32(p, v); }
+inline Vec4 splat4(float x) { return vdupq_n_f32(x); }
+inline Vec4 add4(Vec4 a, Vec4 b) { return vaddq_f32(a, b); }
+inline Vec4 max4(Vec4 a, Vec4 b) { return vmaxq_f32(a, b); }
+inline Vec4 selectGreater4(Vec4 a, Vec4 b, Vec4 x, Vec4 y) { return vbslq_f32(vcgtq_f32(a, b), x, y); }
+#else
+struct Vec4 { float v[4]; };
+inline Vec4 load4(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store4(float* p, Vec4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline Vec4 splat4(float x) { return {{x, x, x, x}}; }
+inline Vec4 add4(Vec4 a, Vec4 b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+inline Vec4 max4(Vec4 a, Vec4 b) {
+    return {{std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3])}};
+}
+inline Vec4 selectGreater4(Vec4 a, Vec4 b, Vec4 x, Vec4 y) {
+    Vec4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? x.v[i] : y.v[i];
+    return r;
+}
+#endif
+
+} // namespace
+
+void CrepeViterbiDecoder::prepare(int band, int lagFrames) {
+    band_ = std::max(1, std::min(band, kMaxBand));
+    lagFrames_ = std::max(0, lagFrames);
+    
+    // A step of d bins has weight band + 1 - |d|, normalised over the steps
+    // that stay inside the 360 bins (crepe.core's row-normalised matrix)
+    stepWeights_.resize(static_cast<size_t>(band_) + 1);
+    for (int step = 0; step <= band_; ++step) {
+        stepWeights_[static_cast<size_t>(step)] = std::log(static_cast<float>(band_ + 1 - step));
+    }
+    
+    logRowSums_.resize(kBins);
+    for (size_t bin = 0; bin < kBins; ++bin) {
+        float rowSum = 0.0f;
+        for (int step = -band_; step <= band_; ++step) {
+            const long target = static_cast<long>(bin) + step;
+            if (target >= 0 && target < static_cast<long>(kBins)) rowSum += static_cast<float>(band_ + 1 - std::abs(step));
+        }
+        logRowSums_[bin] = std::log(rowSum);
+    }
+    
+    const size_t ringFrames = static_cast<size_t>(lagFrames_) + 1;
+    scores_.assign(kBins, 0.0f);
+    sources_.assign(kBins + 2 * static_cast<size_t>(band_), kUnreachable);
+    steps_.assign(kBins, 0.0f);
+    backPointers_.assign(ringFrames * kBins, 0);
+    activations_.assign(ringFrames * kBins, 0.0f);
+    timestamps_.assign(ringFrames, 0);
+    
+    reset();
+}
+
+void CrepeViterbiDecoder::reset() {
+    // Uniform prior over the starting bin
+    std::fill(scores_.begin(), scores_.end(), 0.0f);
+    framesSeen_ = 0;
+}
+
+bool CrepeViterbiDecoder::pushFrame(const float* activation, int64_t timestamp, Decision& decision) {
+    if (!isPrepared() || activation == nullptr) return false;
+    
+    const size_t ringFrames = static_cast<size_t>(lagFrames_) + 1;
+    const size_t slot = static_cast<size_t>(framesSeen_ % static_cast<int64_t>(ringFrames));
+    int16_t* pointers = backPointers_.data() + slot * kBins;
+    
+    if (framesSeen_ > 0) {
+        // Scores as seen from each source bin, with its row normalisation;
+        // the padding either side is unreachable
+        float* sources = sources_.data() + band_;
+        for (size_t bin = 0; bin < kBins; ++bin) sources[bin] = scores_[bin] - logRowSums_[bin];
+        
+        // Best incoming step for four target bins at a time; ties keep the
+        // step tried first
+        for (size_t bin = 0; bin < kBins; bin += 4) {
+            Vec4 best = splat4(kUnreachable);
+            Vec4 bestStep = splat4(0.0f);
+            
+            for (int step = -band_; step <= band_; ++step) {
+                const Vec4 candidate = add4(load4(sources + bin + step), splat4(stepWeights_[static_cast<size_t>(std::abs(step))]));
+                bestStep = selectGreater4(candidate, best, splat4(static_cast<float>(step)), bestStep);
+                best = max4(candidate, best);
+            }
+            
+            store4(scores_.data() + bin, best);
+            store4(steps_.data() + bin, bestStep);
+        }
+        
+        for (size_t bin = 0; bin < kBins; ++bin) {
+            pointers[bin] = static_cast<int16_t>(static_cast<int>(bin) + static_cast<int>(steps_[bin]));
+        }
+    }
+    
+    const size_t observed = static_cast<size_t>(std::max_element(activation, activation + kBins) - activation);
+    scores_[observed] += kObservedGain;
+    
+    // Rescale so the best path scores 0 and the scores never drift
+    const auto bestIt = std::max_element(scores_.begin(), scores_.end());
+    const float bestScore = *bestIt;
+    size_t bin = static_cast<size_t>(bestIt - scores_.begin());
+    for (float& score : scores_) score -= bestScore;
+    
+    std::copy(activation, activation + kBins, activations_.data() + slot * kBins);
+    timestamps_[slot] = timestamp;
+    ++framesSeen_;
+    
+    if (framesSeen_ <= lagFrames_) return false;
+    
+    // Follow the best path back lagFrames frames
+    for (int back = 0; back < lagFrames_; ++back) {
+        const size_t frame = static_cast<size_t>((framesSeen_ - 1 - back) % static_cast<int64_t>(ringFrames));
+        bin = static_cast<size_t>(backPointers_[frame * kBins + bin]);
+    }
+    
+    const size_t decided = static_cast<size_t>((framesSeen_ - 1 - lagFrames_) % static_cast<int64_t>(ringFrames));
+    const auto pitch = CrepeModel::decodeActivation(activations_.data() + decided * kBins, bin);
+    decision = {pitch.frequency, pitch.confidence, timestamps_[decided]};
+    return true;
+}
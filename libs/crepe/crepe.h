@@ -1,7 +1,9 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 // Forward declaration to avoid TensorFlow Lite dependency in header
 namespace tflite {
@@ -9,6 +11,49 @@ namespace tflite {
     class FlatBufferModel;
 }
 
+// Streaming Viterbi smoothing of CREPE activations, with the model of
+// crepe.core.to_viterbi_cents: each frame observes its peak bin, which is
+// right with probability 0.1 (the rest is spread evenly over all bins), and
+// the pitch moves at most `band` bins from one frame to the next, weighted
+// by band + 1 - |step|. Only those 2 * band + 1 steps are evaluated, four
+// bins at a time, so a frame costs O(360 * band) rather than O(360^2).
+// A frame's bin is traced back from the best path lagFrames frames later.
+class CrepeViterbiDecoder {
+public:
+    static constexpr int defaultBand = 11;
+    static constexpr int defaultLagFrames = 4;
+    
+    struct Decision {
+        float frequency;
+        float confidence;   // activation of the decided bin
+        int64_t timestamp;  // as pushed with the frame this decision is for
+    };
+    
+    // prepare allocates; reset and pushFrame never do
+    void prepare(int band = defaultBand, int lagFrames = defaultLagFrames);
+    void reset();
+    bool isPrepared() const { return band_ > 0; }
+    int getLagFrames() const { return lagFrames_; }
+    
+    // Adds one frame of 360 activations. Once more than lagFrames frames
+    // are in, fills decision for the frame lagFrames back and returns true.
+    bool pushFrame(const float* activation, int64_t timestamp, Decision& decision);
+    
+private:
+    int band_ = 0;
+    int lagFrames_ = 0;
+    int64_t framesSeen_ = 0;
+    
+    std::vector<float> stepWeights_;        // log weight per |step|, 0..band
+    std::vector<float> logRowSums_;         // per source bin, normalises its outgoing weights
+    std::vector<float> scores_;             // log score of the best path into each bin
+    std::vector<float> sources_;            // scores_ less logRowSums_, padded by band bins each side
+    std::vector<float> steps_;              // step taken into each bin, as float for the SIMD select
+    std::vector<int16_t> backPointers_;     // (lagFrames + 1) x 360 ring of source bins
+    std::vector<float> activations_;        // (lagFrames + 1) x 360 ring
+    std::vector<int64_t> timestamps_;       // lagFrames + 1 ring
+};
+
 // CREPE AI pitch detection with TensorFlow Lite backend
 class CrepeModel {
 public:
@@ -18,46 +63,78 @@ public:
         bool isValid() const { return frequency > 0.0f && confidence > 0.1f; }
     };
     
-    // Main API
+    // CREPE constants
+    static constexpr size_t CREPE_MODEL_CAPACITY = 1024;       // samples per frame
+    static constexpr size_t CREPE_CENTS_MAPPING_SIZE = 360;    // activation bins, 20 cents apart
+    static constexpr float CREPE_SAMPLE_RATE = 16000.0f;
+    
+    // Main API. initialize() allocates the fallbacks' buffers; estimatePitch
+    // calls it when needed and otherwise does not allocate.
     static PitchResult estimatePitch(const std::vector<float>& audioBuffer, float sampleRate);
     static bool initialize();
     static bool isInitialized();
+    static bool hasModel();
     static void shutdown();
     
-    // Advanced configuration
+    // Advanced configuration. The model is an MTFL export of the Keras
+    // weights (libs/crepe_models/export_weights.py); without one, pitch comes
+    // from the YIN and autocorrelation fallbacks
     static void setModelPath(const std::string& path);
-    static void setViterbiDecoder(bool enabled);
+    // With the decoder on, estimatePitch returns the smoothed pitch of the
+    // frame lagFrames calls back
+    static void setViterbiDecoder(bool enabled, int lagFrames = CrepeViterbiDecoder::defaultLagFrames);
     static void setCenterFrequency(bool center);
     
+    // Building blocks for callers that run their own interpreter, one per
+    // thread. prepareFrame, decodeActivation and runFrame never allocate.
+    static std::unique_ptr<tflite::Interpreter> createInterpreter(const tflite::FlatBufferModel& model);
+    static size_t getInputSamplesNeeded(float sampleRate);
+    static void prepareFrame(const float* audio, size_t numSamples, float sampleRate, float* frame);
+    static PitchResult decodeActivation(const float* activation);
+    static PitchResult decodeActivation(const float* activation, size_t center);
+    static PitchResult runFrame(tflite::Interpreter& interpreter, const float* audio, size_t numSamples, float sampleRate);
+    
+    // Batched analysis for offline renders and background threads. Frame f
+    // is the getInputSamplesNeeded(sampleRate) samples starting at
+    // f * hopSamples, and the frames go through the network batch size at a
+    // time, so every layer's GEMM is that much wider. activations
+    // (numFrames x 360) and pitches may each be null. runFrames returns how
+    // many frames it analysed: at most numFrames, and no more than fit in
+    // numSamples. Changing the batch size allocates.
+    static bool setBatchSize(tflite::Interpreter& interpreter, size_t batchSize);
+    static size_t getBatchSize(tflite::Interpreter& interpreter);
+    static size_t getNumFrames(size_t numSamples, float sampleRate, size_t hopSamples);
+    static size_t runFrames(tflite::Interpreter& interpreter, const float* audio, size_t numSamples, float sampleRate,
+                            size_t hopSamples, size_t numFrames, float* activations, PitchResult* pitches);
+    
 private:
     static bool initialized_;
+    static std::string modelPath_;
     static std::unique_ptr<tflite::Interpreter> interpreter_;
     static std::unique_ptr<tflite::FlatBufferModel> model_;
+    static bool viterbiEnabled_;
+    static int64_t viterbiFrame_;
+    static CrepeViterbiDecoder viterbi_;
+    static std::vector<float> fallbackFrame_;   // the 16 kHz frame the fallbacks analyse
+    static std::vector<float> yinDifference_;   // YIN difference, one per lag
     
-    // CREPE constants
-    static constexpr size_t CREPE_MODEL_CAPACITY = 1024;
-    static constexpr size_t CREPE_CENTS_MAPPING_SIZE = 360;
     static constexpr float MIN_FREQUENCY = 50.0f;   // ~G1
     static constexpr float MAX_FREQUENCY = 2000.0f; // ~B6
     
     // Internal processing
-    static std::array<float, CREPE_CENTS_MAPPING_SIZE> centsMapping_;
-    static void generateCentsMapping();
+    static const std::array<float, CREPE_CENTS_MAPPING_SIZE> centsMapping_;
     static float centsToFrequency(float cents);
     static float frequencyToCents(float frequency);
     
     // TensorFlow Lite integration
     static bool loadModel();
-    static std::vector<float> preprocessAudio(const std::vector<float>& audio, float sampleRate);
-    static PitchResult postprocessOutput(const float* output, size_t outputSize);
     
-    // Fallback algorithms for robustness
-    static PitchResult yinPitchDetection(const std::vector<float>& signal, float sampleRate);
-    static PitchResult autocorrelationPitch(const std::vector<float>& signal, float sampleRate);
-    static float autocorrelation(const std::vector<float>& signal, int lag);
+    // Fallback algorithms for robustness, on buffers initialize() allocates
+    static PitchResult yinPitchDetection(const float* signal, size_t numSamples, float sampleRate);
+    static PitchResult autocorrelationPitch(const float* signal, size_t numSamples, float sampleRate);
+    static float autocorrelation(const float* signal, size_t numSamples, int lag);
     
     // Utility functions
-    static void applyHanningWindow(std::vector<float>& buffer);
     static float calculateRMS(const std::vector<float>& buffer);
     static bool isAudioValid(const std::vector<float>& buffer);
 };
\ No newline at end of file
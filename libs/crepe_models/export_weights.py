@@ -0,0 +1,126 @@
+"""
+Export the pre-trained CREPE weights to the MTFL container read by the
+plugin's inference runtime (libs/tensorflow_lite).
+
+    python -m crepe_models.export_weights tiny crepe-tiny.mtfl
+
+The Keras model is built by :func:`~crepe_models.core.build_and_load_model`,
+so ``model-<capacity>.h5`` has to sit next to core.py (the official crepe
+package ships them). The plugin looks for
+``~/Documents/MarsiAutoTune/Models/crepe-tiny.mtfl``.
+"""
+from __future__ import division
+from __future__ import print_function
+
+import struct
+import sys
+
+import numpy as np
+
+# op codes, see tensorflow_lite.cpp
+OP_RESHAPE = 0
+OP_CONV2D = 2
+OP_BATCH_NORM = 3
+OP_MAX_POOL2D = 7
+OP_DROPOUT = 8
+OP_PERMUTE = 9
+OP_FLATTEN = 10
+OP_DENSE = 11
+
+PADDING = {'valid': 0, 'same': 1}
+ACTIVATION = {'linear': 0, 'relu': 1, 'sigmoid': 2}
+
+
+def _layer(op, params=(), tensors=()):
+    record = struct.pack('<II', op, len(params))
+    record += struct.pack('<%di' % len(params), *params)
+    record += struct.pack('<I', len(tensors))
+    for tensor in tensors:
+        data = np.ascontiguousarray(tensor, dtype='<f4').ravel()
+        record += struct.pack('<I', data.size) + data.tobytes()
+    return record
+
+
+def _activation(layer):
+    name = layer.activation.__name__
+    if name not in ACTIVATION:
+        raise ValueError("unsupported activation %s in %s" % (name, layer.name))
+    return ACTIVATION[name]
+
+
+def export(model, path):
+    """
+    Write a Keras CREPE model as MTFL
+
+    Parameters
+    ----------
+    model : tensorflow.keras.models.Model
+        A sequential chain of Reshape, Conv2D, BatchNormalization, MaxPool2D,
+        Dropout, Permute, Flatten and Dense layers
+    path : str
+        Output file
+    """
+    records = []
+
+    for layer in model.layers:
+        kind = type(layer).__name__
+
+        if kind == 'InputLayer':
+            continue
+        elif kind == 'Reshape':
+            shape = layer.target_shape
+            records.append(_layer(OP_RESHAPE, (len(shape),) + tuple(shape)))
+        elif kind == 'Conv2D':
+            kernel, bias = layer.get_weights()
+            params = (layer.filters,) + layer.kernel_size + layer.strides + \
+                (PADDING[layer.padding], _activation(layer))
+            records.append(_layer(OP_CONV2D, params, (kernel, bias)))
+        elif kind == 'BatchNormalization':
+            gamma, beta, mean, variance = layer.get_weights()
+            epsilon = np.array([layer.epsilon])
+            records.append(_layer(OP_BATCH_NORM, (),
+                                  (gamma, beta, mean, variance, epsilon)))
+        elif kind in ('MaxPool2D', 'MaxPooling2D'):
+            params = layer.pool_size + layer.strides + (PADDING[layer.padding],)
+            records.append(_layer(OP_MAX_POOL2D, params))
+        elif kind == 'Dropout':
+            records.append(_layer(OP_DROPOUT))
+        elif kind == 'Permute':
+            records.append(_layer(OP_PERMUTE, tuple(layer.dims)))
+        elif kind == 'Flatten':
+            records.append(_layer(OP_FLATTEN))
+        elif kind == 'Dense':
+            kernel, bias = layer.get_weights()
+            records.append(_layer(OP_DENSE, (layer.units, _activation(layer)),
+                                  (kernel, bias)))
+        else:
+            raise ValueError("unsupported layer %s (%s)" % (layer.name, kind))
+
+    input_shape = tuple(model.input_shape[1:])
+
+    with open(path, 'wb') as f:
+        f.write(b'MTFL')
+        f.write(struct.pack('<II', 1, len(input_shape)))
+        f.write(struct.pack('<%di' % len(input_shape), *input_shape))
+        f.write(struct.pack('<I', len(records)))
+        for record in records:
+            f.write(record)
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        print("usage: export_weights.py tiny|small|medium|large|full "
+              "[output.mtfl]", file=sys.stderr)
+        return 1
+
+    from .core import build_and_load_model
+
+    capacity = argv[1]
+    path = argv[2] if len(argv) == 3 else "crepe-%s.mtfl" % capacity
+    export(build_and_load_model(capacity), path)
+    print("CREPE: wrote the %s model to %s" % (capacity, path))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
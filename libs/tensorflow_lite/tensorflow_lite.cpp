@@ -1,156 +1,997 @@
 #include "tensorflow_lite.h"
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
-#include <random>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TFLITE_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TFLITE_SIMD_NEON 1
+#endif
 
 namespace tflite {
 
-// Простая реализация для автономной работы MarsiAutoTune
+namespace {
+
+// Layer records of the MTFL file and their int params:
+//   kReshape     rank, dims[rank]
+//   kConv1D      filters, kernel, stride, padding, activation
+//   kConv2D      filters, kernel h, kernel w, stride h, stride w, padding, activation
+//   kBatchNorm   none; tensors gamma, beta, mean, variance, epsilon[1]
+//   kReLU, kSigmoid, kDropout, kFlatten   none
+//   kMaxPool1D   pool, stride, padding
+//   kMaxPool2D   pool h, pool w, stride h, stride w, padding
+//   kPermute     three 1-based axes, as passed to Keras
+//   kDense       units, activation
+// Conv and dense layers carry two tensors, kernel then bias.
+enum class OpCode : uint32_t {
+    kReshape = 0,
+    kConv1D = 1,
+    kConv2D = 2,
+    kBatchNorm = 3,
+    kReLU = 4,
+    kSigmoid = 5,
+    kMaxPool1D = 6,
+    kMaxPool2D = 7,
+    kDropout = 8,
+    kPermute = 9,
+    kFlatten = 10,
+    kDense = 11
+};
+
+enum class Padding : int32_t { kValid = 0, kSame = 1 };
+enum class Activation : int32_t { kNone = 0, kReLU = 1, kSigmoid = 2 };
+
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kMaxParams = 16;
+constexpr uint32_t kMaxTensors = 8;
+
+struct LayerRecord {
+    OpCode op;
+    std::vector<int32_t> params;
+    std::vector<std::vector<float>> tensors;
+};
+
+struct ParsedModel {
+    std::vector<int> input_dims;
+    std::vector<LayerRecord> layers;
+};
+
+// Bounds-checked little-endian reader over the model buffer
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : pos_(data), end_(data + size) {}
+
+    bool ok() const { return ok_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+
+    uint32_t u32() { uint32_t value = 0; read(&value, sizeof(value)); return value; }
+    int32_t i32() { int32_t value = 0; read(&value, sizeof(value)); return value; }
+
+    void floats(std::vector<float>& out, uint32_t count) {
+        if (count > remaining() / sizeof(float)) { ok_ = false; return; }
+        out.resize(count);
+        read(out.data(), count * sizeof(float));
+    }
+
+private:
+    void read(void* dest, size_t bytes) {
+        if (!ok_ || bytes > remaining()) { ok_ = false; return; }
+        if (bytes > 0) std::memcpy(dest, pos_, bytes);
+        pos_ += bytes;
+    }
+
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    bool ok_ = true;
+};
+
+bool parseModel(const uint8_t* data, size_t size, ParsedModel& model) {
+    if (data == nullptr || size < 4 || std::memcmp(data, "MTFL", 4) != 0) return false;
+
+    Reader reader(data + 4, size - 4);
+    if (reader.u32() != kFormatVersion) return false;
+
+    const uint32_t rank = reader.u32();
+    if (rank == 0 || rank > 3) return false;
+    for (uint32_t i = 0; i < rank; ++i)
+        model.input_dims.push_back(reader.i32());
+
+    const uint32_t numLayers = reader.u32();
+    if (!reader.ok() || numLayers > reader.remaining() / 12) return false;
+
+    model.layers.resize(numLayers);
+    for (auto& layer : model.layers) {
+        layer.op = static_cast<OpCode>(reader.u32());
+
+        const uint32_t numParams = reader.u32();
+        if (numParams > kMaxParams) return false;
+        for (uint32_t i = 0; i < numParams; ++i)
+            layer.params.push_back(reader.i32());
+
+        const uint32_t numTensors = reader.u32();
+        if (numTensors > kMaxTensors) return false;
+        layer.tensors.resize(numTensors);
+        for (auto& tensor : layer.tensors)
+            reader.floats(tensor, reader.u32());
+
+        if (!reader.ok()) return false;
+    }
+
+    return reader.ok() && reader.remaining() == 0;
+}
+
+// Per-example activation shape: NHWC without the N
+struct Shape {
+    int h = 1;
+    int w = 1;
+    int c = 1;
+    int size() const { return h * w * c; }
+};
+
+// Rank 1 is a flat vector, rank 2 is (steps, channels) as Conv1D sees it
+bool shapeFromDims(const int* dims, int rank, Shape& shape) {
+    for (int i = 0; i < rank; ++i)
+        if (dims[i] <= 0) return false;
+
+    switch (rank) {
+        case 1: shape = {1, 1, dims[0]}; return true;
+        case 2: shape = {dims[0], 1, dims[1]}; return true;
+        case 3: shape = {dims[0], dims[1], dims[2]}; return true;
+        default: return false;
+    }
+}
+
+// Keras output length and leading pad along one spatial axis
+bool windowAxis(int in, int kernel, int stride, Padding padding, int& out, int& padBefore) {
+    if (kernel < 1 || stride < 1) return false;
+
+    if (padding == Padding::kSame) {
+        out = (in + stride - 1) / stride;
+        padBefore = std::max((out - 1) * stride + kernel - in, 0) / 2;
+    } else {
+        if (in < kernel) return false;
+        out = (in - kernel) / stride + 1;
+        padBefore = 0;
+    }
+    return out > 0;
+}
+
+//==============================================================================
+// SIMD: four float lanes on SSE and NEON, a plain struct elsewhere
+
+#if TFLITE_SIMD_SSE
+using Vec4 = __m128;
+inline Vec4 zero4() { return _mm_setzero_ps(); }
+inline Vec4 load4(const float* p) { return _mm_loadu_ps(p); }
+inline void store4(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+inline Vec4 splat4(float x) { return _mm_set1_ps(x); }
+inline Vec4 add4(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+inline Vec4 madd4(Vec4 acc, Vec4 a, Vec4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+#elif TFLITE_SIMD_NEON
+using Vec4 = float32x4_t;
+inline Vec4 zero4() { return vdupq_n_f32(0.0f); }
+inline Vec4 load4(const float* p) { return vld1q_f32(p); }
+inline void store4(float* p, Vec4 v) { vst1q_f32(p, v); }
+inline Vec4 splat4(float x) { return vdupq_n_f32(x); }
+inline Vec4 add4(Vec4 a, Vec4 b) { return vaddq_f32(a, b); }
+inline Vec4 madd4(Vec4 acc, Vec4 a, Vec4 b) { return vmlaq_f32(acc, a, b); }
+#else
+struct Vec4 { float v[4]; };
+inline Vec4 zero4() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+inline Vec4 load4(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store4(float* p, Vec4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline Vec4 splat4(float x) { return {{x, x, x, x}}; }
+inline Vec4 add4(Vec4 a, Vec4 b) {
+    for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+    return a;
+}
+inline Vec4 madd4(Vec4 acc, Vec4 a, Vec4 b) {
+    for (int i = 0; i < 4; ++i) acc.v[i] += a.v[i] * b.v[i];
+    return acc;
+}
+#endif
+
+//==============================================================================
+// GEMM: out[M x N] = bias + rows[M x K] * weights[K x N]
+
+// Register block of the micro-kernel: kMR rows against kNR columns, held in
+// eight four-lane accumulators
+constexpr int kMR = 4;
+constexpr int kNR = 8;
+
+// Cache blocks: a kKC x kNR weight panel (8 KB) stays in L1 while the packed
+// kMC x kKC block of rows (64 KB) is swept from L2
+constexpr int kKC = 256;
+constexpr int kMC = 64;
+
+// Left-hand rows, row m belonging to example m / rowsPerBatch. When rowStride
+// is shorter than K the rows overlap: a 1-D convolution then reads its
+// patches straight out of the padded input, which is im2col without the copy
+struct RowSource {
+    const float* base;
+    size_t batchStride;
+    int rowsPerBatch;
+    size_t rowStride;
+
+    const float* row(int m) const {
+        return base + static_cast<size_t>(m / rowsPerBatch) * batchStride
+                    + static_cast<size_t>(m % rowsPerBatch) * rowStride;
+    }
+};
+
+// Weights as kNR-column panels, each K rows deep and zero-padded past N, so
+// the micro-kernel streams one contiguous panel
+void packWeights(const float* kernel, int K, int N, std::vector<float>& packed) {
+    const int panels = (N + kNR - 1) / kNR;
+    packed.assign(static_cast<size_t>(panels) * K * kNR, 0.0f);
+
+    for (int p = 0; p < panels; ++p) {
+        float* panel = packed.data() + static_cast<size_t>(p) * K * kNR;
+        const int cols = std::min(kNR, N - p * kNR);
+        for (int k = 0; k < K; ++k)
+            for (int j = 0; j < cols; ++j)
+                panel[static_cast<size_t>(k) * kNR + j] = kernel[static_cast<size_t>(k) * N + p * kNR + j];
+    }
+}
+
+// Rows [i0, i0 + mc) by columns [k0, k0 + kc) as kMR-row panels, interleaved
+// so each k step of the micro-kernel reads kMR consecutive floats
+void packRows(const RowSource& rows, int i0, int mc, int k0, int kc, float* dest) {
+    for (int r = 0; r < mc; r += kMR) {
+        float* panel = dest + static_cast<size_t>(r) * kc;
+        for (int rr = 0; rr < kMR; ++rr) {
+            if (r + rr < mc) {
+                const float* src = rows.row(i0 + r + rr) + k0;
+                for (int k = 0; k < kc; ++k) panel[k * kMR + rr] = src[k];
+            } else {
+                for (int k = 0; k < kc; ++k) panel[k * kMR + rr] = 0.0f;
+            }
+        }
+    }
+}
+
+// c[rows x cols] += a (kc x kMR, packed) * b (kc x kNR, packed)
+void microKernel(int kc, const float* a, const float* b, float* c, int ldc, int rows, int cols) {
+    Vec4 acc[kMR][2];
+    for (int i = 0; i < kMR; ++i)
+        acc[i][0] = acc[i][1] = zero4();
+
+    for (int k = 0; k < kc; ++k) {
+        const Vec4 b0 = load4(b);
+        const Vec4 b1 = load4(b + 4);
+        for (int i = 0; i < kMR; ++i) {
+            const Vec4 ai = splat4(a[i]);
+            acc[i][0] = madd4(acc[i][0], ai, b0);
+            acc[i][1] = madd4(acc[i][1], ai, b1);
+        }
+        a += kMR;
+        b += kNR;
+    }
+
+    if (rows == kMR && cols == kNR) {
+        for (int i = 0; i < kMR; ++i) {
+            float* ci = c + static_cast<size_t>(i) * ldc;
+            store4(ci, add4(load4(ci), acc[i][0]));
+            store4(ci + 4, add4(load4(ci + 4), acc[i][1]));
+        }
+        return;
+    }
+
+    // Edge tiles go through a full tile so the loads above never overrun
+    float tile[kMR * kNR];
+    for (int i = 0; i < kMR; ++i) {
+        store4(tile + i * kNR, acc[i][0]);
+        store4(tile + i * kNR + 4, acc[i][1]);
+    }
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            c[static_cast<size_t>(i) * ldc + j] += tile[i * kNR + j];
+}
+
+void gemm(const RowSource& rows, int M, int K, int N, const float* packedWeights,
+          const float* bias, float* out, float* packedRows) {
+    for (int m = 0; m < M; ++m)
+        std::copy(bias, bias + N, out + static_cast<size_t>(m) * N);
+
+    const int panels = (N + kNR - 1) / kNR;
+
+    for (int k0 = 0; k0 < K; k0 += kKC) {
+        const int kc = std::min(kKC, K - k0);
+
+        for (int i0 = 0; i0 < M; i0 += kMC) {
+            const int mc = std::min(kMC, M - i0);
+            packRows(rows, i0, mc, k0, kc, packedRows);
+
+            for (int p = 0; p < panels; ++p) {
+                const float* panel = packedWeights + (static_cast<size_t>(p) * K + k0) * kNR;
+                const int cols = std::min(kNR, N - p * kNR);
+                float* outBlock = out + static_cast<size_t>(i0) * N + p * kNR;
+
+                for (int r = 0; r < mc; r += kMR)
+                    microKernel(kc, packedRows + static_cast<size_t>(r) * kc, panel,
+                                outBlock + static_cast<size_t>(r) * N, N, std::min(kMR, mc - r), cols);
+            }
+        }
+    }
+}
+
+//==============================================================================
+// Graph
+
+enum class NodeKind { kConv, kDense, kMaxPool, kPermute, kAffine, kActivation };
+
+struct Node {
+    NodeKind kind = NodeKind::kActivation;
+    Shape in;
+    Shape out;
+
+    // Conv and pool windows
+    int kernelH = 1, kernelW = 1;
+    int strideH = 1, strideW = 1;
+    int padTop = 0, padLeft = 0;
+
+    // Conv and dense: packed weights, then bias, activation and a batch norm
+    // folded to a per-channel scale and shift after the activation
+    int gemmK = 0;
+    int gemmN = 0;
+    std::vector<float> weights;
+    std::vector<float> bias;
+    Activation activation = Activation::kNone;
+    std::vector<float> scale;
+    std::vector<float> shift;
+
+    // 1-D convs read overlapping rows of a zero-padded copy of the input;
+    // everything else goes through an explicit im2col matrix
+    bool direct = false;
+    int paddedH = 0;
+};
+
+struct Graph {
+    std::vector<int> input_dims;
+    Shape input;
+    std::vector<Node> nodes;
+    Shape output;
+};
+
+// Scratch floats a conv needs for its padded input or im2col rows
+size_t rowScratchSize(const Node& node, int batch) {
+    if (node.kind != NodeKind::kConv) return 0;
+    if (node.direct) return static_cast<size_t>(batch) * node.paddedH * node.in.c;
+    return static_cast<size_t>(batch) * node.out.h * node.out.w * node.gemmK;
+}
+
+bool usesGemm(const Node& node) {
+    return node.kind == NodeKind::kConv || node.kind == NodeKind::kDense;
+}
+
+//==============================================================================
+// Arena planning
+
+// Offsets are kept to 64-byte boundaries so no two buffers share a cache line
+constexpr size_t kArenaAlignment = 64 / sizeof(float);
+
+size_t alignUp(size_t floats) {
+    return (floats + kArenaAlignment - 1) / kArenaAlignment * kArenaAlignment;
+}
+
+// A buffer of the arena, live from node firstUse to node lastUse inclusive
+struct BufferRequest {
+    size_t floats;
+    int firstUse;
+    int lastUse;
+    size_t offset = 0;
+};
+
+// Greedy by size: the largest buffers are placed first, each at the lowest
+// offset where it overlaps no placed buffer whose lifetime it shares.
+// Returns the arena size in floats.
+size_t planArena(std::vector<BufferRequest>& requests) {
+    std::vector<size_t> order(requests.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return requests[a].floats > requests[b].floats;
+    });
+
+    std::vector<const BufferRequest*> placed;
+    std::vector<const BufferRequest*> live;
+    size_t arenaSize = 0;
+
+    for (size_t index : order) {
+        BufferRequest& request = requests[index];
+
+        live.clear();
+        for (const BufferRequest* other : placed) {
+            if (other->firstUse <= request.lastUse && request.firstUse <= other->lastUse) live.push_back(other);
+        }
+        std::sort(live.begin(), live.end(), [](const BufferRequest* a, const BufferRequest* b) {
+            return a->offset < b->offset;
+        });
+
+        // Walk the live buffers by address and take the first gap that fits
+        size_t offset = 0;
+        for (const BufferRequest* other : live) {
+            if (offset + request.floats <= other->offset) break;
+            offset = std::max(offset, alignUp(other->offset + other->floats));
+        }
+
+        request.offset = offset;
+        arenaSize = std::max(arenaSize, offset + request.floats);
+        placed.push_back(&request);
+    }
+
+    return alignUp(arenaSize);
+}
+
+void applyActivation(float* data, size_t rows, int channels, Activation activation,
+                     const float* scale, const float* shift) {
+    if (activation == Activation::kNone && scale == nullptr) return;
+
+    for (size_t r = 0; r < rows; ++r) {
+        float* row = data + r * channels;
+        if (activation == Activation::kReLU) {
+            for (int j = 0; j < channels; ++j) row[j] = std::max(row[j], 0.0f);
+        } else if (activation == Activation::kSigmoid) {
+            for (int j = 0; j < channels; ++j) row[j] = 1.0f / (1.0f + std::exp(-row[j]));
+        }
+
+        if (scale != nullptr) {
+            for (int j = 0; j < channels; ++j) row[j] = row[j] * scale[j] + shift[j];
+        }
+    }
+}
+
+void applyEpilogue(const Node& node, float* data, size_t rows) {
+    applyActivation(data, rows, node.gemmN, node.activation,
+                    node.scale.empty() ? nullptr : node.scale.data(),
+                    node.shift.empty() ? nullptr : node.shift.data());
+}
+
+void runConv(const Node& node, const float* in, float* out, int batch, float* rowScratch, float* packedRows) {
+    const int K = node.gemmK;
+    const int outRows = node.out.h * node.out.w;
+    const int channels = node.in.c;
+    RowSource rows;
+
+    if (node.direct) {
+        const size_t inputFloats = static_cast<size_t>(node.in.h) * channels;
+        const size_t batchStride = static_cast<size_t>(node.paddedH) * channels;
+
+        for (int b = 0; b < batch; ++b) {
+            float* dest = rowScratch + b * batchStride;
+            const size_t before = static_cast<size_t>(node.padTop) * channels;
+            std::fill(dest, dest + before, 0.0f);
+            std::copy(in + b * inputFloats, in + (b + 1) * inputFloats, dest + before);
+            std::fill(dest + before + inputFloats, dest + batchStride, 0.0f);
+        }
+
+        rows = {rowScratch, batchStride, outRows, static_cast<size_t>(node.strideH) * channels};
+    } else {
+        for (int b = 0; b < batch; ++b) {
+            const float* input = in + static_cast<size_t>(b) * node.in.size();
+            for (int oh = 0; oh < node.out.h; ++oh) {
+                for (int ow = 0; ow < node.out.w; ++ow) {
+                    float* dest = rowScratch + (static_cast<size_t>(b) * outRows + oh * node.out.w + ow) * K;
+                    for (int i = 0; i < node.kernelH; ++i) {
+                        const int ih = oh * node.strideH - node.padTop + i;
+                        for (int j = 0; j < node.kernelW; ++j, dest += channels) {
+                            const int iw = ow * node.strideW - node.padLeft + j;
+                            if (ih < 0 || ih >= node.in.h || iw < 0 || iw >= node.in.w) {
+                                std::fill(dest, dest + channels, 0.0f);
+                            } else {
+                                const float* src = input + (static_cast<size_t>(ih) * node.in.w + iw) * channels;
+                                std::copy(src, src + channels, dest);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        rows = {rowScratch, static_cast<size_t>(outRows) * K, outRows, static_cast<size_t>(K)};
+    }
+
+    const int M = batch * outRows;
+    gemm(rows, M, K, node.gemmN, node.weights.data(), node.bias.data(), out, packedRows);
+    applyEpilogue(node, out, static_cast<size_t>(M));
+}
+
+void runDense(const Node& node, const float* in, float* out, int batch, float* packedRows) {
+    const RowSource rows = {in, static_cast<size_t>(node.gemmK), 1, 0};
+    gemm(rows, batch, node.gemmK, node.gemmN, node.weights.data(), node.bias.data(), out, packedRows);
+    applyEpilogue(node, out, static_cast<size_t>(batch));
+}
+
+void runMaxPool(const Node& node, const float* in, float* out, int batch) {
+    const int channels = node.in.c;
+
+    for (int b = 0; b < batch; ++b) {
+        const float* input = in + static_cast<size_t>(b) * node.in.size();
+        float* output = out + static_cast<size_t>(b) * node.out.size();
+
+        for (int oh = 0; oh < node.out.h; ++oh) {
+            for (int ow = 0; ow < node.out.w; ++ow) {
+                float* dest = output + (static_cast<size_t>(oh) * node.out.w + ow) * channels;
+                std::fill(dest, dest + channels, -INFINITY);
+
+                for (int i = 0; i < node.kernelH; ++i) {
+                    const int ih = oh * node.strideH - node.padTop + i;
+                    if (ih < 0 || ih >= node.in.h) continue;
+
+                    for (int j = 0; j < node.kernelW; ++j) {
+                        const int iw = ow * node.strideW - node.padLeft + j;
+                        if (iw < 0 || iw >= node.in.w) continue;
+
+                        const float* src = input + (static_cast<size_t>(ih) * node.in.w + iw) * channels;
+                        for (int ch = 0; ch < channels; ++ch) dest[ch] = std::max(dest[ch], src[ch]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Swaps the two spatial axes
+void runPermute(const Node& node, const float* in, float* out, int batch) {
+    const int channels = node.in.c;
+
+    for (int b = 0; b < batch; ++b) {
+        const float* input = in + static_cast<size_t>(b) * node.in.size();
+        float* output = out + static_cast<size_t>(b) * node.out.size();
+
+        for (int ih = 0; ih < node.in.h; ++ih) {
+            for (int iw = 0; iw < node.in.w; ++iw) {
+                const float* src = input + (static_cast<size_t>(ih) * node.in.w + iw) * channels;
+                std::copy(src, src + channels, output + (static_cast<size_t>(iw) * node.in.h + ih) * channels);
+            }
+        }
+    }
+}
+
+bool parseActivation(int32_t value, Activation& activation) {
+    if (value < 0 || value > static_cast<int32_t>(Activation::kSigmoid)) return false;
+    activation = static_cast<Activation>(value);
+    return true;
+}
+
+bool parsePadding(int32_t value, Padding& padding) {
+    if (value != static_cast<int32_t>(Padding::kValid) && value != static_cast<int32_t>(Padding::kSame)) return false;
+    padding = static_cast<Padding>(value);
+    return true;
+}
+
+// The previous node takes a trailing activation or batch norm when its own
+// epilogue still has room for it
+Node* fusionTarget(std::vector<Node>& nodes) {
+    if (nodes.empty()) return nullptr;
+
+    Node& last = nodes.back();
+    const bool hasEpilogue = last.kind == NodeKind::kConv || last.kind == NodeKind::kDense;
+    return hasEpilogue && last.scale.empty() ? &last : nullptr;
+}
+
+bool buildConv(const LayerRecord& layer, const Shape& shape, Node& node) {
+    const bool is1D = layer.op == OpCode::kConv1D;
+    if (layer.params.size() != (is1D ? 5u : 7u) || layer.tensors.size() != 2) return false;
+
+    const int filters = layer.params[0];
+    Padding padding;
+    if (!parsePadding(layer.params[is1D ? 3 : 5], padding)) return false;
+    if (!parseActivation(layer.params[is1D ? 4 : 6], node.activation)) return false;
+
+    node.kind = NodeKind::kConv;
+    node.in = shape;
+    node.kernelH = layer.params[1];
+    node.kernelW = is1D ? 1 : layer.params[2];
+    node.strideH = layer.params[is1D ? 2 : 3];
+    node.strideW = is1D ? 1 : layer.params[4];
+
+    if (filters <= 0) return false;
+    if (!windowAxis(shape.h, node.kernelH, node.strideH, padding, node.out.h, node.padTop)) return false;
+    if (!windowAxis(shape.w, node.kernelW, node.strideW, padding, node.out.w, node.padLeft)) return false;
+    node.out.c = filters;
+
+    node.gemmK = node.kernelH * node.kernelW * shape.c;
+    node.gemmN = filters;
+    if (layer.tensors[0].size() != static_cast<size_t>(node.gemmK) * filters) return false;
+    if (layer.tensors[1].size() != static_cast<size_t>(filters)) return false;
+
+    packWeights(layer.tensors[0].data(), node.gemmK, node.gemmN, node.weights);
+    node.bias = layer.tensors[1];
+
+    // With one column the kernel rows of consecutive outputs are contiguous
+    // runs of the padded input
+    node.direct = shape.w == 1 && node.kernelW == 1;
+    node.paddedH = std::max((node.out.h - 1) * node.strideH + node.kernelH, node.padTop + shape.h);
+    return true;
+}
+
+bool buildDense(const LayerRecord& layer, const Shape& shape, Node& node) {
+    if (layer.params.size() != 2 || layer.tensors.size() != 2) return false;
+
+    const int units = layer.params[0];
+    if (units <= 0 || !parseActivation(layer.params[1], node.activation)) return false;
+
+    node.kind = NodeKind::kDense;
+    node.in = shape;
+    node.out = {1, 1, units};
+    node.gemmK = shape.size();
+    node.gemmN = units;
+    if (layer.tensors[0].size() != static_cast<size_t>(node.gemmK) * units) return false;
+    if (layer.tensors[1].size() != static_cast<size_t>(units)) return false;
+
+    packWeights(layer.tensors[0].data(), node.gemmK, node.gemmN, node.weights);
+    node.bias = layer.tensors[1];
+    return true;
+}
+
+bool buildMaxPool(const LayerRecord& layer, const Shape& shape, Node& node) {
+    const bool is1D = layer.op == OpCode::kMaxPool1D;
+    if (layer.params.size() != (is1D ? 3u : 5u)) return false;
+
+    Padding padding;
+    if (!parsePadding(layer.params[is1D ? 2 : 4], padding)) return false;
+
+    node.kind = NodeKind::kMaxPool;
+    node.in = shape;
+    node.kernelH = layer.params[0];
+    node.kernelW = is1D ? 1 : layer.params[1];
+    node.strideH = layer.params[is1D ? 1 : 2];
+    node.strideW = is1D ? 1 : layer.params[3];
+
+    if (!windowAxis(shape.h, node.kernelH, node.strideH, padding, node.out.h, node.padTop)) return false;
+    if (!windowAxis(shape.w, node.kernelW, node.strideW, padding, node.out.w, node.padLeft)) return false;
+    node.out.c = shape.c;
+    return true;
+}
+
+bool buildBatchNorm(const LayerRecord& layer, const Shape& shape, std::vector<Node>& nodes) {
+    if (layer.tensors.size() != 5 || layer.tensors[4].size() != 1) return false;
+    for (int i = 0; i < 4; ++i)
+        if (layer.tensors[i].size() != static_cast<size_t>(shape.c)) return false;
+
+    const auto& gamma = layer.tensors[0];
+    const auto& beta = layer.tensors[1];
+    const auto& mean = layer.tensors[2];
+    const auto& variance = layer.tensors[3];
+    const float epsilon = layer.tensors[4][0];
+
+    std::vector<float> scale(shape.c), shift(shape.c);
+    for (int ch = 0; ch < shape.c; ++ch) {
+        scale[ch] = gamma[ch] / std::sqrt(variance[ch] + epsilon);
+        shift[ch] = beta[ch] - mean[ch] * scale[ch];
+    }
+
+    Node* target = fusionTarget(nodes);
+    if (target == nullptr) {
+        Node node;
+        node.kind = NodeKind::kAffine;
+        node.in = node.out = shape;
+        nodes.push_back(std::move(node));
+        target = &nodes.back();
+    }
+
+    target->scale = std::move(scale);
+    target->shift = std::move(shift);
+    return true;
+}
+
+bool buildActivation(Activation activation, const Shape& shape, std::vector<Node>& nodes) {
+    Node* target = fusionTarget(nodes);
+    if (target != nullptr && target->activation == Activation::kNone) {
+        target->activation = activation;
+        return true;
+    }
+
+    Node node;
+    node.kind = NodeKind::kActivation;
+    node.in = node.out = shape;
+    node.activation = activation;
+    nodes.push_back(std::move(node));
+    return true;
+}
+
+bool buildPermute(const LayerRecord& layer, Shape& shape, std::vector<Node>& nodes) {
+    if (layer.params.size() != 3) return false;
+
+    const auto& axes = layer.params;
+    if (axes[0] == 1 && axes[1] == 2 && axes[2] == 3) return true;
+    if (!(axes[0] == 2 && axes[1] == 1 && axes[2] == 3)) return false;
+
+    const Shape swapped = {shape.w, shape.h, shape.c};
+
+    // With either axis of length one the memory order does not change
+    if (shape.h > 1 && shape.w > 1) {
+        Node node;
+        node.kind = NodeKind::kPermute;
+        node.in = shape;
+        node.out = swapped;
+        nodes.push_back(std::move(node));
+    }
+
+    shape = swapped;
+    return true;
+}
+
+bool buildGraph(const ParsedModel& model, Graph& graph) {
+    graph.input_dims = model.input_dims;
+    if (!shapeFromDims(model.input_dims.data(), static_cast<int>(model.input_dims.size()), graph.input)) return false;
+
+    Shape shape = graph.input;
+
+    for (const auto& layer : model.layers) {
+        bool ok = true;
+
+        switch (layer.op) {
+            case OpCode::kReshape: {
+                const int rank = layer.params.empty() ? 0 : layer.params[0];
+                Shape reshaped;
+                ok = rank > 0 && layer.params.size() == static_cast<size_t>(rank) + 1
+                  && shapeFromDims(layer.params.data() + 1, rank, reshaped)
+                  && reshaped.size() == shape.size();
+                if (ok) shape = reshaped;
+                break;
+            }
+            case OpCode::kFlatten:
+                shape = {1, 1, shape.size()};
+                break;
+            case OpCode::kDropout:
+                // Identity at inference
+                break;
+            case OpCode::kConv1D:
+            case OpCode::kConv2D:
+            case OpCode::kDense:
+            case OpCode::kMaxPool1D:
+            case OpCode::kMaxPool2D: {
+                Node node;
+                if (layer.op == OpCode::kDense) ok = buildDense(layer, shape, node);
+                else if (layer.op == OpCode::kMaxPool1D || layer.op == OpCode::kMaxPool2D) ok = buildMaxPool(layer, shape, node);
+                else ok = buildConv(layer, shape, node);
+
+                if (ok) {
+                    shape = node.out;
+                    graph.nodes.push_back(std::move(node));
+                }
+                break;
+            }
+            case OpCode::kBatchNorm:
+                ok = buildBatchNorm(layer, shape, graph.nodes);
+                break;
+            case OpCode::kReLU:
+                ok = buildActivation(Activation::kReLU, shape, graph.nodes);
+                break;
+            case OpCode::kSigmoid:
+                ok = buildActivation(Activation::kSigmoid, shape, graph.nodes);
+                break;
+            case OpCode::kPermute:
+                ok = buildPermute(layer, shape, graph.nodes);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+
+        if (!ok) {
+            std::cerr << "tflite: unsupported or malformed layer, op " << static_cast<uint32_t>(layer.op) << std::endl;
+            return false;
+        }
+    }
+
+    graph.output = shape;
+    return true;
+}
+
+} // namespace
+
+// Built graph plus the tensors of one batch size
 class Interpreter::Impl {
 public:
     std::vector<TensorInfo> inputs;
     std::vector<TensorInfo> outputs;
-    std::vector<std::vector<float>> input_data;
-    std::vector<std::vector<float>> output_data;
+    Graph graph;
+    bool has_graph = false;
+    int batch = 1;
     bool tensors_allocated = false;
-    
-    Impl() {
-        // Настройка для CREPE модели (упрощенная)
+
+    // One aligned block, laid out by planArena in AllocateTensors, holds the
+    // input, every activation and the per-node scratch. Invoke only reads
+    // and writes it, and the input and output stay put until the next
+    // AllocateTensors.
+    std::vector<float> arena_storage;
+    size_t arena_floats = 0;
+    std::vector<float*> tensors;      // [0] is the input, [i + 1] the output of node i
+    std::vector<float*> row_scratch;  // per node, padded input or im2col rows
+    std::vector<float*> packed_rows;  // per node, the GEMM's packed block of rows
+
+    void setGraph(Graph newGraph) {
+        graph = std::move(newGraph);
+        has_graph = true;
+
         TensorInfo input;
-        input.shape = {1, 1024}; // Типичный размер для аудио анализа
         input.type = TensorType::kFloat32;
-        input.name = "audio_input";
-        inputs.push_back(input);
-        
+        input.name = "input";
+        inputs.assign(1, input);
+
         TensorInfo output;
-        output.shape = {1, 360}; // CREPE выдает 360 классов частот
         output.type = TensorType::kFloat32;
-        output.name = "pitch_output";
-        outputs.push_back(output);
+        output.name = "output";
+        outputs.assign(1, output);
+
+        updateShapes();
+    }
+
+    void updateShapes() {
+        inputs[0].shape = {batch};
+        inputs[0].shape.insert(inputs[0].shape.end(), graph.input_dims.begin(), graph.input_dims.end());
+        outputs[0].shape = {batch, graph.output.size()};
+    }
+
+    float* input() {
+        return tensors_allocated ? tensors.front() : nullptr;
+    }
+
+    float* output() {
+        return tensors_allocated ? tensors.back() : nullptr;
+    }
+
+    void plan();
+
+    void run() {
+        for (size_t i = 0; i < graph.nodes.size(); ++i) {
+            const Node& node = graph.nodes[i];
+            const float* in = tensors[i];
+            float* out = tensors[i + 1];
+            const size_t count = static_cast<size_t>(batch) * node.out.size();
+
+            switch (node.kind) {
+                case NodeKind::kConv:
+                    runConv(node, in, out, batch, row_scratch[i], packed_rows[i]);
+                    break;
+                case NodeKind::kDense:
+                    runDense(node, in, out, batch, packed_rows[i]);
+                    break;
+                case NodeKind::kMaxPool:
+                    runMaxPool(node, in, out, batch);
+                    break;
+                case NodeKind::kPermute:
+                    runPermute(node, in, out, batch);
+                    break;
+                case NodeKind::kAffine:
+                case NodeKind::kActivation:
+                    std::copy(in, in + count, out);
+                    applyActivation(out, count / node.out.c, node.out.c, node.activation,
+                                    node.scale.empty() ? nullptr : node.scale.data(),
+                                    node.shift.empty() ? nullptr : node.shift.data());
+                    break;
+            }
+        }
     }
 };
 
+void Interpreter::Impl::plan() {
+    const auto& nodes = graph.nodes;
+    const int numNodes = static_cast<int>(nodes.size());
+    const int lastStep = std::max(numNodes - 1, 0);
+    const size_t noBuffer = static_cast<size_t>(-1);
+
+    std::vector<BufferRequest> requests;
+    auto request = [&](size_t floats, int firstUse, int lastUse) {
+        if (floats == 0) return noBuffer;
+        requests.push_back({floats, firstUse, lastUse});
+        return requests.size() - 1;
+    };
+
+    // Node i reads tensor i and writes tensor i + 1. The input is kept intact
+    // through the whole graph, so a caller may refill only part of it.
+    std::vector<size_t> tensorRequests, rowRequests, packedRequests;
+    tensorRequests.push_back(request(static_cast<size_t>(batch) * graph.input.size(), 0, lastStep));
+
+    for (int i = 0; i < numNodes; ++i) {
+        const Node& node = nodes[static_cast<size_t>(i)];
+        tensorRequests.push_back(request(static_cast<size_t>(batch) * node.out.size(), i, std::min(i + 1, lastStep)));
+        rowRequests.push_back(request(rowScratchSize(node, batch), i, i));
+        packedRequests.push_back(request(usesGemm(node) ? static_cast<size_t>(kMC) * kKC : 0, i, i));
+    }
+
+    arena_floats = planArena(requests);
+
+    // Over-allocate by one alignment step and start on a 64-byte boundary
+    arena_storage.assign(arena_floats + kArenaAlignment, 0.0f);
+    const auto address = reinterpret_cast<uintptr_t>(arena_storage.data());
+    const size_t skew = (kArenaAlignment - (address / sizeof(float)) % kArenaAlignment) % kArenaAlignment;
+    float* base = arena_storage.data() + skew;
+
+    auto resolve = [&](size_t index) {
+        return index == noBuffer ? nullptr : base + requests[index].offset;
+    };
+
+    tensors.clear();
+    row_scratch.clear();
+    packed_rows.clear();
+    for (size_t index : tensorRequests) tensors.push_back(resolve(index));
+    for (size_t index : rowRequests) row_scratch.push_back(resolve(index));
+    for (size_t index : packedRequests) packed_rows.push_back(resolve(index));
+}
+
 Interpreter::Interpreter() : impl_(std::make_unique<Impl>()) {}
 Interpreter::~Interpreter() = default;
 
 Status Interpreter::AllocateTensors() {
+    if (!impl_->has_graph) return Status::kError;
     if (impl_->tensors_allocated) return Status::kOk;
-    
+
     // Выделяем память для тензоров
-    for (const auto& tensor : impl_->inputs) {
-        int size = 1;
-        for (int dim : tensor.shape) size *= dim;
-        impl_->input_data.emplace_back(size, 0.0f);
-    }
-    
-    for (const auto& tensor : impl_->outputs) {
-        int size = 1;
-        for (int dim : tensor.shape) size *= dim;
-        impl_->output_data.emplace_back(size, 0.0f);
-    }
-    
+    impl_->plan();
+
     impl_->tensors_allocated = true;
     return Status::kOk;
 }
 
 Status Interpreter::Invoke() {
     if (!impl_->tensors_allocated) return Status::kError;
-    
-    // Симуляция CREPE pitch detection
-    if (!impl_->input_data.empty() && !impl_->output_data.empty()) {
-        auto& input = impl_->input_data[0];
-        auto& output = impl_->output_data[0];
-        
-        // Простой анализ частоты на основе автокорреляции
-        float max_autocorr = 0.0f;
-        int best_lag = 0;
-        
-        // Поиск периода в сигнале
-        for (int lag = 16; lag < 512; ++lag) {
-            float autocorr = 0.0f;
-            int count = 0;
-            
-            for (size_t i = lag; i < input.size() && i < 1024; ++i) {
-                autocorr += input[i] * input[i - lag];
-                count++;
-            }
-            
-            if (count > 0) {
-                autocorr /= count;
-                if (autocorr > max_autocorr) {
-                    max_autocorr = autocorr;
-                    best_lag = lag;
-                }
-            }
-        }
-        
-        // Преобразуем в частотное распределение
-        std::fill(output.begin(), output.end(), 0.0f);
-        
-        if (max_autocorr > 0.1f && best_lag > 0) {
-            float freq = 44100.0f / best_lag; // Предполагаем 44.1 кГц
-            
-            // Распределяем вероятность вокруг найденной частоты
-            int freq_bin = static_cast<int>((freq - 32.7f) / (2093.0f - 32.7f) * 360.0f);
-            freq_bin = std::max(0, std::min(359, freq_bin));
-            
-            output[freq_bin] = max_autocorr;
-            
-            // Добавляем соседние бины для плавности
-            if (freq_bin > 0) output[freq_bin - 1] = max_autocorr * 0.5f;
-            if (freq_bin < 359) output[freq_bin + 1] = max_autocorr * 0.5f;
-        }
-    }
-    
+
+    impl_->run();
     return Status::kOk;
 }
 
 float* Interpreter::typed_input_tensor(int tensor_index) {
-    if (tensor_index >= 0 && tensor_index < impl_->input_data.size()) {
-        return impl_->input_data[tensor_index].data();
+    if (tensor_index == 0) {
+        return impl_->input();
     }
     return nullptr;
 }
 
 float* Interpreter::typed_output_tensor(int tensor_index) {
-    if (tensor_index >= 0 && tensor_index < impl_->output_data.size()) {
-        return impl_->output_data[tensor_index].data();
+    if (tensor_index == 0) {
+        return impl_->output();
     }
     return nullptr;
 }
 
-int Interpreter::inputs_size() const { return impl_->inputs.size(); }
-int Interpreter::outputs_size() const { return impl_->outputs.size(); }
+int Interpreter::inputs_size() const { return static_cast<int>(impl_->inputs.size()); }
+int Interpreter::outputs_size() const { return static_cast<int>(impl_->outputs.size()); }
 
 TensorInfo* Interpreter::input_tensor(int index) {
-    if (index >= 0 && index < impl_->inputs.size()) {
+    if (index >= 0 && index < inputs_size()) {
         return &impl_->inputs[index];
     }
     return nullptr;
 }
 
 TensorInfo* Interpreter::output_tensor(int index) {
-    if (index >= 0 && index < impl_->outputs.size()) {
+    if (index >= 0 && index < outputs_size()) {
         return &impl_->outputs[index];
     }
     return nullptr;
 }
 
 Status Interpreter::ResizeInputTensor(int tensor_index, const std::vector<int>& dims) {
-    if (tensor_index >= 0 && tensor_index < impl_->inputs.size()) {
-        impl_->inputs[tensor_index].shape = dims;
+    if (tensor_index != 0 || !impl_->has_graph || dims.empty() || dims[0] < 1) return Status::kError;
+
+    const auto& modelDims = impl_->graph.input_dims;
+    if (!std::equal(dims.begin() + 1, dims.end(), modelDims.begin(), modelDims.end())) return Status::kError;
+
+    if (dims[0] != impl_->batch) {
+        impl_->batch = dims[0];
+        impl_->updateShapes();
         impl_->tensors_allocated = false; // Требует переаллокации
-        return Status::kOk;
     }
-    return Status::kError;
+    return Status::kOk;
 }
 
-Status Interpreter::SetTensorParametersReadWrite(int tensor_index, TensorType type,
-                                                const char* name,
-                                                const std::vector<int>& dims,
-                                                const void* data, size_t bytes) {
-    // Упрощенная реализация для автономной работы
-    return Status::kOk;
+Status Interpreter::SetTensorParametersReadWrite(int /*tensor_index*/, TensorType /*type*/,
+                                                const char* /*name*/,
+                                                const std::vector<int>& /*dims*/,
+                                                const void* /*data*/, size_t /*bytes*/) {
+    // Tensors are owned by the interpreter; external buffers are not supported
+    return Status::kError;
 }
 
 // FlatBufferModel implementation
@@ -158,25 +999,40 @@ class FlatBufferModel::Impl {
 public:
     bool is_initialized = false;
     std::vector<uint8_t> buffer_data;
+    ParsedModel parsed;
+
+    bool parse() {
+        parsed = {};
+        is_initialized = parseModel(buffer_data.data(), buffer_data.size(), parsed);
+        return is_initialized;
+    }
 };
 
 FlatBufferModel::FlatBufferModel() : impl_(std::make_unique<Impl>()) {}
+FlatBufferModel::~FlatBufferModel() = default;
 
 std::unique_ptr<FlatBufferModel> FlatBufferModel::BuildFromFile(const char* filename) {
+    if (filename == nullptr) return nullptr;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) return nullptr;
+
     auto model = std::unique_ptr<FlatBufferModel>(new FlatBufferModel());
-    
-    // Симулируем загрузку модели
-    model->impl_->is_initialized = true;
-    model->impl_->buffer_data.resize(1024, 0); // Минимальный размер
-    
-    std::cout << "Загружена симуляция TensorFlow Lite модели: " << filename << std::endl;
+    model->impl_->buffer_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (!model->impl_->parse()) {
+        std::cerr << "tflite: not an MTFL model: " << filename << std::endl;
+        return nullptr;
+    }
     return model;
 }
 
 std::unique_ptr<FlatBufferModel> FlatBufferModel::BuildFromBuffer(const char* buffer, size_t buffer_size) {
+    if (buffer == nullptr || buffer_size == 0) return nullptr;
+
     auto model = std::unique_ptr<FlatBufferModel>(new FlatBufferModel());
-    model->impl_->is_initialized = true;
     model->impl_->buffer_data.assign(buffer, buffer + buffer_size);
+    if (!model->impl_->parse()) return nullptr;
     return model;
 }
 
@@ -192,7 +1048,7 @@ const void* FlatBufferModel::allocation() const {
 class InterpreterBuilder::Impl {
 public:
     const FlatBufferModel& model_;
-    
+
     Impl(const FlatBufferModel& model) : model_(model) {}
 };
 
@@ -202,48 +1058,69 @@ InterpreterBuilder::InterpreterBuilder(const FlatBufferModel& model)
 InterpreterBuilder::~InterpreterBuilder() = default;
 
 Status InterpreterBuilder::operator()(std::unique_ptr<Interpreter>* interpreter) {
-    if (!impl_->model_.initialized()) return Status::kError;
-    
-    *interpreter = std::make_unique<Interpreter>();
+    if (interpreter == nullptr || !impl_->model_.initialized()) return Status::kError;
+
+    Graph graph;
+    if (!buildGraph(impl_->model_.impl_->parsed, graph)) return Status::kError;
+
+    auto result = std::make_unique<Interpreter>();
+    result->impl_->setGraph(std::move(graph));
+    *interpreter = std::move(result);
     return Status::kOk;
 }
 
-Status InterpreterBuilder::operator()(std::unique_ptr<Interpreter>* interpreter, int num_threads) {
+Status InterpreterBuilder::operator()(std::unique_ptr<Interpreter>* interpreter, int /*num_threads*/) {
+    // Inference runs on the calling thread
     return this->operator()(interpreter);
 }
 
 void RegisterBuiltinOps() {
-    // Регистрация встроенных операций (пустая для симуляции)
+    // The op set is fixed; nothing to register
 }
 
 } // namespace tflite
 
+static size_t tensorBytes(const tflite::TensorInfo* info) {
+    if (info == nullptr) return 0;
+
+    size_t count = 1;
+    for (int dim : info->shape) count *= static_cast<size_t>(dim);
+    return count * sizeof(float);
+}
+
 // C API implementation
 extern "C" {
+    struct TfLiteTensor {
+        float* data;
+        size_t size;
+    };
+
     struct TfLiteModel {
         std::unique_ptr<tflite::FlatBufferModel> model;
     };
-    
+
     struct TfLiteInterpreter {
         std::unique_ptr<tflite::Interpreter> interpreter;
+        TfLiteTensor input;
+        TfLiteTensor output;
     };
-    
-    struct TfLiteTensor {
-        float* data;
-        size_t size;
-    };
-    
+
     TfLiteModel* TfLiteModelCreateFromFile(const char* model_path) {
-        auto model = new TfLiteModel();
-        model->model = tflite::FlatBufferModel::BuildFromFile(model_path);
-        return model;
+        auto model = tflite::FlatBufferModel::BuildFromFile(model_path);
+        if (!model) return nullptr;
+
+        auto result = new TfLiteModel();
+        result->model = std::move(model);
+        return result;
     }
-    
+
     void TfLiteModelDelete(TfLiteModel* model) {
         delete model;
     }
-    
+
     TfLiteInterpreter* TfLiteInterpreterCreate(const TfLiteModel* model) {
+        if (model == nullptr) return nullptr;
+
         auto interpreter = new TfLiteInterpreter();
         tflite::InterpreterBuilder builder(*model->model);
         if (builder(&interpreter->interpreter) != tflite::Status::kOk) {
@@ -252,38 +1129,44 @@ extern "C" {
         }
         return interpreter;
     }
-    
+
     void TfLiteInterpreterDelete(TfLiteInterpreter* interpreter) {
         delete interpreter;
     }
-    
+
     int TfLiteInterpreterAllocateTensors(TfLiteInterpreter* interpreter) {
         return (interpreter->interpreter->AllocateTensors() == tflite::Status::kOk) ? 0 : 1;
     }
-    
+
     int TfLiteInterpreterInvoke(TfLiteInterpreter* interpreter) {
         return (interpreter->interpreter->Invoke() == tflite::Status::kOk) ? 0 : 1;
     }
-    
+
+    // The handles live in the interpreter and follow its buffers, which move
+    // when AllocateTensors runs again
     TfLiteTensor* TfLiteInterpreterGetInputTensor(const TfLiteInterpreter* interpreter, int input_index) {
-        auto tensor = new TfLiteTensor();
-        tensor->data = interpreter->interpreter->typed_input_tensor(input_index);
-        tensor->size = 1024 * sizeof(float); // Фиксированный размер для упрощения
-        return tensor;
+        auto* self = const_cast<TfLiteInterpreter*>(interpreter);
+        if (input_index != 0) return nullptr;
+
+        self->input.data = self->interpreter->typed_input_tensor(input_index);
+        self->input.size = tensorBytes(self->interpreter->input_tensor(input_index));
+        return &self->input;
     }
-    
+
     const TfLiteTensor* TfLiteInterpreterGetOutputTensor(const TfLiteInterpreter* interpreter, int output_index) {
-        auto tensor = new TfLiteTensor();
-        tensor->data = interpreter->interpreter->typed_output_tensor(output_index);
-        tensor->size = 360 * sizeof(float);
-        return tensor;
+        auto* self = const_cast<TfLiteInterpreter*>(interpreter);
+        if (output_index != 0) return nullptr;
+
+        self->output.data = self->interpreter->typed_output_tensor(output_index);
+        self->output.size = tensorBytes(self->interpreter->output_tensor(output_index));
+        return &self->output;
     }
-    
+
     float* TfLiteTensorData(TfLiteTensor* tensor) {
         return tensor->data;
     }
-    
+
     int TfLiteTensorByteSize(const TfLiteTensor* tensor) {
         return static_cast<int>(tensor->size);
     }
-}
\ No newline at end of file
+}
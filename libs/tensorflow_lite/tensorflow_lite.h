@@ -3,6 +3,12 @@
 // TensorFlow Lite C++ API for AI Model Inference
 // This is a simplified header for the MarsiAutoTune project
 // Full TensorFlow Lite implementation would be much larger
+//
+// Behind the API is a small CPU runtime covering the op set of the CREPE
+// network: Conv1D/Conv2D, BatchNorm, ReLU, MaxPool, Dropout (identity at
+// inference), Permute, Flatten, Dense and Sigmoid. Convolutions and dense
+// layers run as one GEMM each over im2col rows, with the weights packed into
+// SIMD panels when the interpreter is built.
 
 #include <vector>
 #include <string>
@@ -55,7 +61,8 @@ public:
     TensorInfo* input_tensor(int index);
     TensorInfo* output_tensor(int index);
     
-    // Tensor manipulation
+    // Tensor manipulation. Only the batch dimension (dims[0]) can change;
+    // AllocateTensors has to run again before the next Invoke
     Status ResizeInputTensor(int tensor_index, const std::vector<int>& dims);
     Status SetTensorParametersReadWrite(int tensor_index, TensorType type,
                                        const char* name,
@@ -63,20 +70,39 @@ public:
                                        const void* data, size_t bytes);
 
 private:
+    friend class InterpreterBuilder;
+    
     class Impl;
     std::unique_ptr<Impl> impl_;
 };
 
 // Model loading utilities
+//
+// Models are read from the MTFL container written by
+// libs/crepe_models/export_weights.py, little-endian throughout:
+//
+//   char[4]  "MTFL"
+//   uint32   version (1)
+//   uint32   input rank, then uint32 dims[rank] (per example, no batch)
+//   uint32   layer count, then per layer:
+//            uint32 op, uint32 param count, int32 params[],
+//            uint32 tensor count, then per tensor uint32 count, float data[]
+//
+// Op codes and their params are listed with OpCode in tensorflow_lite.cpp.
+// Weights keep the Keras layouts (conv kernels h x w x in x out, dense
+// kernels in x out) and the layer order of the Keras model.
 class FlatBufferModel {
 public:
     static std::unique_ptr<FlatBufferModel> BuildFromFile(const char* filename);
     static std::unique_ptr<FlatBufferModel> BuildFromBuffer(const char* buffer, size_t buffer_size);
+    ~FlatBufferModel();
     
     bool initialized() const;
     const void* allocation() const;
 
 private:
+    friend class InterpreterBuilder;
+    
     FlatBufferModel();
     class Impl;
     std::unique_ptr<Impl> impl_;